@@ -0,0 +1,481 @@
+use crate::stats;
+use anyhow::{bail, Context, Result};
+use std::collections::HashSet;
+use std::fs::{self, File};
+use std::io::{BufWriter, Write};
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+
+// 3TZ 索引条目名，必须是归档中最后一个文件。
+pub const INDEX_NAME: &str = "@3dtilesIndex1@";
+
+const LOCAL_HEADER_SIGNATURE: u32 = 0x0403_4b50;
+const CENTRAL_HEADER_SIGNATURE: u32 = 0x0201_4b50;
+const END_OF_CENTRAL_SIGNATURE: u32 = 0x0605_4b50;
+const ZIP64_END_SIGNATURE: u32 = 0x0606_4b50;
+const ZIP64_LOCATOR_SIGNATURE: u32 = 0x0706_4b50;
+const ZIP64_EXTRA_ID: u16 = 0x0001;
+const VERSION_STORED: u16 = 20;
+const VERSION_ZIP64: u16 = 45;
+// 1980-01-01 00:00（DOS 日期的起点）；不写真实时间，相同输入得到相同归档。
+const DOS_DATE: u16 = (1 << 5) | 1;
+
+// 3D Tiles 归档（3TZ）：tileset.json、tile 与纹理作为不压缩（stored）条目写入同一个 zip，
+// 末尾附按路径 MD5 排序的索引，读取端二分查找即可定位条目。多个 tile 线程并发 add，
+// 在锁内顺序追加到文件；写到 <path>.partial，finish 后才改名为目标文件。
+pub struct TileArchive {
+    path: PathBuf,
+    temp: PathBuf,
+    state: Mutex<ArchiveState>,
+}
+
+struct ArchiveState {
+    // finish 后为 None。
+    out: Option<BufWriter<File>>,
+    offset: u64,
+    entries: Vec<ArchiveEntry>,
+    names: HashSet<String>,
+}
+
+struct ArchiveEntry {
+    name: String,
+    crc: u32,
+    size: u64,
+    offset: u64,
+}
+
+impl TileArchive {
+    pub fn create(path: &Path) -> Result<Self> {
+        if let Some(parent) = path.parent().filter(|parent| !parent.as_os_str().is_empty()) {
+            fs::create_dir_all(parent)
+                .with_context(|| format!("create output dir {}", parent.display()))?;
+        }
+        let mut temp = path.as_os_str().to_owned();
+        temp.push(".partial");
+        let temp = PathBuf::from(temp);
+        let file = File::create(&temp)
+            .with_context(|| format!("create archive {}", temp.display()))?;
+        Ok(Self {
+            path: path.to_path_buf(),
+            temp,
+            state: Mutex::new(ArchiveState {
+                out: Some(BufWriter::with_capacity(1 << 20, file)),
+                offset: 0,
+                entries: Vec::new(),
+                names: HashSet::new(),
+            }),
+        })
+    }
+
+    // name 为归档内以 / 分隔的相对路径，同名条目只能写一次。
+    pub fn add(&self, name: &str, bytes: &[u8]) -> Result<()> {
+        let crc = crc32(bytes);
+        let mut state = self.state.lock().unwrap();
+        if !state.names.insert(name.to_string()) {
+            bail!("duplicate archive entry {name}");
+        }
+        state
+            .append(name, crc, bytes)
+            .with_context(|| format!("write {name} to archive {}", self.temp.display()))?;
+        stats::add("archive.entries", 1);
+        stats::add("archive.bytes", bytes.len() as u64);
+        Ok(())
+    }
+
+    // 写出索引与中央目录并改名为目标文件；之后不能再 add。
+    pub fn finish(&self) -> Result<()> {
+        let _span = stats::span("archive_finish");
+        let mut state = self.state.lock().unwrap();
+        let mut write = || -> std::io::Result<()> {
+            let index = state.build_index();
+            state.append(INDEX_NAME, crc32(&index), &index)?;
+            let mut out = state.out.take().expect("archive already finished");
+            write_central_directory(&mut out, &state.entries, state.offset)?;
+            out.into_inner().map_err(|error| error.into_error())?.sync_all()
+        };
+        write().with_context(|| format!("write archive {}", self.temp.display()))?;
+        fs::rename(&self.temp, &self.path)
+            .with_context(|| format!("write archive {}", self.path.display()))
+    }
+}
+
+// 导出中途失败时删除未完成的归档。
+impl Drop for TileArchive {
+    fn drop(&mut self) {
+        let state = self.state.get_mut().unwrap_or_else(|error| error.into_inner());
+        if state.out.take().is_some() {
+            let _ = fs::remove_file(&self.temp);
+        }
+    }
+}
+
+impl ArchiveState {
+    fn append(&mut self, name: &str, crc: u32, bytes: &[u8]) -> std::io::Result<()> {
+        let entry = ArchiveEntry {
+            name: name.to_string(),
+            crc,
+            size: bytes.len() as u64,
+            offset: self.offset,
+        };
+        let header = local_header(&entry);
+        let out = self.out.as_mut().expect("archive already finished");
+        out.write_all(&header)?;
+        out.write_all(bytes)?;
+        self.offset += (header.len() + bytes.len()) as u64;
+        self.entries.push(entry);
+        Ok(())
+    }
+
+    // 每个条目 24 字节：路径的 MD5 与本地文件头偏移（u64）；
+    // 按 MD5 前后两半各作为小端 u64 依次比较的顺序排列。
+    fn build_index(&self) -> Vec<u8> {
+        let mut index: Vec<([u8; 16], u64)> = self
+            .entries
+            .iter()
+            .map(|entry| (md5(entry.name.as_bytes()), entry.offset))
+            .collect();
+        index.sort_unstable_by_key(|(hash, _)| {
+            let low = u64::from_le_bytes(hash[..8].try_into().unwrap());
+            let high = u64::from_le_bytes(hash[8..].try_into().unwrap());
+            (low, high)
+        });
+        let mut bytes = Vec::with_capacity(index.len() * 24);
+        for (hash, offset) in index {
+            bytes.extend_from_slice(&hash);
+            bytes.extend_from_slice(&offset.to_le_bytes());
+        }
+        bytes
+    }
+}
+
+fn local_header(entry: &ArchiveEntry) -> Vec<u8> {
+    let zip64 = entry.size >= u32::MAX as u64;
+    let mut header = Vec::with_capacity(30 + entry.name.len() + 20);
+    put_u32(&mut header, LOCAL_HEADER_SIGNATURE);
+    put_u16(&mut header, if zip64 { VERSION_ZIP64 } else { VERSION_STORED });
+    put_entry_fields(&mut header, entry.crc);
+    let size = if zip64 { u32::MAX } else { entry.size as u32 };
+    put_u32(&mut header, size);
+    put_u32(&mut header, size);
+    put_u16(&mut header, entry.name.len() as u16);
+    put_u16(&mut header, if zip64 { 20 } else { 0 });
+    header.extend_from_slice(entry.name.as_bytes());
+    if zip64 {
+        put_u16(&mut header, ZIP64_EXTRA_ID);
+        put_u16(&mut header, 16);
+        put_u64(&mut header, entry.size);
+        put_u64(&mut header, entry.size);
+    }
+    header
+}
+
+// 条目数、中央目录位置或大小超出 32 位字段时改写 ZIP64 结尾记录。
+fn write_central_directory(
+    out: &mut impl Write,
+    entries: &[ArchiveEntry],
+    directory_offset: u64,
+) -> std::io::Result<()> {
+    let mut directory = Vec::new();
+    for entry in entries {
+        let large_size = entry.size >= u32::MAX as u64;
+        let large_offset = entry.offset >= u32::MAX as u64;
+        let mut extra = Vec::new();
+        if large_size {
+            put_u64(&mut extra, entry.size);
+            put_u64(&mut extra, entry.size);
+        }
+        if large_offset {
+            put_u64(&mut extra, entry.offset);
+        }
+        let zip64 = !extra.is_empty();
+        let version = if zip64 { VERSION_ZIP64 } else { VERSION_STORED };
+
+        put_u32(&mut directory, CENTRAL_HEADER_SIGNATURE);
+        put_u16(&mut directory, version);
+        put_u16(&mut directory, version);
+        put_entry_fields(&mut directory, entry.crc);
+        let size = if large_size { u32::MAX } else { entry.size as u32 };
+        put_u32(&mut directory, size);
+        put_u32(&mut directory, size);
+        put_u16(&mut directory, entry.name.len() as u16);
+        put_u16(&mut directory, if zip64 { extra.len() as u16 + 4 } else { 0 });
+        put_u16(&mut directory, 0); // 注释长度
+        put_u16(&mut directory, 0); // 起始磁盘
+        put_u16(&mut directory, 0); // 内部属性
+        put_u32(&mut directory, 0); // 外部属性
+        put_u32(&mut directory, if large_offset { u32::MAX } else { entry.offset as u32 });
+        directory.extend_from_slice(entry.name.as_bytes());
+        if zip64 {
+            put_u16(&mut directory, ZIP64_EXTRA_ID);
+            put_u16(&mut directory, extra.len() as u16);
+            directory.extend_from_slice(&extra);
+        }
+    }
+
+    let count = entries.len() as u64;
+    let directory_size = directory.len() as u64;
+    let zip64 = count >= u16::MAX as u64
+        || directory_offset >= u32::MAX as u64
+        || directory_size >= u32::MAX as u64;
+    if zip64 {
+        let zip64_end_offset = directory_offset + directory_size;
+        put_u32(&mut directory, ZIP64_END_SIGNATURE);
+        put_u64(&mut directory, 44);
+        put_u16(&mut directory, VERSION_ZIP64);
+        put_u16(&mut directory, VERSION_ZIP64);
+        put_u32(&mut directory, 0);
+        put_u32(&mut directory, 0);
+        put_u64(&mut directory, count);
+        put_u64(&mut directory, count);
+        put_u64(&mut directory, directory_size);
+        put_u64(&mut directory, directory_offset);
+
+        put_u32(&mut directory, ZIP64_LOCATOR_SIGNATURE);
+        put_u32(&mut directory, 0);
+        put_u64(&mut directory, zip64_end_offset);
+        put_u32(&mut directory, 1);
+    }
+
+    put_u32(&mut directory, END_OF_CENTRAL_SIGNATURE);
+    put_u16(&mut directory, 0);
+    put_u16(&mut directory, 0);
+    let short_count = count.min(u16::MAX as u64) as u16;
+    put_u16(&mut directory, short_count);
+    put_u16(&mut directory, short_count);
+    put_u32(&mut directory, directory_size.min(u32::MAX as u64) as u32);
+    put_u32(&mut directory, directory_offset.min(u32::MAX as u64) as u32);
+    put_u16(&mut directory, 0);
+    out.write_all(&directory)
+}
+
+// 本地文件头与中央目录共有的字段：标志、存储方式、修改时间与日期、CRC。
+fn put_entry_fields(bytes: &mut Vec<u8>, crc: u32) {
+    put_u16(bytes, 0x0800); // 文件名为 UTF-8
+    put_u16(bytes, 0); // stored，不压缩
+    put_u16(bytes, 0);
+    put_u16(bytes, DOS_DATE);
+    put_u32(bytes, crc);
+}
+
+fn put_u16(bytes: &mut Vec<u8>, value: u16) {
+    bytes.extend_from_slice(&value.to_le_bytes());
+}
+
+fn put_u32(bytes: &mut Vec<u8>, value: u32) {
+    bytes.extend_from_slice(&value.to_le_bytes());
+}
+
+fn put_u64(bytes: &mut Vec<u8>, value: u64) {
+    bytes.extend_from_slice(&value.to_le_bytes());
+}
+
+const CRC32_TABLE: [u32; 256] = crc32_table();
+
+const fn crc32_table() -> [u32; 256] {
+    let mut table = [0u32; 256];
+    let mut i = 0;
+    while i < 256 {
+        let mut value = i as u32;
+        let mut bit = 0;
+        while bit < 8 {
+            value = if value & 1 != 0 { 0xEDB8_8320 ^ (value >> 1) } else { value >> 1 };
+            bit += 1;
+        }
+        table[i] = value;
+        i += 1;
+    }
+    table
+}
+
+fn crc32(bytes: &[u8]) -> u32 {
+    let mut crc = u32::MAX;
+    for &byte in bytes {
+        crc = CRC32_TABLE[((crc ^ byte as u32) & 0xFF) as usize] ^ (crc >> 8);
+    }
+    !crc
+}
+
+const MD5_SHIFTS: [u32; 64] = [
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9,
+    14, 20, 5, 9, 14, 20, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 6, 10, 15,
+    21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+];
+
+const MD5_CONSTANTS: [u32; 64] = [
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+];
+
+// 索引只对短路径求哈希，逐块处理即可。
+fn md5(data: &[u8]) -> [u8; 16] {
+    let mut message = data.to_vec();
+    message.push(0x80);
+    while message.len() % 64 != 56 {
+        message.push(0);
+    }
+    message.extend_from_slice(&((data.len() as u64).wrapping_mul(8)).to_le_bytes());
+
+    let mut state: [u32; 4] = [0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476];
+    for block in message.chunks_exact(64) {
+        let words: Vec<u32> = block
+            .chunks_exact(4)
+            .map(|word| u32::from_le_bytes(word.try_into().unwrap()))
+            .collect();
+        let [mut a, mut b, mut c, mut d] = state;
+        for i in 0..64 {
+            let (f, g) = match i / 16 {
+                0 => ((b & c) | (!b & d), i),
+                1 => ((d & b) | (!d & c), (5 * i + 1) % 16),
+                2 => (b ^ c ^ d, (3 * i + 5) % 16),
+                _ => (c ^ (b | !d), (7 * i) % 16),
+            };
+            let rotated = a
+                .wrapping_add(f)
+                .wrapping_add(MD5_CONSTANTS[i])
+                .wrapping_add(words[g])
+                .rotate_left(MD5_SHIFTS[i]);
+            (a, b, c, d) = (d, b.wrapping_add(rotated), b, c);
+        }
+        for (value, add) in state.iter_mut().zip([a, b, c, d]) {
+            *value = value.wrapping_add(add);
+        }
+    }
+
+    let mut digest = [0u8; 16];
+    for (chunk, value) in digest.chunks_exact_mut(4).zip(state) {
+        chunk.copy_from_slice(&value.to_le_bytes());
+    }
+    digest
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn hex(bytes: &[u8]) -> String {
+        bytes.iter().map(|byte| format!("{byte:02x}")).collect()
+    }
+
+    fn u16_at(bytes: &[u8], at: usize) -> usize {
+        u16::from_le_bytes(bytes[at..at + 2].try_into().unwrap()) as usize
+    }
+
+    fn u32_at(bytes: &[u8], at: usize) -> u32 {
+        u32::from_le_bytes(bytes[at..at + 4].try_into().unwrap())
+    }
+
+    #[test]
+    fn md5_matches_rfc1321_vectors() {
+        let vectors = [
+            ("", "d41d8cd98f00b204e9800998ecf8427e"),
+            ("a", "0cc175b9c0f1b6a831c399e269772661"),
+            ("abc", "900150983cd24fb0d6963f7d28e17f72"),
+            ("message digest", "f96b697d7cb7938d525a2f31aaf161d0"),
+            ("abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"),
+            (
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+                "d174ab98d277d9f5a5611c2c9f419d9f",
+            ),
+            (
+                "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+                "57edf4a22be3c955ac49da2e2107b67a",
+            ),
+        ];
+        for (input, expected) in vectors {
+            assert_eq!(hex(&md5(input.as_bytes())), expected, "md5({input:?})");
+        }
+    }
+
+    #[test]
+    fn crc32_matches_check_value() {
+        assert_eq!(crc32(b""), 0);
+        assert_eq!(crc32(b"123456789"), 0xCBF4_3926);
+    }
+
+    #[test]
+    fn archive_index_is_sorted_and_points_at_entries() {
+        let path = std::env::temp_dir().join(format!("fbx2tiles-test-{}.3tz", std::process::id()));
+        let files: [(&str, &[u8]); 4] = [
+            ("tileset.json", b"{}"),
+            ("tiles/L0_X0_Z0.glb", b"glb0"),
+            ("tiles/L1_X0_Z0.glb", b"glb-one"),
+            ("textures/tex.png", b""),
+        ];
+        let archive = TileArchive::create(&path).unwrap();
+        for (name, bytes) in files {
+            archive.add(name, bytes).unwrap();
+        }
+        assert!(archive.add("tileset.json", b"again").is_err());
+        archive.finish().unwrap();
+        drop(archive);
+        let bytes = fs::read(&path).unwrap();
+        fs::remove_file(&path).unwrap();
+
+        // 条目按 add 顺序紧密排列：30 字节本地文件头 + 文件名 + 数据。
+        let mut offsets = Vec::new();
+        let mut offset = 0u64;
+        for (name, data) in files {
+            offsets.push(offset);
+            offset += (30 + name.len() + data.len()) as u64;
+        }
+
+        // 索引是最后一个条目，跟在它的本地文件头之后。
+        let index_start = offset as usize + 30 + INDEX_NAME.len();
+        assert_eq!(u32_at(&bytes, offset as usize), LOCAL_HEADER_SIGNATURE);
+        assert_eq!(&bytes[offset as usize + 30..index_start], INDEX_NAME.as_bytes());
+        let index_size = u32_at(&bytes, offset as usize + 22) as usize;
+        assert_eq!(index_size, files.len() * 24);
+        let index = &bytes[index_start..index_start + index_size];
+
+        let mut previous = None;
+        let mut seen = Vec::new();
+        for entry in index.chunks_exact(24) {
+            let key = (
+                u64::from_le_bytes(entry[..8].try_into().unwrap()),
+                u64::from_le_bytes(entry[8..16].try_into().unwrap()),
+            );
+            assert!(previous < Some(key), "index not sorted");
+            previous = Some(key);
+
+            let entry_offset = u64::from_le_bytes(entry[16..].try_into().unwrap());
+            let at = entry_offset as usize;
+            assert_eq!(u32_at(&bytes, at), LOCAL_HEADER_SIGNATURE);
+            let name = &bytes[at + 30..at + 30 + u16_at(&bytes, at + 26)];
+            assert_eq!(md5(name), entry[..16]);
+            let (position, (_, data)) = files
+                .iter()
+                .enumerate()
+                .find(|(_, (file, _))| file.as_bytes() == name)
+                .expect("index entry for unknown name");
+            assert_eq!(entry_offset, offsets[position]);
+            assert_eq!(u32_at(&bytes, at + 14), crc32(data));
+            seen.push(position);
+        }
+        seen.sort_unstable();
+        assert_eq!(seen, [0, 1, 2, 3]);
+
+        // 中央目录结尾记录：条目数包含索引本身。
+        let end = bytes.len() - 22;
+        assert_eq!(u32_at(&bytes, end), END_OF_CENTRAL_SIGNATURE);
+        assert_eq!(u16_at(&bytes, end + 10), files.len() + 1);
+        assert_eq!(u32_at(&bytes, end + 16) as usize, index_start + index_size);
+    }
+
+    #[test]
+    fn unfinished_archive_is_removed() {
+        let path = std::env::temp_dir().join(format!("fbx2tiles-drop-{}.3tz", std::process::id()));
+        let archive = TileArchive::create(&path).unwrap();
+        archive.add("tileset.json", b"{}").unwrap();
+        let temp = archive.temp.clone();
+        assert!(temp.exists());
+        drop(archive);
+        assert!(!temp.exists());
+        assert!(!path.exists());
+    }
+}
@@ -0,0 +1,590 @@
+use crate::image_utils::{encode_rgba, TextureRegistry};
+use crate::stats;
+use crate::ufbx_loader::{Material, MeshPart, TextureSource};
+use anyhow::Result;
+use image::imageops::{self, FilterType};
+use image::RgbaImage;
+use std::collections::HashMap;
+use std::sync::Arc;
+
+const ATLAS_MAX_SIZE: u32 = 4096;
+// 每块四周复制边缘像素，避免双线性过滤时相邻块串色。
+const ATLAS_PADDING: u32 = 2;
+// 无纹理成员共用的白色块边长。
+const WHITE_BLOCK_SIZE: u32 = 4;
+const UV_EPSILON: f32 = 1e-3;
+
+// 烘焙后的 tile 内容：parts 的 material_index 为 tile 内材质索引。
+pub struct TileAtlas {
+    pub parts: Vec<MeshPart>,
+    pub materials: Vec<Material>,
+    pub texture_lods: Vec<u32>,
+}
+
+// 粗层级的烘焙内容：合并后的单个图元（material_index 不使用）、共同材质参数（不含纹理）与图集像素。
+// 父节点把同组子节点的图集缩放拼接成自己的图集，纹理尺寸逐层保持不变。
+pub struct CoarseAtlas {
+    pub part: MeshPart,
+    pub material: Material,
+    pub image: RgbaImage,
+    key: GroupKey,
+}
+
+impl CoarseAtlas {
+    pub fn with_part(self, part: MeshPart) -> Self {
+        Self { part, ..self }
+    }
+}
+
+// 只有 PBR 参数、剔除方式与透明模式都一致的材质才能合并为同一个图元。
+#[derive(Clone, Copy, PartialEq, Eq, Hash)]
+struct GroupKey {
+    metallic: u32,
+    roughness: u32,
+    emissive: [u32; 3],
+    double_sided: bool,
+    blend: bool,
+    has_normals: bool,
+}
+
+struct Member<'a> {
+    index: usize,
+    part: &'a MeshPart,
+    material: &'a Material,
+    lod: u32,
+    texture: Option<Arc<RgbaImage>>,
+}
+
+// 图集块：来自某个成员纹理的裁剪区域（像素坐标）或共用白色块。
+struct Piece {
+    member: Option<usize>,
+    crop: [u32; 4],
+}
+
+// 把 tile 内可合并的材质烘焙成一张图集并合并为一个图元：基础色系数乘进顶点色，
+// 纹理按实际使用的 UV 范围裁剪后装箱。法线/自发光贴图与超出 [0, 1] 的平铺 UV 无法合并，原样保留。
+pub fn bake_tile_atlas(
+    parts: &[MeshPart],
+    materials: &[Material],
+    texture_lods: &[u32],
+    registry: &TextureRegistry,
+) -> Result<TileAtlas> {
+    let _span = stats::span("bake_atlas");
+    let mut out = TileAtlas {
+        parts: Vec::new(),
+        materials: Vec::new(),
+        texture_lods: Vec::new(),
+    };
+    let (groups, ungrouped) = group_members(parts, materials, texture_lods, registry);
+    for index in ungrouped {
+        let part = &parts[index];
+        push_unchanged(&mut out, part, &materials[part.material_index], texture_lods[index]);
+    }
+
+    for (_, members) in groups {
+        if members.len() > 1 {
+            if let Some((part, mut material, image)) = merge_group(&members, ATLAS_MAX_SIZE) {
+                if let Some(image) = image {
+                    material.base_color_texture = Some(embedded_texture(image, "atlas")?);
+                }
+                out.parts.push(MeshPart {
+                    material_index: out.materials.len(),
+                    ..part
+                });
+                out.materials.push(material);
+                out.texture_lods.push(0);
+                continue;
+            }
+        }
+        for member in &members {
+            push_unchanged(&mut out, member.part, member.material, member.lod);
+        }
+    }
+    Ok(out)
+}
+
+// 粗层级：每组带纹理的可合并材质烘焙成一张边长不超过 max_size 的图集（只有一个成员时也烘焙，
+// 以限制纹理尺寸）；返回各组图集与未并入图集的 part 下标（升序）。
+pub fn bake_coarse_atlases(
+    parts: &[MeshPart],
+    materials: &[Material],
+    texture_lods: &[u32],
+    registry: &TextureRegistry,
+    max_size: u32,
+) -> (Vec<CoarseAtlas>, Vec<usize>) {
+    let _span = stats::span("bake_coarse_atlas");
+    let (groups, mut remaining) = group_members(parts, materials, texture_lods, registry);
+    let mut atlases = Vec::new();
+    for (key, members) in groups {
+        if members.iter().any(|member| member.texture.is_some()) {
+            if let Some((part, material, Some(image))) = merge_group(&members, max_size) {
+                atlases.push(CoarseAtlas {
+                    part,
+                    material,
+                    image,
+                    key,
+                });
+                continue;
+            }
+        }
+        remaining.extend(members.iter().map(|member| member.index));
+    }
+    remaining.sort_unstable();
+    (atlases, remaining)
+}
+
+// 父节点的粗层级图集：同组子节点的图集各缩放到网格的一格（列数为成员数的平方根向上取整），
+// 每格四周复制边缘像素，UV 随之映射到所在格；只有一个成员且尺寸未超限时原样沿用。
+pub fn merge_coarse_atlases(atlases: Vec<CoarseAtlas>, size: u32) -> Vec<CoarseAtlas> {
+    let _span = stats::span("merge_coarse_atlas");
+    let mut groups: Vec<Vec<CoarseAtlas>> = Vec::new();
+    for atlas in atlases {
+        match groups.iter_mut().find(|group| group[0].key == atlas.key) {
+            Some(group) => group.push(atlas),
+            None => groups.push(vec![atlas]),
+        }
+    }
+    groups
+        .into_iter()
+        .map(|mut members| {
+            let fits = members[0].image.width().max(members[0].image.height()) <= size;
+            if members.len() == 1 && fits {
+                return members.pop().unwrap();
+            }
+            merge_coarse_group(members, size)
+        })
+        .collect()
+}
+
+fn merge_coarse_group(members: Vec<CoarseAtlas>, size: u32) -> CoarseAtlas {
+    let columns = (members.len() as f64).sqrt().ceil() as u32;
+    let rows = (members.len() as u32).div_ceil(columns);
+    let cell = size / columns;
+    let inner = cell.saturating_sub(2 * ATLAS_PADDING).max(1);
+    let (width, height) = (cell * columns, cell * rows);
+    // 与 compose_atlas 一致，空格填不透明白色。
+    let mut pixels = vec![u8::MAX; width as usize * height as usize * 4];
+
+    let mut positions = Vec::new();
+    let mut normals = Vec::new();
+    let mut uvs = Vec::new();
+    let mut colors = Vec::new();
+    let mut indices = Vec::new();
+    for (slot, member) in members.iter().enumerate() {
+        let slot = slot as u32;
+        let origin = [
+            (slot % columns) * cell + ATLAS_PADDING,
+            (slot / columns) * cell + ATLAS_PADDING,
+        ];
+        let block = imageops::resize(&member.image, inner, inner, FilterType::Triangle);
+        blit_padded(&mut pixels, width, origin, block.as_raw(), [inner, inner]);
+
+        let part = &member.part;
+        let vertex_count = part.vertex_count();
+        let base = (positions.len() / 3) as u32;
+        positions.extend_from_slice(&part.positions);
+        normals.extend_from_slice(&part.normals);
+        colors.extend_from_slice(&part.colors);
+        for uv in part.uvs.chunks_exact(2) {
+            uvs.push((origin[0] as f32 + uv[0].clamp(0.0, 1.0) * inner as f32) / width as f32);
+            uvs.push((origin[1] as f32 + uv[1].clamp(0.0, 1.0) * inner as f32) / height as f32);
+        }
+        if part.indices.is_empty() {
+            indices.extend((0..vertex_count as u32).map(|i| base + i));
+        } else {
+            indices.extend(part.indices.iter().map(|i| base + i));
+        }
+    }
+
+    let first = &members[0];
+    let mut material = first.material.clone();
+    material.blend = members.iter().any(|member| member.material.blend);
+    CoarseAtlas {
+        part: MeshPart {
+            name: Some("coarse".to_string()),
+            material_index: 0,
+            positions: positions.into(),
+            normals: normals.into(),
+            uvs: uvs.into(),
+            colors: colors.into(),
+            tangents: Default::default(),
+            indices: indices.into(),
+        },
+        material,
+        image: RgbaImage::from_raw(width, height, pixels).expect("atlas buffer size"),
+        key: first.key,
+    }
+}
+
+// 写出用的内嵌纹理（PNG 或 JPEG）。
+pub fn embedded_texture(image: RgbaImage, name: &str) -> Result<TextureSource> {
+    let encoded = encode_rgba(image)?;
+    Ok(TextureSource::Embedded {
+        bytes: encoded.bytes.into(),
+        name: Some(name.to_string()),
+    })
+}
+
+// 按 GroupKey 分组（组按首次出现的顺序）；无法合并的 part 下标按原顺序另行返回。
+fn group_members<'a>(
+    parts: &'a [MeshPart],
+    materials: &'a [Material],
+    texture_lods: &[u32],
+    registry: &TextureRegistry,
+) -> (Vec<(GroupKey, Vec<Member<'a>>)>, Vec<usize>) {
+    let mut groups: Vec<(GroupKey, Vec<Member>)> = Vec::new();
+    let mut group_index: HashMap<GroupKey, usize> = HashMap::new();
+    let mut ungrouped = Vec::new();
+    for (index, (part, &lod)) in parts.iter().zip(texture_lods).enumerate() {
+        let material = &materials[part.material_index];
+        match group_member(index, part, material, lod, registry) {
+            Some((key, member)) => {
+                let group = *group_index.entry(key).or_insert_with(|| {
+                    groups.push((key, Vec::new()));
+                    groups.len() - 1
+                });
+                groups[group].1.push(member);
+            }
+            None => ungrouped.push(index),
+        }
+    }
+    (groups, ungrouped)
+}
+
+fn push_unchanged(out: &mut TileAtlas, part: &MeshPart, material: &Material, lod: u32) {
+    out.parts.push(MeshPart {
+        material_index: out.materials.len(),
+        ..part.clone()
+    });
+    out.materials.push(material.clone());
+    out.texture_lods.push(lod);
+}
+
+fn group_member<'a>(
+    index: usize,
+    part: &'a MeshPart,
+    material: &'a Material,
+    lod: u32,
+    registry: &TextureRegistry,
+) -> Option<(GroupKey, Member<'a>)> {
+    if material.normal_texture.is_some() || material.emissive_texture.is_some() {
+        return None;
+    }
+    let vertex_count = part.vertex_count();
+    let (texture, has_alpha) = match &material.base_color_texture {
+        Some(source) => {
+            if part.uvs.len() != vertex_count * 2
+                || part
+                    .uvs
+                    .iter()
+                    .any(|&v| !(-UV_EPSILON..=1.0 + UV_EPSILON).contains(&v))
+            {
+                return None;
+            }
+            let texture = registry.decode_rgba(source, lod)?;
+            let has_alpha = texture.as_raw().chunks_exact(4).any(|px| px[3] < u8::MAX);
+            (Some(texture), has_alpha)
+        }
+        None => (None, false),
+    };
+    // 与写出端一致：带纹理的材质总是双面。
+    let key = GroupKey {
+        metallic: material.metallic.to_bits(),
+        roughness: material.roughness.to_bits(),
+        emissive: material.emissive.map(f32::to_bits),
+        double_sided: material.double_sided || texture.is_some(),
+        blend: has_alpha || material.blend || material.base_color[3] < 0.999,
+        has_normals: part.normals.len() == vertex_count * 3 && vertex_count > 0,
+    };
+    Some((
+        key,
+        Member {
+            index,
+            part,
+            material,
+            lod,
+            texture,
+        },
+    ))
+}
+
+// 返回合并后的图元、材质（不含纹理）与图集像素（成员都没有纹理时为 None）；装不进 max_size 时返回 None。
+fn merge_group(
+    members: &[Member],
+    max_size: u32,
+) -> Option<(MeshPart, Material, Option<RgbaImage>)> {
+    let mut pieces = Vec::new();
+    for (index, member) in members.iter().enumerate() {
+        if let Some(texture) = &member.texture {
+            pieces.push(Piece {
+                member: Some(index),
+                crop: uv_crop(&member.part.uvs, texture.width(), texture.height()),
+            });
+        }
+    }
+    let has_texture = !pieces.is_empty();
+    if has_texture && members.iter().any(|member| member.texture.is_none()) {
+        pieces.push(Piece {
+            member: None,
+            crop: [0, 0, WHITE_BLOCK_SIZE, WHITE_BLOCK_SIZE],
+        });
+    }
+
+    let mut atlas = None;
+    if has_texture {
+        let Some(packed) = pack_atlas(&pieces, max_size) else {
+            return None;
+        };
+        atlas = Some(packed);
+    }
+
+    let mut positions = Vec::new();
+    let mut normals = Vec::new();
+    let mut uvs = Vec::new();
+    let mut colors = Vec::new();
+    let mut indices = Vec::new();
+    for (index, member) in members.iter().enumerate() {
+        let part = member.part;
+        let vertex_count = part.vertex_count();
+        let base = (positions.len() / 3) as u32;
+        positions.extend_from_slice(&part.positions);
+        if part.normals.len() == vertex_count * 3 {
+            normals.extend_from_slice(&part.normals);
+        }
+        let factor = member.material.base_color;
+        let has_colors = part.colors.len() == vertex_count * 4;
+        for v in 0..vertex_count {
+            for channel in 0..4 {
+                let color = if has_colors { part.colors[v * 4 + channel] } else { 1.0 };
+                colors.push(color * factor[channel]);
+            }
+        }
+        if let Some(atlas) = &atlas {
+            let piece = atlas
+                .placements
+                .iter()
+                .position(|placement| pieces[placement.piece].member == Some(index))
+                .or_else(|| {
+                    atlas
+                        .placements
+                        .iter()
+                        .position(|placement| pieces[placement.piece].member.is_none())
+                })
+                .expect("atlas piece missing");
+            let placement = &atlas.placements[piece];
+            let crop = pieces[placement.piece].crop;
+            let (width, height) = match &member.texture {
+                Some(texture) => (texture.width() as f32, texture.height() as f32),
+                None => (0.0, 0.0),
+            };
+            let scale_x = placement.size[0] as f32 / (crop[2] - crop[0]) as f32;
+            let scale_y = placement.size[1] as f32 / (crop[3] - crop[1]) as f32;
+            for v in 0..vertex_count {
+                let (px, py) = if member.texture.is_some() {
+                    (
+                        (part.uvs[v * 2] * width - crop[0] as f32) * scale_x,
+                        (part.uvs[v * 2 + 1] * height - crop[1] as f32) * scale_y,
+                    )
+                } else {
+                    (
+                        0.5 * placement.size[0] as f32,
+                        0.5 * placement.size[1] as f32,
+                    )
+                };
+                let px = (px.clamp(0.0, placement.size[0] as f32) + placement.origin[0] as f32)
+                    / atlas.size[0] as f32;
+                let py = (py.clamp(0.0, placement.size[1] as f32) + placement.origin[1] as f32)
+                    / atlas.size[1] as f32;
+                uvs.extend_from_slice(&[px, py]);
+            }
+        }
+        if part.indices.is_empty() {
+            indices.extend((0..vertex_count as u32).map(|i| base + i));
+        } else {
+            indices.extend(part.indices.iter().map(|i| base + i));
+        }
+    }
+    let merged = MeshPart {
+        name: Some("atlas".to_string()),
+        material_index: 0,
+        positions: positions.into(),
+        normals: normals.into(),
+        uvs: uvs.into(),
+        colors: colors.into(),
+        // 带法线贴图的材质不参与合并，图集图元不需要切线。
+        tangents: Default::default(),
+        indices: indices.into(),
+    };
+
+    let mut material = members[0].material.clone();
+    material.name = Some("atlas".to_string());
+    material.base_color = [1.0, 1.0, 1.0, 1.0];
+    material.blend = members
+        .iter()
+        .any(|member| member.material.blend || member.material.base_color[3] < 0.999);
+    material.base_color_texture = None;
+    let image = atlas.map(|atlas| compose_atlas(&atlas, &pieces, members));
+    Some((merged, material, image))
+}
+
+// 成员实际用到的 UV 范围对应的像素矩形 [x0, y0, x1, y1]（glTF 约定 v 向下）。
+fn uv_crop(uvs: &[f32], width: u32, height: u32) -> [u32; 4] {
+    let mut min = [f32::INFINITY; 2];
+    let mut max = [f32::NEG_INFINITY; 2];
+    for uv in uvs.chunks_exact(2) {
+        for axis in 0..2 {
+            min[axis] = min[axis].min(uv[axis].clamp(0.0, 1.0));
+            max[axis] = max[axis].max(uv[axis].clamp(0.0, 1.0));
+        }
+    }
+    let range = |lo: f32, hi: f32, size: u32| {
+        let start = ((lo * size as f32).floor() as u32).min(size - 1);
+        let end = ((hi * size as f32).ceil() as u32).clamp(start + 1, size);
+        (start, end)
+    };
+    let (x0, x1) = range(min[0], max[0], width);
+    let (y0, y1) = range(min[1], max[1], height);
+    [x0, y0, x1, y1]
+}
+
+struct Placement {
+    piece: usize,
+    origin: [u32; 2],
+    size: [u32; 2],
+}
+
+struct PackedAtlas {
+    size: [u32; 2],
+    placements: Vec<Placement>,
+}
+
+// 按高度降序的货架装箱；放不下 max_size 时整体缩小后重试。
+fn pack_atlas(pieces: &[Piece], max_size: u32) -> Option<PackedAtlas> {
+    let mut scale = 1.0f64;
+    while scale > 1.0 / 64.0 {
+        let sizes: Vec<[u32; 2]> = pieces
+            .iter()
+            .map(|piece| {
+                let width = (piece.crop[2] - piece.crop[0]) as f64;
+                let height = (piece.crop[3] - piece.crop[1]) as f64;
+                if piece.member.is_none() {
+                    [piece.crop[2], piece.crop[3]]
+                } else {
+                    [
+                        ((width * scale).round() as u32).max(1),
+                        ((height * scale).round() as u32).max(1),
+                    ]
+                }
+            })
+            .collect();
+        if let Some(packed) = pack_shelves(&sizes, max_size) {
+            return Some(packed);
+        }
+        scale *= 0.8;
+    }
+    None
+}
+
+fn pack_shelves(sizes: &[[u32; 2]], max_size: u32) -> Option<PackedAtlas> {
+    let padded = |size: [u32; 2]| [size[0] + 2 * ATLAS_PADDING, size[1] + 2 * ATLAS_PADDING];
+    let area: u64 = sizes
+        .iter()
+        .map(|&size| {
+            let [w, h] = padded(size);
+            w as u64 * h as u64
+        })
+        .sum();
+    let widest = sizes.iter().map(|&size| padded(size)[0]).max().unwrap_or(1);
+    let width = ((area as f64).sqrt().ceil() as u32)
+        .max(widest)
+        .next_power_of_two();
+    if width > max_size {
+        return None;
+    }
+
+    let mut order: Vec<usize> = (0..sizes.len()).collect();
+    order.sort_by_key(|&i| std::cmp::Reverse(sizes[i][1]));
+    let mut placements = Vec::with_capacity(sizes.len());
+    let (mut x, mut y, mut shelf_height) = (0u32, 0u32, 0u32);
+    for piece in order {
+        let [w, h] = padded(sizes[piece]);
+        if x + w > width {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+        placements.push(Placement {
+            piece,
+            origin: [x + ATLAS_PADDING, y + ATLAS_PADDING],
+            size: sizes[piece],
+        });
+        x += w;
+        shelf_height = shelf_height.max(h);
+    }
+    let height = (y + shelf_height).max(1).next_power_of_two();
+    if height > max_size {
+        return None;
+    }
+    Some(PackedAtlas {
+        size: [width, height],
+        placements,
+    })
+}
+
+// 空隙填不透明白色：是否带 alpha 只取决于装入的块，全不透明的图集才能输出为 JPEG。
+fn compose_atlas(atlas: &PackedAtlas, pieces: &[Piece], members: &[Member]) -> RgbaImage {
+    let [atlas_width, atlas_height] = atlas.size;
+    let mut pixels = vec![u8::MAX; atlas_width as usize * atlas_height as usize * 4];
+    for placement in &atlas.placements {
+        let piece = &pieces[placement.piece];
+        let [width, height] = placement.size;
+        let block: Vec<u8> = match piece.member.and_then(|i| members[i].texture.as_ref()) {
+            Some(texture) => {
+                let [x0, y0, x1, y1] = piece.crop;
+                let crop = crop_rgba(texture, x0, y0, x1 - x0, y1 - y0);
+                if (crop.width(), crop.height()) == (width, height) {
+                    crop.into_raw()
+                } else {
+                    imageops::resize(&crop, width, height, FilterType::Triangle).into_raw()
+                }
+            }
+            None => vec![u8::MAX; width as usize * height as usize * 4],
+        };
+        blit_padded(&mut pixels, atlas_width, placement.origin, &block, [width, height]);
+    }
+    RgbaImage::from_raw(atlas_width, atlas_height, pixels).expect("atlas buffer size")
+}
+
+// 把 block 写到 origin 处，四周 ATLAS_PADDING 像素复制边缘。
+fn blit_padded(
+    pixels: &mut [u8],
+    atlas_width: u32,
+    origin: [u32; 2],
+    block: &[u8],
+    size: [u32; 2],
+) {
+    let [width, height] = size;
+    let pad = ATLAS_PADDING as i64;
+    for ty in -pad..height as i64 + pad {
+        let sy = ty.clamp(0, height as i64 - 1) as usize;
+        let dy = (origin[1] as i64 + ty) as usize;
+        for tx in -pad..width as i64 + pad {
+            let sx = tx.clamp(0, width as i64 - 1) as usize;
+            let dx = (origin[0] as i64 + tx) as usize;
+            let src = (sy * width as usize + sx) * 4;
+            let dst = (dy * atlas_width as usize + dx) * 4;
+            pixels[dst..dst + 4].copy_from_slice(&block[src..src + 4]);
+        }
+    }
+}
+
+fn crop_rgba(image: &RgbaImage, x: u32, y: u32, width: u32, height: u32) -> RgbaImage {
+    let stride = image.width() as usize * 4;
+    let raw = image.as_raw();
+    let mut pixels = Vec::with_capacity(width as usize * height as usize * 4);
+    for row in y..y + height {
+        let start = row as usize * stride + x as usize * 4;
+        pixels.extend_from_slice(&raw[start..start + width as usize * 4]);
+    }
+    RgbaImage::from_raw(width, height, pixels).expect("crop buffer size")
+}
@@ -0,0 +1,503 @@
+use crate::gltf_writer::{write_glb, GlbOptions};
+use crate::image_utils::{SharedTextures, TextureOptions, TextureRegistry};
+use crate::parallel::{parallel_map, resolve_jobs};
+use crate::stats;
+use crate::tiles::{export_tileset, export_tileset_streaming, TileBudget, TilesetOptions};
+use crate::ufbx_loader::{flip_v, load_scene, LoadOptions, SceneStream};
+use anyhow::{bail, Context, Result};
+use serde_json::{json, Map, Value};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Condvar, Mutex};
+use std::time::Instant;
+
+// 与 tiles 子命令一致的地理参数默认值。
+const DEFAULT_ORIGIN_LAT: f64 = 39.918_058;
+const DEFAULT_ORIGIN_LON: f64 = 116.397_026;
+const DEFAULT_ORIGIN_HEIGHT: f64 = 50.0;
+const DEFAULT_TILE_SIZE: f64 = 100.0;
+const DEFAULT_MIN_TILE_SIZE: f64 = 12.5;
+
+// 单个转换的内存占用按输入文件大小的倍数粗略估算（解析后的几何、分箱与各层简化网格）。
+const MEMORY_PER_INPUT_BYTE: u64 = 8;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum BatchMode {
+    Tiles,
+    Glb,
+}
+
+// 清单中的一条转换任务；相对路径以清单所在目录为基准。
+pub struct BatchEntry {
+    pub input: PathBuf,
+    pub output: PathBuf,
+    pub mode: BatchMode,
+    pub origin_lat: f64,
+    pub origin_lon: f64,
+    pub origin_height: f64,
+    pub heading: f64,
+    pub scale: f64,
+    pub tile_size: f64,
+    pub min_tile_size: f64,
+    pub max_level: Option<u32>,
+    pub out_of_core: bool,
+}
+
+// 批次级选项：编码与纹理设置对所有条目一致，地理参数逐条给出。
+pub struct BatchOptions {
+    // 同时进行的转换数，0 表示按可用核心数。
+    pub concurrency: usize,
+    // 所有转换共用的线程总数，按 concurrency 平分给每个转换。
+    pub jobs: usize,
+    // 同时进行的转换的估算内存之和上限；单个超限的 tiles 任务改用流式导出并独占预算。
+    pub memory_limit_mb: usize,
+    // 自适应细分预算；设置后超出内存预算的任务不再自动改用流式导出（流式模式不支持自适应细分）。
+    pub tile_budget: Option<TileBudget>,
+    pub glb: GlbOptions,
+    pub textures: TextureOptions,
+    pub embed_textures: bool,
+    pub atlas: bool,
+    pub no_flip_v: bool,
+    pub incremental: bool,
+    pub implicit: bool,
+    // 所有 tileset 共用的外部纹理目录；不设时各自写到 output_dir/textures。
+    pub texture_dir: Option<PathBuf>,
+    // 对批次内每个输入生效的节点筛选。
+    pub load: LoadOptions,
+    // 逐文件耗时报告（JSON）。
+    pub report: Option<PathBuf>,
+}
+
+// 读取 JSON（对象数组，或带 entries 数组的对象）或 CSV（首行为列名）清单。
+pub fn load_manifest(path: &Path) -> Result<Vec<BatchEntry>> {
+    load_entries(path, true)
+}
+
+// 合并导出用的源模型清单：格式相同，output 可省略。
+pub fn load_sources(path: &Path) -> Result<Vec<BatchEntry>> {
+    load_entries(path, false)
+}
+
+fn load_entries(path: &Path, require_output: bool) -> Result<Vec<BatchEntry>> {
+    let text = fs::read_to_string(path)
+        .with_context(|| format!("read batch manifest {}", path.display()))?;
+    let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
+    let is_csv = path
+        .extension()
+        .is_some_and(|ext| ext.eq_ignore_ascii_case("csv"));
+    let records = if is_csv {
+        parse_csv(&text)?
+    } else {
+        parse_json(&text)?
+    };
+    records
+        .iter()
+        .enumerate()
+        .map(|(index, record)| {
+            entry_from_record(record, base_dir, require_output)
+                .with_context(|| format!("batch manifest entry {}", index + 1))
+        })
+        .collect()
+}
+
+fn parse_json(text: &str) -> Result<Vec<Map<String, Value>>> {
+    let value: Value = serde_json::from_str(text).context("parse batch manifest JSON")?;
+    let items = match value {
+        Value::Array(items) => items,
+        Value::Object(mut object) => match object.remove("entries") {
+            Some(Value::Array(items)) => items,
+            _ => bail!("batch manifest object must contain an \"entries\" array"),
+        },
+        _ => bail!("batch manifest must be a JSON array of entries"),
+    };
+    items
+        .into_iter()
+        .map(|item| match item {
+            Value::Object(record) => Ok(record),
+            _ => bail!("batch manifest entries must be JSON objects"),
+        })
+        .collect()
+}
+
+// 支持双引号包裹的字段（"" 转义）；空行与 # 开头的行忽略。
+fn parse_csv(text: &str) -> Result<Vec<Map<String, Value>>> {
+    let mut rows = text
+        .lines()
+        .filter(|line| !line.trim().is_empty() && !line.trim_start().starts_with('#'))
+        .map(split_csv_line);
+    let Some(header) = rows.next() else {
+        return Ok(Vec::new());
+    };
+    let header: Vec<String> = header.into_iter().map(|name| name.trim().to_string()).collect();
+    rows.enumerate()
+        .map(|(index, row)| {
+            if row.len() > header.len() {
+                bail!("CSV row {} has more fields than the header", index + 2);
+            }
+            Ok(header
+                .iter()
+                .cloned()
+                .zip(row.into_iter().map(Value::String))
+                .collect())
+        })
+        .collect()
+}
+
+fn split_csv_line(line: &str) -> Vec<String> {
+    let mut fields = Vec::new();
+    let mut field = String::new();
+    let mut quoted = false;
+    let mut chars = line.chars().peekable();
+    while let Some(c) = chars.next() {
+        match c {
+            '"' if quoted && chars.peek() == Some(&'"') => {
+                field.push('"');
+                chars.next();
+            }
+            '"' => quoted = !quoted,
+            ',' if !quoted => fields.push(std::mem::take(&mut field)),
+            _ => field.push(c),
+        }
+    }
+    fields.push(field);
+    fields
+}
+
+fn entry_from_record(
+    record: &Map<String, Value>,
+    base_dir: &Path,
+    require_output: bool,
+) -> Result<BatchEntry> {
+    let input = base_dir.join(field_str(record, "input")?.context("missing \"input\"")?);
+    let output = match field_str(record, "output")? {
+        Some(output) => base_dir.join(output),
+        None if require_output => bail!("missing \"output\""),
+        None => PathBuf::new(),
+    };
+    let mode = match field_str(record, "mode")?.as_deref() {
+        Some("tiles") => BatchMode::Tiles,
+        Some("glb") => BatchMode::Glb,
+        Some(other) => bail!("unknown mode \"{other}\" (expected \"tiles\" or \"glb\")"),
+        None if output
+            .extension()
+            .is_some_and(|ext| ext.eq_ignore_ascii_case("glb")) =>
+        {
+            BatchMode::Glb
+        }
+        None => BatchMode::Tiles,
+    };
+    Ok(BatchEntry {
+        input,
+        output,
+        mode,
+        origin_lat: field_f64(record, "origin_lat")?.unwrap_or(DEFAULT_ORIGIN_LAT),
+        origin_lon: field_f64(record, "origin_lon")?.unwrap_or(DEFAULT_ORIGIN_LON),
+        origin_height: field_f64(record, "origin_height")?.unwrap_or(DEFAULT_ORIGIN_HEIGHT),
+        heading: field_f64(record, "heading")?.unwrap_or(0.0),
+        scale: field_f64(record, "scale")?.unwrap_or(1.0),
+        tile_size: field_f64(record, "tile_size")?.unwrap_or(DEFAULT_TILE_SIZE),
+        min_tile_size: field_f64(record, "min_tile_size")?.unwrap_or(DEFAULT_MIN_TILE_SIZE),
+        max_level: field_f64(record, "max_level")?.map(|level| level as u32),
+        out_of_core: field_bool(record, "out_of_core")?.unwrap_or(false),
+    })
+}
+
+// 字段缺失、为 null 或空字符串时返回 None；CSV 中所有字段都是字符串。
+fn field_str(record: &Map<String, Value>, key: &str) -> Result<Option<String>> {
+    match record.get(key) {
+        None | Some(Value::Null) => Ok(None),
+        Some(Value::String(value)) if value.trim().is_empty() => Ok(None),
+        Some(Value::String(value)) => Ok(Some(value.trim().to_string())),
+        Some(_) => bail!("\"{key}\" must be a string"),
+    }
+}
+
+fn field_f64(record: &Map<String, Value>, key: &str) -> Result<Option<f64>> {
+    match record.get(key) {
+        Some(Value::Number(number)) => Ok(number.as_f64()),
+        _ => field_str(record, key)
+            .with_context(|| format!("\"{key}\" must be a number"))?
+            .map(|value| {
+                value
+                    .parse::<f64>()
+                    .with_context(|| format!("\"{key}\" must be a number, got \"{value}\""))
+            })
+            .transpose(),
+    }
+}
+
+fn field_bool(record: &Map<String, Value>, key: &str) -> Result<Option<bool>> {
+    match record.get(key) {
+        Some(Value::Bool(value)) => Ok(Some(*value)),
+        _ => match field_str(record, key)
+            .with_context(|| format!("\"{key}\" must be a boolean"))?
+            .as_deref()
+        {
+            None => Ok(None),
+            Some("true" | "1" | "yes") => Ok(Some(true)),
+            Some("false" | "0" | "no") => Ok(Some(false)),
+            Some(other) => bail!("\"{key}\" must be a boolean, got \"{other}\""),
+        },
+    }
+}
+
+// 按估算内存放行转换：进行中的估算值之和不超过上限；超过上限的单个任务等其余任务结束后独占。
+struct MemoryBudget {
+    limit: u64,
+    used: Mutex<u64>,
+    released: Condvar,
+}
+
+struct BudgetReservation<'a> {
+    budget: &'a MemoryBudget,
+    amount: u64,
+}
+
+impl MemoryBudget {
+    fn new(limit: u64) -> Self {
+        Self {
+            limit,
+            used: Mutex::new(0),
+            released: Condvar::new(),
+        }
+    }
+
+    fn acquire(&self, estimate: u64) -> BudgetReservation<'_> {
+        let amount = estimate.min(self.limit);
+        let mut used = self.used.lock().unwrap();
+        while *used > 0 && *used + amount > self.limit {
+            used = self.released.wait(used).unwrap();
+        }
+        *used += amount;
+        BudgetReservation {
+            budget: self,
+            amount,
+        }
+    }
+}
+
+impl Drop for BudgetReservation<'_> {
+    fn drop(&mut self) {
+        *self.budget.used.lock().unwrap() -= self.amount;
+        self.budget.released.notify_all();
+    }
+}
+
+#[derive(Default)]
+struct Timings {
+    wait_seconds: f64,
+    load_seconds: f64,
+    texture_seconds: f64,
+    export_seconds: f64,
+}
+
+struct EntryReport {
+    timings: Timings,
+    out_of_core: bool,
+    error: Option<String>,
+}
+
+// 逐条转换清单中的文件：单个文件失败不影响其余文件，全部完成后若有失败则返回错误。
+// 同一批次内的纹理原图编码与外部纹理目录共享，多个模型共用的纹理只处理一次。
+pub fn run_batch(entries: Vec<BatchEntry>, options: &BatchOptions) -> Result<()> {
+    if entries.is_empty() {
+        bail!("batch manifest has no entries");
+    }
+    let started = Instant::now();
+    let total = entries.len();
+    let concurrency = resolve_jobs(options.concurrency, total);
+    let jobs = (resolve_jobs(options.jobs, usize::MAX) / concurrency).max(1);
+    let budget = MemoryBudget::new((options.memory_limit_mb as u64).saturating_mul(1024 * 1024));
+    let shared = SharedTextures::default();
+    let finished = AtomicUsize::new(0);
+
+    let results = parallel_map(concurrency, entries, |entry| {
+        let report = convert_entry(&entry, options, &budget, &shared, jobs);
+        let index = finished.fetch_add(1, Ordering::Relaxed) + 1;
+        let timings = &report.timings;
+        let status = match &report.error {
+            None => "ok".to_string(),
+            Some(err) => format!("failed: {err}"),
+        };
+        println!(
+            "[{index}/{total}] {} -> {}: {status} \
+             (wait {:.2}s, load {:.2}s, textures {:.2}s, export {:.2}s)",
+            entry.input.display(),
+            entry.output.display(),
+            timings.wait_seconds,
+            timings.load_seconds,
+            timings.texture_seconds,
+            timings.export_seconds,
+        );
+        Ok((entry, report))
+    })?;
+
+    let failed = results
+        .iter()
+        .filter(|(_, report)| report.error.is_some())
+        .count();
+    if let Some(path) = &options.report {
+        write_report(path, &results, started.elapsed().as_secs_f64())?;
+    }
+    if failed > 0 {
+        bail!("{failed} of {total} conversions failed");
+    }
+    Ok(())
+}
+
+fn convert_entry(
+    entry: &BatchEntry,
+    options: &BatchOptions,
+    budget: &MemoryBudget,
+    shared: &SharedTextures,
+    jobs: usize,
+) -> EntryReport {
+    let _span = stats::span("batch_entry");
+    let queued = Instant::now();
+    let estimate = fs::metadata(&entry.input)
+        .map(|metadata| metadata.len())
+        .unwrap_or(0)
+        .saturating_mul(MEMORY_PER_INPUT_BYTE);
+    let over_budget = estimate > budget.limit && options.tile_budget.is_none();
+    let out_of_core = entry.mode == BatchMode::Tiles && (entry.out_of_core || over_budget);
+    let _reservation = budget.acquire(estimate);
+
+    let mut timings = Timings {
+        wait_seconds: queued.elapsed().as_secs_f64(),
+        ..Timings::default()
+    };
+    let error = convert(entry, options, shared, jobs, out_of_core, &mut timings)
+        .err()
+        .map(|err| format!("{err:#}").trim_end().to_string());
+    EntryReport {
+        timings,
+        out_of_core,
+        error,
+    }
+}
+
+fn convert(
+    entry: &BatchEntry,
+    options: &BatchOptions,
+    shared: &SharedTextures,
+    jobs: usize,
+    out_of_core: bool,
+    timings: &mut Timings,
+) -> Result<()> {
+    let input = &entry.input;
+    let load_context = || format!("failed to load FBX: {}", input.display());
+    let export_context = || format!("failed to export tileset to {}", entry.output.display());
+    let mut clock = Instant::now();
+    let mut lap = move || {
+        let now = Instant::now();
+        let seconds = (now - clock).as_secs_f64();
+        clock = now;
+        seconds
+    };
+
+    if out_of_core {
+        let mut stream = SceneStream::open(input, &options.load).with_context(load_context)?;
+        timings.load_seconds = lap();
+        let registry = TextureRegistry::build_shared(&stream.materials, options.textures, shared)?;
+        timings.texture_seconds = lap();
+        let tileset = tileset_options(entry, options, jobs);
+        export_tileset_streaming(&mut stream, options.no_flip_v, &registry, &entry.output, &tileset)
+            .with_context(export_context)?;
+        timings.export_seconds = lap();
+        return Ok(());
+    }
+
+    let mut scene = load_scene(input, jobs, &options.load).with_context(load_context)?;
+    if options.no_flip_v {
+        flip_v(&mut scene);
+    }
+    timings.load_seconds = lap();
+    let registry = TextureRegistry::build_shared(&scene.materials, options.textures, shared)?;
+    timings.texture_seconds = lap();
+    match entry.mode {
+        BatchMode::Tiles => {
+            let tileset = tileset_options(entry, options, jobs);
+            export_tileset(&scene, &registry, &entry.output, &tileset)
+                .with_context(export_context)?;
+        }
+        BatchMode::Glb => {
+            if let Some(parent) = entry.output.parent() {
+                fs::create_dir_all(parent)
+                    .with_context(|| format!("create output dir {}", parent.display()))?;
+            }
+            write_glb(&scene, &registry, &entry.output, &options.glb)
+                .with_context(|| format!("failed to write GLB: {}", entry.output.display()))?;
+        }
+    }
+    timings.export_seconds = lap();
+    Ok(())
+}
+
+fn tileset_options(entry: &BatchEntry, options: &BatchOptions, jobs: usize) -> TilesetOptions {
+    TilesetOptions {
+        origin_lat: entry.origin_lat,
+        origin_lon: entry.origin_lon,
+        origin_height: entry.origin_height,
+        heading: entry.heading,
+        scale: entry.scale,
+        tile_size: entry.tile_size,
+        min_tile_size: entry.min_tile_size,
+        max_level: entry.max_level,
+        embed_textures: options.embed_textures,
+        jobs,
+        memory_limit_mb: options.memory_limit_mb,
+        glb: options.glb,
+        atlas: options.atlas,
+        incremental: options.incremental,
+        texture_dir: options.texture_dir.clone(),
+        tile_budget: options.tile_budget,
+        implicit: options.implicit,
+        archive: false,
+        coarse_levels: 0,
+        coarse_texture_size: 0,
+        load: options.load.clone(),
+    }
+}
+
+fn write_report(
+    path: &Path,
+    results: &[(BatchEntry, EntryReport)],
+    total_seconds: f64,
+) -> Result<()> {
+    let entries: Vec<Value> = results
+        .iter()
+        .map(|(entry, report)| {
+            let timings = &report.timings;
+            json!({
+                "input": entry.input.display().to_string(),
+                "output": entry.output.display().to_string(),
+                "mode": match entry.mode {
+                    BatchMode::Tiles => "tiles",
+                    BatchMode::Glb => "glb",
+                },
+                "outOfCore": report.out_of_core,
+                "status": if report.error.is_some() { "failed" } else { "ok" },
+                "error": report.error,
+                "waitSeconds": timings.wait_seconds,
+                "loadSeconds": timings.load_seconds,
+                "textureSeconds": timings.texture_seconds,
+                "exportSeconds": timings.export_seconds,
+            })
+        })
+        .collect();
+    let failed = results
+        .iter()
+        .filter(|(_, report)| report.error.is_some())
+        .count();
+    let report = json!({
+        "totalSeconds": total_seconds,
+        "succeeded": results.len() - failed,
+        "failed": failed,
+        "entries": entries,
+    });
+    let file = fs::File::create(path)
+        .with_context(|| format!("write batch report {}", path.display()))?;
+    serde_json::to_writer_pretty(file, &report)?;
+    Ok(())
+}
@@ -0,0 +1,436 @@
+use anyhow::{Context, Result};
+use std::fmt::Write as _;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::time::{Duration, Instant};
+
+use crate::geo::GeoContext;
+use crate::gltf_writer::{self, GlbOptions};
+use crate::image_utils::{TextureOptions, TextureRegistry};
+use crate::tiles;
+use crate::ufbx_loader::{self, LoadOptions, MeshPart, SceneData};
+
+// 合成场景的边长（米）与基准分箱用的叶子 tile 边长。
+const SCENE_EXTENT: f64 = 800.0;
+const BENCH_LEAF_SIZE: f64 = 25.0;
+const TEXTURE_SIZE: u32 = 512;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum BenchScene {
+    // 一张起伏的网格地形：少量大网格，测单网格吞吐。
+    Terrain,
+    // 大量各自独立几何的小盒子：测逐节点开销。
+    Meshes,
+    // 每块地面各用一张独立纹理：测纹理解码与编码。
+    Textures,
+}
+
+impl BenchScene {
+    fn name(self) -> &'static str {
+        match self {
+            BenchScene::Terrain => "terrain",
+            BenchScene::Meshes => "meshes",
+            BenchScene::Textures => "textures",
+        }
+    }
+}
+
+pub struct BenchOptions {
+    pub work_dir: PathBuf,
+    pub scenes: Vec<BenchScene>,
+    // 场景规模倍数：三角形数与纹理数均按 size² 增长。
+    pub size: usize,
+    pub iterations: usize,
+    pub jobs: usize,
+    pub glb: GlbOptions,
+    pub textures: TextureOptions,
+}
+
+// 依次生成各合成场景并逐阶段计时：每个阶段重复 iterations 次，报告最快与中位耗时，
+// 吞吐量按最快一次计算（三角形类阶段为 Mtri/s，文件类阶段为 MB/s）。
+pub fn run_bench(options: &BenchOptions) -> Result<()> {
+    fs::create_dir_all(&options.work_dir)
+        .with_context(|| format!("create bench dir {}", options.work_dir.display()))?;
+    let iterations = options.iterations.max(1);
+    let size = options.size.max(1);
+    let geo = GeoContext::new(39.918_058, 116.397_026, 50.0, 0.0, 1.0);
+    let load = LoadOptions::new(Vec::new(), Vec::new(), &[])?;
+
+    println!(
+        "{:<10} {:<16} {:>10} {:>10} {:>14}",
+        "scene", "stage", "best ms", "median ms", "throughput"
+    );
+    for &kind in &options.scenes {
+        let path = options.work_dir.join(format!("{}.fbx", kind.name()));
+        let texture_bytes = write_synthetic_scene(&path, kind, size)?;
+        let fbx_bytes = fs::metadata(&path)?.len() as usize;
+        let report = |stage: &str, timings: &[Duration], throughput: Throughput| {
+            print_stage(kind.name(), stage, timings, throughput);
+        };
+
+        let timings = time_stage(iterations, || ufbx_loader::parse_scene(&path, &load).map(drop))?;
+        report("ufbx parse", &timings, Throughput::Bytes(fbx_bytes));
+
+        let mut scene = None;
+        let timings = time_stage(iterations, || {
+            scene = Some(ufbx_loader::load_scene(&path, options.jobs, &load)?);
+            Ok(())
+        })?;
+        let scene = scene.expect("at least one iteration");
+        let triangles = scene_triangle_count(&scene);
+        report("load_scene", &timings, Throughput::Triangles(triangles));
+
+        let timings = time_stage(iterations, || {
+            tiles::clip_scene(&scene, &geo, BENCH_LEAF_SIZE);
+            Ok(())
+        })?;
+        report("tile clipping", &timings, Throughput::Triangles(triangles));
+
+        let timings = time_stage(iterations, || {
+            tiles::bin_scene(&scene, &geo, BENCH_LEAF_SIZE).map(drop)
+        })?;
+        report("tile binning", &timings, Throughput::Triangles(triangles));
+
+        let mut registry = None;
+        let timings = time_stage(iterations, || {
+            registry = Some(TextureRegistry::build(&scene.materials, options.textures)?);
+            Ok(())
+        })?;
+        let registry = registry.expect("at least one iteration");
+        if texture_bytes > 0 {
+            report("texture encode", &timings, Throughput::Bytes(texture_bytes));
+        }
+
+        let glb_path = options.work_dir.join(format!("{}.glb", kind.name()));
+        let timings = time_stage(iterations, || {
+            gltf_writer::write_glb(&scene, &registry, &glb_path, &options.glb)
+        })?;
+        let glb_bytes = fs::metadata(&glb_path)?.len() as usize;
+        report("glb write", &timings, Throughput::Bytes(glb_bytes));
+    }
+    Ok(())
+}
+
+enum Throughput {
+    Triangles(usize),
+    Bytes(usize),
+}
+
+fn time_stage(iterations: usize, mut stage: impl FnMut() -> Result<()>) -> Result<Vec<Duration>> {
+    let mut timings = Vec::with_capacity(iterations);
+    for _ in 0..iterations {
+        let start = Instant::now();
+        stage()?;
+        timings.push(start.elapsed());
+    }
+    timings.sort_unstable();
+    Ok(timings)
+}
+
+fn print_stage(scene: &str, stage: &str, timings: &[Duration], throughput: Throughput) {
+    let best = timings[0].as_secs_f64();
+    let median = timings[timings.len() / 2].as_secs_f64();
+    let rate = match throughput {
+        Throughput::Triangles(count) => format!("{:.2} Mtri/s", count as f64 / best / 1e6),
+        Throughput::Bytes(count) => format!("{:.1} MB/s", count as f64 / best / 1e6),
+    };
+    println!(
+        "{:<10} {:<16} {:>10.2} {:>10.2} {:>14}",
+        scene,
+        stage,
+        best * 1e3,
+        median * 1e3,
+        rate
+    );
+}
+
+fn scene_triangle_count(scene: &SceneData) -> usize {
+    let parts: usize = scene.parts.iter().map(MeshPart::triangle_count).sum();
+    let instanced: usize = scene
+        .instanced
+        .iter()
+        .map(|mesh| {
+            let triangles: usize = mesh.parts.iter().map(MeshPart::triangle_count).sum();
+            triangles * mesh.instances.len()
+        })
+        .sum();
+    parts + instanced
+}
+
+// 写出确定性的 ASCII FBX 7.4 场景（Y 轴向上，单位米），返回所写纹理文件的总字节数。
+fn write_synthetic_scene(path: &Path, kind: BenchScene, size: usize) -> Result<usize> {
+    let mut fbx = FbxBuilder::default();
+    let mut texture_bytes = 0;
+    match kind {
+        BenchScene::Terrain => {
+            let material = fbx.material("Ground", [0.45, 0.55, 0.35], None);
+            let n = 128 * size;
+            fbx.mesh("Terrain", &terrain_grid(n, -SCENE_EXTENT * 0.5, SCENE_EXTENT), material);
+        }
+        BenchScene::Meshes => {
+            let materials = [
+                fbx.material("Concrete", [0.7, 0.7, 0.68], None),
+                fbx.material("Brick", [0.6, 0.3, 0.2], None),
+            ];
+            let n = 48 * size;
+            let spacing = SCENE_EXTENT / n as f64;
+            let mut random = XorShift(0x9e37_79b9_7f4a_7c15);
+            for j in 0..n {
+                for i in 0..n {
+                    let x = -SCENE_EXTENT * 0.5 + (i as f64 + 0.5) * spacing;
+                    let z = -SCENE_EXTENT * 0.5 + (j as f64 + 0.5) * spacing;
+                    let height = 2.0 + random.next_f64() * 30.0;
+                    let half = spacing * (0.2 + random.next_f64() * 0.2);
+                    let material = materials[(i + j) % materials.len()];
+                    fbx.mesh(&format!("Box_{i}_{j}"), &box_mesh([x, z], half, height), material);
+                }
+            }
+        }
+        BenchScene::Textures => {
+            let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
+            let n = 4 * size;
+            let patch = SCENE_EXTENT / n as f64;
+            for j in 0..n {
+                for i in 0..n {
+                    let name = format!("patch_{i}_{j}");
+                    let file = format!("{name}.bmp");
+                    let bytes = synthetic_bmp(TEXTURE_SIZE, (j * n + i) as u32);
+                    texture_bytes += bytes.len();
+                    let texture_path = base_dir.join(&file);
+                    fs::write(&texture_path, bytes)
+                        .with_context(|| format!("write texture {}", texture_path.display()))?;
+                    let material = fbx.material(&name, [1.0, 1.0, 1.0], Some(&file));
+                    let x0 = -SCENE_EXTENT * 0.5 + i as f64 * patch;
+                    let z0 = -SCENE_EXTENT * 0.5 + j as f64 * patch;
+                    fbx.mesh(&name, &patch_grid(16, [x0, z0], patch), material);
+                }
+            }
+        }
+    }
+    fs::write(path, fbx.finish()).with_context(|| format!("write {}", path.display()))?;
+    Ok(texture_bytes)
+}
+
+// 多边形网格：顶点、多边形顶点索引与逐顶点 UV。
+struct SyntheticMesh {
+    vertices: Vec<[f64; 3]>,
+    polygons: Vec<Vec<usize>>,
+    uvs: Vec<[f64; 2]>,
+}
+
+// n × n 个四边形的起伏地形，UV 每 10 米重复一次。
+fn terrain_grid(n: usize, origin: f64, extent: f64) -> SyntheticMesh {
+    let mut mesh = grid_mesh(n, [origin, origin], extent, |x, z| {
+        3.0 * (x * 0.05).sin() * (z * 0.05).cos() + 8.0 * (x * 0.004 + z * 0.003).sin()
+    });
+    for (uv, vertex) in mesh.uvs.iter_mut().zip(&mesh.vertices) {
+        *uv = [vertex[0] / 10.0, vertex[2] / 10.0];
+    }
+    mesh
+}
+
+// 平坦的地块，UV 覆盖整张纹理。
+fn patch_grid(n: usize, origin: [f64; 2], extent: f64) -> SyntheticMesh {
+    grid_mesh(n, origin, extent, |_, _| 0.0)
+}
+
+fn grid_mesh(
+    n: usize,
+    origin: [f64; 2],
+    extent: f64,
+    height: impl Fn(f64, f64) -> f64,
+) -> SyntheticMesh {
+    let mut mesh = SyntheticMesh {
+        vertices: Vec::with_capacity((n + 1) * (n + 1)),
+        polygons: Vec::with_capacity(n * n),
+        uvs: Vec::with_capacity((n + 1) * (n + 1)),
+    };
+    for j in 0..=n {
+        for i in 0..=n {
+            let (u, v) = (i as f64 / n as f64, j as f64 / n as f64);
+            let (x, z) = (origin[0] + u * extent, origin[1] + v * extent);
+            mesh.vertices.push([x, height(x, z), z]);
+            mesh.uvs.push([u, v]);
+        }
+    }
+    for j in 0..n {
+        for i in 0..n {
+            let a = j * (n + 1) + i;
+            mesh.polygons.push(vec![a, a + n + 1, a + n + 2, a + 1]);
+        }
+    }
+    mesh
+}
+
+fn box_mesh(center: [f64; 2], half: f64, height: f64) -> SyntheticMesh {
+    let [x, z] = center;
+    let vertices = vec![
+        [x - half, 0.0, z - half],
+        [x + half, 0.0, z - half],
+        [x + half, 0.0, z + half],
+        [x - half, 0.0, z + half],
+        [x - half, height, z - half],
+        [x + half, height, z - half],
+        [x + half, height, z + half],
+        [x - half, height, z + half],
+    ];
+    let polygons = [
+        [0, 1, 2, 3],
+        [4, 7, 6, 5],
+        [0, 4, 5, 1],
+        [1, 5, 6, 2],
+        [2, 6, 7, 3],
+        [3, 7, 4, 0],
+    ];
+    let uvs = vertices.iter().map(|v| [v[0] / 4.0, (v[1] + v[2]) / 4.0]).collect();
+    SyntheticMesh {
+        vertices,
+        polygons: polygons.iter().map(|p| p.to_vec()).collect(),
+        uvs,
+    }
+}
+
+// 24 位 BMP：棋盘格叠加随 seed 变化的渐变，每张纹理内容不同，编码器无法复用结果。
+fn synthetic_bmp(size: u32, seed: u32) -> Vec<u8> {
+    let row_bytes = (size as usize * 3).div_ceil(4) * 4;
+    let pixel_bytes = row_bytes * size as usize;
+    let mut bytes = Vec::with_capacity(54 + pixel_bytes);
+    bytes.extend_from_slice(b"BM");
+    bytes.extend_from_slice(&(54 + pixel_bytes as u32).to_le_bytes());
+    bytes.extend_from_slice(&0u32.to_le_bytes());
+    bytes.extend_from_slice(&54u32.to_le_bytes());
+    bytes.extend_from_slice(&40u32.to_le_bytes());
+    bytes.extend_from_slice(&(size as i32).to_le_bytes());
+    bytes.extend_from_slice(&(size as i32).to_le_bytes());
+    bytes.extend_from_slice(&1u16.to_le_bytes());
+    bytes.extend_from_slice(&24u16.to_le_bytes());
+    bytes.extend_from_slice(&0u32.to_le_bytes());
+    bytes.extend_from_slice(&(pixel_bytes as u32).to_le_bytes());
+    bytes.extend_from_slice(&[0; 16]);
+    let tint = [(seed * 37) as u8, (seed * 91) as u8, (seed * 53) as u8];
+    for y in 0..size {
+        for x in 0..size {
+            let checker = if ((x / 32) + (y / 32)) % 2 == 0 { 64 } else { 0 };
+            let gradient = [x, y, x ^ y].map(|value| (value * 255 / size) as u8);
+            for channel in 0..3 {
+                let value = gradient[channel] / 2 + tint[channel] / 4 + checker;
+                bytes.push(value);
+            }
+        }
+        bytes.resize(bytes.len() + row_bytes - size as usize * 3, 0);
+    }
+    bytes
+}
+
+struct XorShift(u64);
+
+impl XorShift {
+    fn next_f64(&mut self) -> f64 {
+        self.0 ^= self.0 << 13;
+        self.0 ^= self.0 >> 7;
+        self.0 ^= self.0 << 17;
+        (self.0 >> 11) as f64 / (1u64 << 53) as f64
+    }
+}
+
+// 只写 ufbx 需要的对象与连接：材质（可带漫反射纹理）、几何与模型节点。
+#[derive(Default)]
+struct FbxBuilder {
+    objects: String,
+    connections: String,
+    next_id: u64,
+}
+
+impl FbxBuilder {
+    fn id(&mut self) -> u64 {
+        self.next_id += 1;
+        1000 + self.next_id
+    }
+
+    fn material(&mut self, name: &str, color: [f64; 3], texture: Option<&str>) -> u64 {
+        let id = self.id();
+        let [r, g, b] = color;
+        let _ = write!(
+            self.objects,
+            "\tMaterial: {id}, \"Material::{name}\", \"\" {{\n\t\tVersion: 102\n\
+             \t\tShadingModel: \"phong\"\n\t\tProperties70:  {{\n\
+             \t\t\tP: \"DiffuseColor\", \"Color\", \"\", \"A\",{r},{g},{b}\n\t\t}}\n\t}}\n"
+        );
+        if let Some(file) = texture {
+            let texture_id = self.id();
+            let _ = write!(
+                self.objects,
+                "\tTexture: {texture_id}, \"Texture::{name}\", \"\" {{\n\
+                 \t\tType: \"TextureVideoClip\"\n\t\tVersion: 202\n\
+                 \t\tTextureName: \"Texture::{name}\"\n\t\tFileName: \"{file}\"\n\
+                 \t\tRelativeFilename: \"{file}\"\n\t}}\n"
+            );
+            let _ = writeln!(self.connections, "\tC: \"OP\",{texture_id},{id}, \"DiffuseColor\"");
+        }
+        id
+    }
+
+    fn mesh(&mut self, name: &str, mesh: &SyntheticMesh, material: u64) {
+        let geometry = self.id();
+        let model = self.id();
+        let vertices = join_values(mesh.vertices.iter().flatten());
+        let uvs = join_values(mesh.uvs.iter().flatten());
+        let mut indices = Vec::new();
+        for polygon in &mesh.polygons {
+            let (last, rest) = polygon.split_last().expect("polygon has vertices");
+            indices.extend(rest.iter().map(|&index| index as i64));
+            indices.push(-(*last as i64) - 1);
+        }
+        let index_count = indices.len();
+        let indices = join_values(indices.iter());
+        let _ = write!(
+            self.objects,
+            "\tGeometry: {geometry}, \"Geometry::{name}\", \"Mesh\" {{\n\
+             \t\tVertices: *{} {{\n\t\t\ta: {vertices}\n\t\t}}\n\
+             \t\tPolygonVertexIndex: *{index_count} {{\n\t\t\ta: {indices}\n\t\t}}\n\
+             \t\tLayerElementUV: 0 {{\n\t\t\tVersion: 101\n\t\t\tName: \"map1\"\n\
+             \t\t\tMappingInformationType: \"ByVertice\"\n\
+             \t\t\tReferenceInformationType: \"Direct\"\n\
+             \t\t\tUV: *{} {{\n\t\t\t\ta: {uvs}\n\t\t\t}}\n\t\t}}\n\
+             \t\tLayer: 0 {{\n\t\t\tVersion: 100\n\t\t\tLayerElement:  {{\n\
+             \t\t\t\tType: \"LayerElementUV\"\n\t\t\t\tTypedIndex: 0\n\t\t\t}}\n\t\t}}\n\t}}\n\
+             \tModel: {model}, \"Model::{name}\", \"Mesh\" {{\n\t\tVersion: 232\n\t}}\n",
+            mesh.vertices.len() * 3,
+            mesh.uvs.len() * 2,
+        );
+        let _ = writeln!(self.connections, "\tC: \"OO\",{geometry},{model}");
+        let _ = writeln!(self.connections, "\tC: \"OO\",{model},0");
+        let _ = writeln!(self.connections, "\tC: \"OO\",{material},{model}");
+    }
+
+    fn finish(self) -> String {
+        let mut out = String::from(
+            "; FBX 7.4.0 project file\nFBXHeaderExtension:  {\n\tFBXHeaderVersion: 1003\n\
+             \tFBXVersion: 7400\n}\nGlobalSettings:  {\n\tVersion: 1000\n\tProperties70:  {\n\
+             \t\tP: \"UpAxis\", \"int\", \"Integer\", \"\",1\n\
+             \t\tP: \"UpAxisSign\", \"int\", \"Integer\", \"\",1\n\
+             \t\tP: \"FrontAxis\", \"int\", \"Integer\", \"\",2\n\
+             \t\tP: \"FrontAxisSign\", \"int\", \"Integer\", \"\",1\n\
+             \t\tP: \"CoordAxis\", \"int\", \"Integer\", \"\",0\n\
+             \t\tP: \"CoordAxisSign\", \"int\", \"Integer\", \"\",1\n\
+             \t\tP: \"UnitScaleFactor\", \"double\", \"Number\", \"\",100\n\t}\n}\n",
+        );
+        out.push_str("Objects:  {\n");
+        out.push_str(&self.objects);
+        out.push_str("}\nConnections:  {\n");
+        out.push_str(&self.connections);
+        out.push_str("}\n");
+        out
+    }
+}
+
+fn join_values<T: std::fmt::Display>(values: impl Iterator<Item = T>) -> String {
+    let mut out = String::new();
+    for (index, value) in values.enumerate() {
+        if index > 0 {
+            out.push(',');
+        }
+        let _ = write!(out, "{value}");
+    }
+    out
+}
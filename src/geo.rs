@@ -6,6 +6,58 @@ pub struct GeoContext {
     scale: f64,
     origin_ecef: [f64; 3],
     rot_enu_to_ecef: [[f64; 3]; 3],
+    local_to_enu: LocalToEnu,
+}
+
+// 模型坐标到 ENU 的线性部分：绕 +Y 的 heading 旋转乘均匀缩放，系数在构造时算好，逐点只剩乘加。
+// heading 为 0、缩放为 1 时系数恰为 1 与 0，结果与输入逐位相同。
+#[derive(Clone, Copy, Debug)]
+pub struct LocalToEnu {
+    cos_scaled: f64,
+    sin_scaled: f64,
+    scale: f64,
+}
+
+impl LocalToEnu {
+    fn new(heading_rad: f64, scale: f64) -> Self {
+        let (sin_h, cos_h) = heading_rad.sin_cos();
+        Self {
+            cos_scaled: cos_h * scale,
+            sin_scaled: sin_h * scale,
+            scale,
+        }
+    }
+
+    #[inline]
+    pub fn apply(&self, p: [f64; 3]) -> [f64; 3] {
+        [self.east(&p), p[1] * self.scale, self.north(&p)]
+    }
+
+    #[inline]
+    pub fn east(&self, p: &[f64; 3]) -> f64 {
+        p[0] * self.cos_scaled - p[2] * self.sin_scaled
+    }
+
+    #[inline]
+    pub fn north(&self, p: &[f64; 3]) -> f64 {
+        p[0] * self.sin_scaled + p[2] * self.cos_scaled
+    }
+
+    // ENU 的第 axis 个分量（0 东、1 上、2 北），裁剪时按需从模型坐标求出，不必另存一份 ENU 位置。
+    #[inline]
+    pub fn axis(&self, p: &[f64; 3], axis: usize) -> f64 {
+        match axis {
+            0 => self.east(p),
+            1 => p[1] * self.scale,
+            _ => self.north(p),
+        }
+    }
+
+    // 面积平方的缩放倍数（旋转不改变面积）。
+    pub fn area_sq_scale(&self) -> f64 {
+        let scale_sq = self.scale * self.scale;
+        scale_sq * scale_sq
+    }
 }
 
 impl GeoContext {
@@ -20,18 +72,34 @@ impl GeoContext {
             scale,
             origin_ecef,
             rot_enu_to_ecef,
+            local_to_enu: LocalToEnu::new(heading_rad, scale),
         }
     }
 
+    pub fn local_to_enu(&self) -> LocalToEnu {
+        self.local_to_enu
+    }
+
     // 模型坐标默认 Y-up，heading 绕 +Y 旋转后再做缩放。
     pub fn transform_local(&self, pos: [f64; 3]) -> [f64; 3] {
-        let x = pos[0] * self.scale;
-        let y = pos[1] * self.scale;
-        let z = pos[2] * self.scale;
-        let (sin_h, cos_h) = self.heading_rad.sin_cos();
-        let xr = x * cos_h - z * sin_h;
-        let zr = x * sin_h + z * cos_h;
-        [xr, y, zr]
+        self.local_to_enu.apply(pos)
+    }
+
+    // 整段 xyz 交错的 f32 位置批量变换到 ENU。系数提到循环外、循环体无分支，
+    // 编译器可按目标指令集自动向量化；结果保持 f64，tile 边界判断不损失精度。
+    pub fn transform_positions(&self, positions: &[f32]) -> Vec<[f64; 3]> {
+        let m = self.local_to_enu;
+        positions
+            .chunks_exact(3)
+            .map(|p| {
+                let (x, y, z) = (p[0] as f64, p[1] as f64, p[2] as f64);
+                [
+                    x * m.cos_scaled - z * m.sin_scaled,
+                    y * m.scale,
+                    x * m.sin_scaled + z * m.cos_scaled,
+                ]
+            })
+            .collect()
     }
 
     pub fn transform_matrix(&self) -> [f64; 16] {
@@ -87,6 +155,38 @@ impl GeoContext {
             1.0,
         ]
     }
+
+    // 本模型坐标到 target 模型坐标的变换（经由 ECEF），列主序 4x4；
+    // 多个带各自原点/heading/缩放的模型据此归一到同一坐标系后一起分块。
+    pub fn relative_transform(&self, target: &GeoContext) -> [f64; 16] {
+        let from = self.transform_matrix();
+        let to = target.transform_matrix();
+        // target 的线性部分为 缩放 × 正交矩阵，其逆为转置除以缩放的平方。
+        let inv_scale_sq = 1.0 / (target.scale * target.scale);
+        let mut inv = [[0.0; 3]; 3];
+        for i in 0..3 {
+            for j in 0..3 {
+                inv[i][j] = to[i * 4 + j] * inv_scale_sq;
+            }
+        }
+        let delta = [
+            from[12] - to[12],
+            from[13] - to[13],
+            from[14] - to[14],
+        ];
+
+        let mut m = [0.0; 16];
+        for col in 0..3 {
+            for row in 0..3 {
+                m[col * 4 + row] = (0..3).map(|k| inv[row][k] * from[col * 4 + k]).sum();
+            }
+        }
+        for row in 0..3 {
+            m[12 + row] = (0..3).map(|k| inv[row][k] * delta[k]).sum();
+        }
+        m[15] = 1.0;
+        m
+    }
 }
 
 fn identity_axis_matrix() -> [[f64; 3]; 3] {
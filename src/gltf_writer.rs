@@ -1,13 +1,18 @@
-use crate::image_utils::{encode_texture, ImageData};
-use crate::ufbx_loader::{SceneData, TextureSource};
+use crate::archive::TileArchive;
+use crate::image_utils::{EncodedTexture, TextureRegistry};
+use crate::meshopt::{encode_index_buffer, encode_vertex_buffer};
+use crate::reorder::optimize_mesh_part;
+use crate::stats::{self, TextureCacheKind};
+use crate::ufbx_loader::{InstanceTransform, MeshPart, SceneData, TextureSource};
 use anyhow::{bail, Context, Result};
 use serde_json::{json, Map, Value};
-use std::collections::hash_map::DefaultHasher;
+use std::borrow::Cow;
 use std::collections::HashMap;
 use std::fs::{self, File};
-use std::hash::{Hash, Hasher};
-use std::io::Write;
+use std::io::{BufWriter, Write};
 use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
 
 const GLTF_MAGIC: u32 = 0x46546C67;
 const GLTF_VERSION: u32 = 2;
@@ -15,26 +20,87 @@ const CHUNK_TYPE_JSON: u32 = 0x4E4F534A;
 const CHUNK_TYPE_BIN: u32 = 0x004E4942;
 
 const TARGET_ARRAY_BUFFER: u32 = 34962;
+const TARGET_ELEMENT_ARRAY_BUFFER: u32 = 34963;
+
+const COMPONENT_BYTE: u32 = 5120;
+const COMPONENT_UNSIGNED_BYTE: u32 = 5121;
+const COMPONENT_SHORT: u32 = 5122;
+const COMPONENT_UNSIGNED_SHORT: u32 = 5123;
+const COMPONENT_UNSIGNED_INT: u32 = 5125;
+const COMPONENT_FLOAT: u32 = 5126;
+
+const EXT_MESH_QUANTIZATION: &str = "KHR_mesh_quantization";
+const EXT_MESHOPT_COMPRESSION: &str = "EXT_meshopt_compression";
+const EXT_MESH_GPU_INSTANCING: &str = "EXT_mesh_gpu_instancing";
+
+// 几何压缩方式。
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Compression {
+    // EXT_meshopt_compression：顶点属性用 ATTRIBUTES 模式、索引用 TRIANGLES 模式编码，
+    // 解压后的布局放在无数据的回退缓冲（buffer 1）中。
+    Meshopt,
+}
+
+// GLB 编码选项。
+#[derive(Clone, Copy, Debug, Default)]
+pub struct GlbOptions {
+    // KHR_mesh_quantization：位置 i16（按整个 GLB 的包围盒量化，由节点变换还原），
+    // 法线/切线 i8 归一化，UV u16 归一化（超出 [0, 1] 时保留 f32），颜色 u8 归一化。
+    pub quantize: bool,
+    // 压缩前会先做顶点缓存 / 过绘制重排；与 quantize 叠加效果最好。
+    pub compression: Option<Compression>,
+}
 
+// 多个 tile 线程共享同一个缓存；文件名登记在锁内完成，保证每个 tex_<hash> 只由一个线程写入。
 pub struct TextureCache {
-    pub dir: PathBuf,
+    pub store: TextureStore,
     pub uri_prefix: String,
-    pub map: HashMap<u64, String>,
+    pub map: Mutex<HashMap<u64, String>>,
+}
+
+// 纹理文件的写出位置。
+pub enum TextureStore {
+    Dir(PathBuf),
+    // 3TZ 归档内的目录（以 / 分隔的相对路径）。
+    Archive(Arc<TileArchive>, String),
 }
 
 impl TextureCache {
     pub fn new(dir: PathBuf, uri_prefix: impl Into<String>) -> Self {
+        Self::with_store(TextureStore::Dir(dir), uri_prefix)
+    }
+
+    pub fn with_store(store: TextureStore, uri_prefix: impl Into<String>) -> Self {
         Self {
-            dir,
+            store,
             uri_prefix: uri_prefix.into(),
-            map: HashMap::new(),
+            map: Mutex::new(HashMap::new()),
         }
     }
+
+    // 返回 (文件名, 是否由调用方负责写入)。
+    fn claim(&self, hash: u64, ext: &str) -> (String, bool) {
+        let mut map = self.map.lock().unwrap();
+        let existing = map.get(&hash).cloned();
+        stats::cache_lookup(TextureCacheKind::Files, existing.is_some());
+        if let Some(existing) = existing {
+            return (existing, false);
+        }
+        let filename = format!("tex_{hash:016x}.{ext}");
+        map.insert(hash, filename.clone());
+        (filename, true)
+    }
 }
 
 pub enum TextureMode<'a> {
     Embed,
-    External(&'a mut TextureCache),
+    External(&'a TextureCache),
+}
+
+// GLB 的写出位置：独立文件，或 3TZ 归档中的一个条目（归档内路径）。
+pub enum GlbTarget<'a> {
+    File(&'a Path),
+    Archive(&'a TileArchive, &'a str),
 }
 
 struct TextureRef {
@@ -43,7 +109,7 @@ struct TextureRef {
 }
 
 enum ImageEntry {
-    Embedded(ImageData),
+    Embedded(Arc<EncodedTexture>),
     External {
         uri: String,
         mime_type: String,
@@ -54,101 +120,92 @@ enum ImageEntry {
 impl ImageEntry {
     fn has_alpha(&self) -> bool {
         match self {
-            ImageEntry::Embedded(image) => image.has_alpha,
+            ImageEntry::Embedded(texture) => texture.image.has_alpha,
             ImageEntry::External { has_alpha, .. } => *has_alpha,
         }
     }
 }
 
-pub fn write_glb(scene: &SceneData, path: &Path) -> Result<()> {
+pub fn write_glb(
+    scene: &SceneData,
+    registry: &TextureRegistry,
+    path: &Path,
+    options: &GlbOptions,
+) -> Result<()> {
     let mut mode = TextureMode::Embed;
-    write_glb_with_textures(scene, path, &mut mode)
+    write_glb_with_textures(scene, registry, GlbTarget::File(path), &mut mode, options, &[])
 }
 
+// texture_lods[i] 为第 i 个材质使用的纹理降采样级别（见 TextureRegistry::get_lod），缺省为原图。
 pub fn write_glb_with_textures(
     scene: &SceneData,
-    path: &Path,
+    registry: &TextureRegistry,
+    target: GlbTarget,
     texture_mode: &mut TextureMode,
+    options: &GlbOptions,
+    texture_lods: &[u32],
 ) -> Result<()> {
-    let mut buffer = BufferBuilder::default();
+    let _span = stats::span("write_glb");
+    let mut buffer = BufferBuilder::new(options.compression);
     let mut buffer_views = Vec::new();
     let mut accessors = Vec::new();
-    let mut primitives = Vec::new();
-
-    for part in &scene.parts {
-        if part.positions.is_empty() {
-            continue;
+    let mut meshes = Vec::new();
+    let mut nodes = Vec::new();
+    let mut extensions = Vec::new();
+    let quantizer = options.quantize.then(|| PositionQuantizer::new(&scene.parts));
+
+    let primitives = push_mesh_primitives(
+        &mut buffer,
+        &mut buffer_views,
+        &mut accessors,
+        quantizer.as_ref(),
+        scene,
+        &scene.parts,
+    )?;
+    if !primitives.is_empty() {
+        let mut node = json!({ "mesh": meshes.len() });
+        if let Some(quantizer) = &quantizer {
+            // 量化后的整数位置经节点的平移 + 均匀缩放还原为原始坐标；均匀缩放不影响法线方向。
+            node["translation"] = json!(quantizer.center);
+            node["scale"] = json!([quantizer.step, quantizer.step, quantizer.step]);
         }
-        let positions = &part.positions;
-        let vertex_count = positions.len() / 3;
-        let normals = ensure_normals(positions, &part.normals);
-        let uvs = ensure_uvs(vertex_count, &part.uvs);
-        let colors = ensure_colors(vertex_count, &part.colors);
-        let tangents = compute_tangents(positions, &uvs, &normals);
+        meshes.push(json!({ "primitives": primitives }));
+        nodes.push(node);
+    }
 
-        let (pos_accessor, min, max) = push_accessor_vec3(
+    // 每个实例化网格写成一个 mesh 与一个带 EXT_mesh_gpu_instancing 的节点。实例变换先于节点变换生效，
+    // 所以原型各用自己的量化网格，反量化的平移与缩放并入每个实例的变换。
+    for mesh in &scene.instanced {
+        let mesh_quantizer = options.quantize.then(|| PositionQuantizer::new(&mesh.parts));
+        let primitives = push_mesh_primitives(
             &mut buffer,
             &mut buffer_views,
             &mut accessors,
-            positions,
-            TARGET_ARRAY_BUFFER,
+            mesh_quantizer.as_ref(),
+            scene,
+            &mesh.parts,
         )?;
-        update_accessor_bounds(&mut accessors[pos_accessor], min, max);
-
-        let normal_accessor = push_accessor_vec3(
-            &mut buffer,
-            &mut buffer_views,
-            &mut accessors,
-            &normals,
-            TARGET_ARRAY_BUFFER,
-        )?
-        .0;
-        let uv_accessor = push_accessor_vec2(
-            &mut buffer,
-            &mut buffer_views,
-            &mut accessors,
-            &uvs,
-            TARGET_ARRAY_BUFFER,
-        )?
-        .0;
-        let color_accessor = push_accessor_vec4(
-            &mut buffer,
-            &mut buffer_views,
-            &mut accessors,
-            &colors,
-            TARGET_ARRAY_BUFFER,
-        )?
-        .0;
-        let tangent_accessor = push_accessor_vec4(
+        if primitives.is_empty() || mesh.instances.is_empty() {
+            continue;
+        }
+        let attributes = push_instance_attributes(
             &mut buffer,
             &mut buffer_views,
             &mut accessors,
-            &tangents,
-            TARGET_ARRAY_BUFFER,
-        )?
-        .0;
-
-        let mut attributes = Map::new();
-        attributes.insert("POSITION".to_string(), json!(pos_accessor));
-        attributes.insert("NORMAL".to_string(), json!(normal_accessor));
-        attributes.insert("TEXCOORD_0".to_string(), json!(uv_accessor));
-        attributes.insert("COLOR_0".to_string(), json!(color_accessor));
-        attributes.insert("TANGENT".to_string(), json!(tangent_accessor));
-
-        let material_index = if part.material_index < scene.materials.len() {
-            part.material_index
-        } else {
-            0
-        };
-
-        primitives.push(json!({
-            "attributes": Value::Object(attributes),
-            "material": material_index,
-            "mode": 4
+            &mesh.instances,
+            mesh_quantizer.as_ref(),
+        );
+        nodes.push(json!({
+            "mesh": meshes.len(),
+            "extensions": { EXT_MESH_GPU_INSTANCING: { "attributes": attributes } }
         }));
+        meshes.push(json!({ "primitives": primitives }));
+        if !extensions.contains(&EXT_MESH_GPU_INSTANCING) {
+            extensions.push(EXT_MESH_GPU_INSTANCING);
+        }
     }
 
-    if primitives.is_empty() {
+    if nodes.is_empty() {
         bail!("no primitives generated");
     }
 
@@ -167,33 +224,40 @@ pub fn write_glb_with_textures(
     }));
 
     let mut materials = Vec::new();
-    for material in &scene.materials {
+    for (material_index, material) in scene.materials.iter().enumerate() {
+        let lod = texture_lods.get(material_index).copied().unwrap_or(0);
         let base_color_texture = texture_index(
             &material.base_color_texture,
+            registry,
             &mut images,
             &mut textures,
             &mut image_map,
             &mut texture_map,
             sampler_index,
             texture_mode,
+            lod,
         )?;
         let normal_texture = texture_index(
             &material.normal_texture,
+            registry,
             &mut images,
             &mut textures,
             &mut image_map,
             &mut texture_map,
             sampler_index,
             texture_mode,
+            lod,
         )?;
         let emissive_texture = texture_index(
             &material.emissive_texture,
+            registry,
             &mut images,
             &mut textures,
             &mut image_map,
             &mut texture_map,
             sampler_index,
             texture_mode,
+            lod,
         )?;
 
         let mut pbr = json!({
@@ -222,7 +286,7 @@ pub fn write_glb_with_textures(
         if has_texture {
             material_value["doubleSided"] = json!(true);
         }
-        if base_color_has_alpha || material.base_color[3] < 0.999 {
+        if base_color_has_alpha || material.blend || material.base_color[3] < 0.999 {
             material_value["alphaMode"] = json!("BLEND");
         }
 
@@ -255,9 +319,11 @@ pub fn write_glb_with_textures(
     let mut images_json = Vec::new();
     for image in &images {
         match image {
-            ImageEntry::Embedded(data) => {
-                let (view_index, _) = buffer.push_bytes(&mut buffer_views, &data.bytes, None)?;
-                images_json.push(json!({ "bufferView": view_index, "mimeType": data.mime_type }));
+            ImageEntry::Embedded(texture) => {
+                let segment = BinSegment::Image(Arc::clone(texture));
+                let (view_index, _) = buffer.push_segment(&mut buffer_views, segment, None);
+                let mime_type = &texture.image.mime_type;
+                images_json.push(json!({ "bufferView": view_index, "mimeType": mime_type }));
             }
             ImageEntry::External { uri, mime_type, .. } => {
                 images_json.push(json!({ "uri": uri, "mimeType": mime_type }));
@@ -265,9 +331,18 @@ pub fn write_glb_with_textures(
         }
     }
 
-    let buffers = vec![json!({ "byteLength": buffer.data.len() })];
+    let mut buffers = vec![json!({ "byteLength": buffer.len })];
+    if buffer.fallback_len > 0 {
+        // 回退缓冲只声明解压后的总长度，不带数据；extensionsRequired 保证不会被直接读取。
+        buffers.push(json!({
+            "byteLength": buffer.fallback_len,
+            "extensions": { EXT_MESHOPT_COMPRESSION: { "fallback": true } }
+        }));
+        extensions.push(EXT_MESHOPT_COMPRESSION);
+    }
 
-    let gltf = json!({
+    let scene_nodes: Vec<usize> = (0..nodes.len()).collect();
+    let mut gltf = json!({
         "asset": {
             "version": "2.0",
             "generator": "ufbx_rust"
@@ -279,49 +354,223 @@ pub fn write_glb_with_textures(
         "samplers": samplers,
         "textures": textures,
         "materials": materials,
-        "meshes": [ { "primitives": primitives } ],
-        "nodes": [ { "mesh": 0 } ],
-        "scenes": [ { "nodes": [0] } ],
+        "meshes": meshes,
+        "scenes": [ { "nodes": scene_nodes } ],
         "scene": 0
     });
+    if quantizer.is_some() {
+        extensions.push(EXT_MESH_QUANTIZATION);
+    }
+    if !extensions.is_empty() {
+        gltf["extensionsUsed"] = json!(extensions);
+        gltf["extensionsRequired"] = json!(extensions);
+    }
+    gltf["nodes"] = Value::Array(nodes);
+
+    write_glb_container(target, gltf, buffer)
+}
+
+// 一组 part 各写成一个图元（跳过空网格），返回 primitives JSON。
+fn push_mesh_primitives<'a>(
+    buffer: &mut BufferBuilder<'a>,
+    buffer_views: &mut Vec<Value>,
+    accessors: &mut Vec<Value>,
+    quantizer: Option<&PositionQuantizer>,
+    scene: &SceneData,
+    parts: &'a [MeshPart],
+) -> Result<Vec<Value>> {
+    let mut primitives = Vec::new();
+    for part in parts {
+        if part.positions.is_empty() {
+            continue;
+        }
+        // 压缩前先重排。重排结果只活到本次迭代，而压缩视图的数据已编码为自有字节，
+        // 所以先写入局部 builder 再并入，未压缩的属性则直接借用源网格、写出时才转换。
+        let primitive = if buffer.compression.is_some() && !part.indices.is_empty() {
+            let optimized = optimize_mesh_part(part);
+            let mut local = buffer.fork();
+            let primitive =
+                push_primitive(&mut local, buffer_views, accessors, quantizer, scene, &optimized)?;
+            buffer.join(local);
+            primitive
+        } else {
+            push_primitive(buffer, buffer_views, accessors, quantizer, scene, part)?
+        };
+        primitives.push(primitive);
+    }
+    Ok(primitives)
+}
+
+// 实例的 TRANSLATION / ROTATION / SCALE（f32）访问器，返回扩展的 attributes JSON。
+// 原型量化时 p = center + step * q，实例变换 T + R (S p) 折算为 (T + R (S center)) + R ((S step) q)。
+fn push_instance_attributes(
+    buffer: &mut BufferBuilder<'_>,
+    buffer_views: &mut Vec<Value>,
+    accessors: &mut Vec<Value>,
+    instances: &[InstanceTransform],
+    quantizer: Option<&PositionQuantizer>,
+) -> Value {
+    let mut translations = Vec::with_capacity(instances.len() * 3);
+    let mut rotations = Vec::with_capacity(instances.len() * 4);
+    let mut scales = Vec::with_capacity(instances.len() * 3);
+    for instance in instances {
+        let (translation, scale) = match quantizer {
+            Some(quantizer) => {
+                let center = quantizer.center.map(f64::from);
+                let step = quantizer.step as f64;
+                (instance.transform_point(center), instance.scale.map(|value| value * step))
+            }
+            None => (instance.translation, instance.scale),
+        };
+        translations.extend(translation.map(|value| value as f32));
+        rotations.extend(instance.rotation.map(|value| value as f32));
+        scales.extend(scale.map(|value| value as f32));
+    }
+
+    let mut push = |data: Vec<f32>, element_type: &str| {
+        let count = data.len() / if element_type == "VEC4" { 4 } else { 3 };
+        let segment = BinSegment::F32(Cow::Owned(data));
+        let (view_index, _) = buffer.push_segment(buffer_views, segment, None);
+        push_accessor(accessors, view_index, COMPONENT_FLOAT, false, count, element_type)
+    };
+    json!({
+        "TRANSLATION": push(translations, "VEC3"),
+        "ROTATION": push(rotations, "VEC4"),
+        "SCALE": push(scales, "VEC3")
+    })
+}
+
+// 一个图元的属性与索引视图，返回 primitive JSON。
+fn push_primitive<'a>(
+    buffer: &mut BufferBuilder<'a>,
+    buffer_views: &mut Vec<Value>,
+    accessors: &mut Vec<Value>,
+    quantizer: Option<&PositionQuantizer>,
+    scene: &SceneData,
+    part: &'a MeshPart,
+) -> Result<Value> {
+    let positions = &part.positions[..];
+    let vertex_count = positions.len() / 3;
+    let indices = &part.indices[..];
+    let material_index = if part.material_index < scene.materials.len() {
+        part.material_index
+    } else {
+        0
+    };
+    let normals = ensure_normals(positions, &part.normals, indices);
+    let textured = scene.materials.get(material_index).is_some_and(|material| {
+        material.base_color_texture.is_some()
+            || material.normal_texture.is_some()
+            || material.emissive_texture.is_some()
+    });
+    let uvs = ensure_uvs(vertex_count, &part.uvs, textured);
+    let colors = (part.colors.len() == vertex_count * 4).then_some(&part.colors[..]);
+    let tangents = (part.tangents.len() == vertex_count * 4).then_some(&part.tangents[..]);
+
+    let accessors_out = match quantizer {
+        Some(quantizer) => push_quantized_attributes(
+            buffer,
+            buffer_views,
+            accessors,
+            quantizer,
+            positions,
+            &normals,
+            uvs,
+            colors,
+            tangents,
+        )?,
+        None => push_float_attributes(
+            buffer,
+            buffer_views,
+            accessors,
+            positions,
+            normals,
+            uvs,
+            colors,
+            tangents,
+        )?,
+    };
+
+    let mut attributes = Map::new();
+    attributes.insert("POSITION".to_string(), json!(accessors_out.position));
+    attributes.insert("NORMAL".to_string(), json!(accessors_out.normal));
+    if let Some(accessor) = accessors_out.uv {
+        attributes.insert("TEXCOORD_0".to_string(), json!(accessor));
+    }
+    if let Some(accessor) = accessors_out.color {
+        attributes.insert("COLOR_0".to_string(), json!(accessor));
+    }
+    if let Some(accessor) = accessors_out.tangent {
+        attributes.insert("TANGENT".to_string(), json!(accessor));
+    }
+
+    let mut primitive = json!({
+        "attributes": Value::Object(attributes),
+        "material": material_index,
+        "mode": 4
+    });
+    if !indices.is_empty() {
+        let index_accessor =
+            push_accessor_indices(buffer, buffer_views, accessors, indices, vertex_count)?;
+        primitive["indices"] = json!(index_accessor);
+    }
+    Ok(primitive)
+}
 
-    write_glb_container(path, gltf, buffer.data)
+// 先写临时文件再改名：批量转换时多个 tileset 可能共用同一纹理目录，
+// 并发写同名纹理时读者不会看到写了一半的文件。
+fn write_texture_file(path: &Path, bytes: &[u8]) -> Result<()> {
+    static NEXT_TEMP: AtomicUsize = AtomicUsize::new(0);
+    let temp = path.with_extension(format!(
+        "tmp{}_{}",
+        std::process::id(),
+        NEXT_TEMP.fetch_add(1, Ordering::Relaxed)
+    ));
+    fs::write(&temp, bytes).with_context(|| format!("write texture {}", temp.display()))?;
+    fs::rename(&temp, path).with_context(|| format!("write texture {}", path.display()))
 }
 
 fn texture_index(
     texture: &Option<TextureSource>,
+    registry: &TextureRegistry,
     images: &mut Vec<ImageEntry>,
     textures: &mut Vec<Value>,
     image_map: &mut HashMap<u64, usize>,
     texture_map: &mut HashMap<usize, usize>,
     sampler_index: usize,
     texture_mode: &mut TextureMode,
+    lod: u32,
 ) -> Result<Option<TextureRef>> {
     let Some(texture) = texture else {
         return Ok(None);
     };
 
-    let Some(image) = encode_texture(texture)? else {
+    let Some(encoded) = registry.get_lod(texture, lod)? else {
         return Ok(None);
     };
-    let hash = hash_bytes(&image.bytes);
+    let hash = encoded.hash;
 
     let image_index = if let Some(existing) = image_map.get(&hash) {
         *existing
     } else {
         let entry = match texture_mode {
-            TextureMode::Embed => ImageEntry::Embedded(image),
+            TextureMode::Embed => ImageEntry::Embedded(encoded),
             TextureMode::External(cache) => {
+                let image = &encoded.image;
                 let ext = if image.mime_type == "image/png" { "png" } else { "jpg" };
-                let filename = cache
-                    .map
-                    .entry(hash)
-                    .or_insert_with(|| format!("tex_{hash:016x}.{ext}"))
-                    .clone();
-                let path = cache.dir.join(&filename);
-                if !path.exists() {
-                    fs::write(&path, &image.bytes)
-                        .with_context(|| format!("write texture {}", path.display()))?;
+                let (filename, owner) = cache.claim(hash, ext);
+                if owner {
+                    match &cache.store {
+                        TextureStore::Dir(dir) => {
+                            let path = dir.join(&filename);
+                            if !path.exists() {
+                                write_texture_file(&path, &image.bytes)?;
+                            }
+                        }
+                        TextureStore::Archive(archive, dir) => {
+                            archive.add(&format!("{dir}/{filename}"), &image.bytes)?;
+                        }
+                    }
                 }
                 let prefix = cache.uri_prefix.trim_end_matches('/');
                 let uri = if prefix.is_empty() {
@@ -331,7 +580,7 @@ fn texture_index(
                 };
                 ImageEntry::External {
                     uri,
-                    mime_type: image.mime_type,
+                    mime_type: image.mime_type.clone(),
                     has_alpha: image.has_alpha,
                 }
             }
@@ -362,183 +611,306 @@ fn texture_index(
     }))
 }
 
-fn hash_bytes(bytes: &[u8]) -> u64 {
-    let mut hasher = DefaultHasher::new();
-    bytes.hash(&mut hasher);
-    hasher.finish()
+fn ensure_normals<'a>(positions: &[f32], normals: &'a [f32], indices: &[u32]) -> Cow<'a, [f32]> {
+    if normals.len() == positions.len() && !normals.is_empty() {
+        return Cow::Borrowed(normals);
+    }
+    Cow::Owned(generate_normals(positions, indices))
 }
 
-fn ensure_normals(positions: &[f32], normals: &[f32]) -> Vec<f32> {
-    if normals.len() == positions.len() && !normals.is_empty() {
-        return normals.to_vec();
+fn triangle_count(vertex_count: usize, indices: &[u32]) -> usize {
+    if indices.is_empty() {
+        vertex_count / 3
+    } else {
+        indices.len() / 3
     }
-    generate_flat_normals(positions)
 }
 
-fn ensure_uvs(vertex_count: usize, uvs: &[f32]) -> Vec<f32> {
-    if uvs.len() == vertex_count * 2 {
-        return uvs.to_vec();
+fn triangle_vertices(indices: &[u32], tri: usize) -> [usize; 3] {
+    if indices.is_empty() {
+        [tri * 3, tri * 3 + 1, tri * 3 + 2]
+    } else {
+        [
+            indices[tri * 3] as usize,
+            indices[tri * 3 + 1] as usize,
+            indices[tri * 3 + 2] as usize,
+        ]
     }
-    vec![0.0; vertex_count * 2]
 }
 
-fn ensure_colors(vertex_count: usize, colors: &[f32]) -> Vec<f32> {
-    if colors.len() == vertex_count * 4 {
-        return colors.to_vec();
+// 缺少 UV 时省略 TEXCOORD_0；只有材质引用纹理时才补零，保证纹理仍有坐标可用。
+fn ensure_uvs(vertex_count: usize, uvs: &[f32], textured: bool) -> Option<Cow<'_, [f32]>> {
+    if uvs.len() == vertex_count * 2 && vertex_count > 0 {
+        return Some(Cow::Borrowed(uvs));
     }
-    vec![1.0; vertex_count * 4]
+    textured.then(|| Cow::Owned(vec![0.0; vertex_count * 2]))
 }
 
-fn generate_flat_normals(positions: &[f32]) -> Vec<f32> {
+// 无索引时每个三角形独占顶点，结果即为平面法线；有索引时按面积加权累加到共享顶点。
+fn generate_normals(positions: &[f32], indices: &[u32]) -> Vec<f32> {
     let vertex_count = positions.len() / 3;
     let mut normals = vec![0.0f32; vertex_count * 3];
 
-    for tri in (0..vertex_count).step_by(3) {
-        let p0 = vec3_from_slice(positions, tri * 3);
-        let p1 = vec3_from_slice(positions, (tri + 1) * 3);
-        let p2 = vec3_from_slice(positions, (tri + 2) * 3);
+    for tri in 0..triangle_count(vertex_count, indices) {
+        let [i0, i1, i2] = triangle_vertices(indices, tri);
+        let p0 = vec3_from_slice(positions, i0 * 3);
+        let p1 = vec3_from_slice(positions, i1 * 3);
+        let p2 = vec3_from_slice(positions, i2 * 3);
 
         let e1 = [p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]];
         let e2 = [p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]];
 
-        let mut n = [
+        let n = [
             e1[1] * e2[2] - e1[2] * e2[1],
             e1[2] * e2[0] - e1[0] * e2[2],
             e1[0] * e2[1] - e1[1] * e2[0],
         ];
+
+        for idx in [i0, i1, i2] {
+            normals[idx * 3 + 0] += n[0];
+            normals[idx * 3 + 1] += n[1];
+            normals[idx * 3 + 2] += n[2];
+        }
+    }
+
+    for n in normals.chunks_mut(3) {
         let len = (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]).sqrt();
         if len > f32::EPSILON {
             n[0] /= len;
             n[1] /= len;
             n[2] /= len;
         } else {
-            n = [0.0, 1.0, 0.0];
-        }
-
-        for v in 0..3 {
-            let idx = tri + v;
-            normals[idx * 3 + 0] = n[0];
-            normals[idx * 3 + 1] = n[1];
-            normals[idx * 3 + 2] = n[2];
+            n.copy_from_slice(&[0.0, 1.0, 0.0]);
         }
     }
 
     normals
 }
 
-fn compute_tangents(positions: &[f32], uvs: &[f32], normals: &[f32]) -> Vec<f32> {
-    let vertex_count = positions.len() / 3;
-    if vertex_count == 0 {
-        return Vec::new();
-    }
-
-    let mut tangents = vec![0.0f32; vertex_count * 4];
-
-    for tri in (0..vertex_count).step_by(3) {
-        let p0 = vec3_from_slice(positions, tri * 3);
-        let p1 = vec3_from_slice(positions, (tri + 1) * 3);
-        let p2 = vec3_from_slice(positions, (tri + 2) * 3);
-
-        let uv0 = vec2_from_slice(uvs, tri * 2);
-        let uv1 = vec2_from_slice(uvs, (tri + 1) * 2);
-        let uv2 = vec2_from_slice(uvs, (tri + 2) * 2);
-
-        let edge1 = [p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]];
-        let edge2 = [p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]];
-
-        let delta_uv1 = [uv1[0] - uv0[0], uv1[1] - uv0[1]];
-        let delta_uv2 = [uv2[0] - uv0[0], uv2[1] - uv0[1]];
-
-        let denom = delta_uv1[0] * delta_uv2[1] - delta_uv1[1] * delta_uv2[0];
-        let (tangent, bitangent) = if denom.abs() > f32::EPSILON {
-            let r = 1.0 / denom;
-            let tangent = [
-                (edge1[0] * delta_uv2[1] - edge2[0] * delta_uv1[1]) * r,
-                (edge1[1] * delta_uv2[1] - edge2[1] * delta_uv1[1]) * r,
-                (edge1[2] * delta_uv2[1] - edge2[2] * delta_uv1[1]) * r,
-            ];
-            let bitangent = [
-                (edge2[0] * delta_uv1[0] - edge1[0] * delta_uv2[0]) * r,
-                (edge2[1] * delta_uv1[0] - edge1[1] * delta_uv2[0]) * r,
-                (edge2[2] * delta_uv1[0] - edge1[2] * delta_uv2[0]) * r,
-            ];
-            (tangent, bitangent)
-        } else {
-            ([1.0, 0.0, 0.0], [0.0, 1.0, 0.0])
-        };
+fn vec3_from_slice(data: &[f32], start: usize) -> [f32; 3] {
+    if data.len() >= start + 3 {
+        [data[start], data[start + 1], data[start + 2]]
+    } else {
+        [0.0, 1.0, 0.0]
+    }
+}
+
+// 一个图元的顶点属性 accessor 索引；可选属性缺失时为 None，不写入 attributes。
+struct AttributeAccessors {
+    position: usize,
+    normal: usize,
+    uv: Option<usize>,
+    color: Option<usize>,
+    tangent: Option<usize>,
+}
 
-        for v in 0..3 {
-            let idx = tri + v;
-            let normal = vec3_from_slice(normals, idx * 3);
-            let t = orthonormalize(normal, tangent);
-            let w = handedness(normal, t, bitangent);
-            tangents[idx * 4 + 0] = t[0];
-            tangents[idx * 4 + 1] = t[1];
-            tangents[idx * 4 + 2] = t[2];
-            tangents[idx * 4 + 3] = w;
+#[allow(clippy::too_many_arguments)]
+fn push_float_attributes<'a>(
+    buffer: &mut BufferBuilder<'a>,
+    buffer_views: &mut Vec<Value>,
+    accessors: &mut Vec<Value>,
+    positions: &'a [f32],
+    normals: Cow<'a, [f32]>,
+    uvs: Option<Cow<'a, [f32]>>,
+    colors: Option<&'a [f32]>,
+    tangents: Option<&'a [f32]>,
+) -> Result<AttributeAccessors> {
+    let (position, min, max) =
+        push_accessor_vec3(buffer, buffer_views, accessors, positions.into())?;
+    update_accessor_bounds(&mut accessors[position], min, max);
+    let normal = push_accessor_vec3(buffer, buffer_views, accessors, normals)?.0;
+    let uv = match uvs {
+        Some(uvs) => Some(push_accessor_vec2(buffer, buffer_views, accessors, uvs)?.0),
+        None => None,
+    };
+    let color = match colors {
+        Some(colors) => {
+            Some(push_accessor_vec4(buffer, buffer_views, accessors, colors.into())?.0)
         }
-    }
+        None => None,
+    };
+    let tangent = match tangents {
+        Some(tangents) => {
+            Some(push_accessor_vec4(buffer, buffer_views, accessors, tangents.into())?.0)
+        }
+        None => None,
+    };
+    Ok(AttributeAccessors {
+        position,
+        normal,
+        uv,
+        color,
+        tangent,
+    })
+}
 
-    tangents
+// 一个 mesh 内共用一个量化网格：q = round((p - center) / step)，step 取最大半轴 / 32767。
+struct PositionQuantizer {
+    center: [f32; 3],
+    step: f32,
 }
 
-fn vec2_from_slice(data: &[f32], start: usize) -> [f32; 2] {
-    if data.len() >= start + 2 {
-        [data[start], data[start + 1]]
-    } else {
-        [0.0, 0.0]
+impl PositionQuantizer {
+    fn new(parts: &[MeshPart]) -> Self {
+        let mut min = [f32::INFINITY; 3];
+        let mut max = [f32::NEG_INFINITY; 3];
+        for part in parts {
+            if part.positions.is_empty() {
+                continue;
+            }
+            let (part_min, part_max) = min_max_vec3(&part.positions);
+            for axis in 0..3 {
+                min[axis] = min[axis].min(part_min[axis]);
+                max[axis] = max[axis].max(part_max[axis]);
+            }
+        }
+        if min[0] > max[0] {
+            return Self {
+                center: [0.0; 3],
+                step: 1.0,
+            };
+        }
+        let center = [
+            0.5 * (min[0] + max[0]),
+            0.5 * (min[1] + max[1]),
+            0.5 * (min[2] + max[2]),
+        ];
+        let half = (0..3)
+            .map(|axis| 0.5 * (max[axis] - min[axis]))
+            .fold(0.0f32, f32::max);
+        let step = if half > 0.0 { half / i16::MAX as f32 } else { 1.0 };
+        Self { center, step }
+    }
+
+    fn quantize(&self, value: f32, axis: usize) -> i16 {
+        ((value - self.center[axis]) / self.step)
+            .round()
+            .clamp(-(i16::MAX as f32), i16::MAX as f32) as i16
     }
 }
 
-fn vec3_from_slice(data: &[f32], start: usize) -> [f32; 3] {
-    if data.len() >= start + 3 {
-        [data[start], data[start + 1], data[start + 2]]
-    } else {
-        [0.0, 1.0, 0.0]
+#[allow(clippy::too_many_arguments)]
+fn push_quantized_attributes<'a>(
+    buffer: &mut BufferBuilder<'a>,
+    buffer_views: &mut Vec<Value>,
+    accessors: &mut Vec<Value>,
+    quantizer: &PositionQuantizer,
+    positions: &[f32],
+    normals: &[f32],
+    uvs: Option<Cow<'a, [f32]>>,
+    colors: Option<&[f32]>,
+    tangents: Option<&[f32]>,
+) -> Result<AttributeAccessors> {
+    let vertex_count = positions.len() / 3;
+
+    // 位置：i16 VEC3，按 8 字节步长对齐。min/max 为量化后的整数值。
+    let mut bytes = Vec::with_capacity(vertex_count * 8);
+    let mut min = [i16::MAX; 3];
+    let mut max = [i16::MIN; 3];
+    for p in positions.chunks_exact(3) {
+        for axis in 0..3 {
+            let q = quantizer.quantize(p[axis], axis);
+            min[axis] = min[axis].min(q);
+            max[axis] = max[axis].max(q);
+            bytes.extend_from_slice(&q.to_le_bytes());
+        }
+        bytes.extend_from_slice(&[0, 0]);
     }
+    let view = buffer.push_vertex_bytes(buffer_views, bytes, 8)?;
+    let pos_accessor = push_accessor(accessors, view, COMPONENT_SHORT, false, vertex_count, "VEC3");
+    accessors[pos_accessor]["min"] = json!(min);
+    accessors[pos_accessor]["max"] = json!(max);
+
+    let view = buffer.push_vertex_bytes(buffer_views, encode_snorm8(normals, 3), 4)?;
+    let normal_accessor = push_accessor(accessors, view, COMPONENT_BYTE, true, vertex_count, "VEC3");
+
+    // 归一化 u16 只能表示 [0, 1]；平铺纹理的 UV 保留 f32。
+    let uv_accessor = match uvs {
+        Some(uvs) if uvs.iter().all(|v| (0.0..=1.0).contains(v)) => {
+            let bytes: Vec<u8> = uvs
+                .iter()
+                .flat_map(|v| ((v * u16::MAX as f32).round() as u16).to_le_bytes())
+                .collect();
+            let view = buffer.push_vertex_bytes(buffer_views, bytes, 4)?;
+            let kind = COMPONENT_UNSIGNED_SHORT;
+            Some(push_accessor(accessors, view, kind, true, vertex_count, "VEC2"))
+        }
+        Some(uvs) => Some(push_accessor_vec2(buffer, buffer_views, accessors, uvs)?.0),
+        None => None,
+    };
+
+    let color_accessor = match colors {
+        Some(colors) => {
+            let bytes: Vec<u8> = colors
+                .iter()
+                .map(|v| (v.clamp(0.0, 1.0) * u8::MAX as f32).round() as u8)
+                .collect();
+            let view = buffer.push_vertex_bytes(buffer_views, bytes, 4)?;
+            let kind = COMPONENT_UNSIGNED_BYTE;
+            Some(push_accessor(accessors, view, kind, true, vertex_count, "VEC4"))
+        }
+        None => None,
+    };
+
+    let tangent_accessor = match tangents {
+        Some(tangents) => {
+            let view = buffer.push_vertex_bytes(buffer_views, encode_snorm8(tangents, 4), 4)?;
+            Some(push_accessor(accessors, view, COMPONENT_BYTE, true, vertex_count, "VEC4"))
+        }
+        None => None,
+    };
+
+    Ok(AttributeAccessors {
+        position: pos_accessor,
+        normal: normal_accessor,
+        uv: uv_accessor,
+        color: color_accessor,
+        tangent: tangent_accessor,
+    })
 }
 
-fn orthonormalize(normal: [f32; 3], tangent: [f32; 3]) -> [f32; 3] {
-    let dot = normal[0] * tangent[0] + normal[1] * tangent[1] + normal[2] * tangent[2];
-    let mut t = [
-        tangent[0] - normal[0] * dot,
-        tangent[1] - normal[1] * dot,
-        tangent[2] - normal[2] * dot,
-    ];
-    let len = (t[0] * t[0] + t[1] * t[1] + t[2] * t[2]).sqrt();
-    if len > f32::EPSILON {
-        t[0] /= len;
-        t[1] /= len;
-        t[2] /= len;
-    } else {
-        t = [1.0, 0.0, 0.0];
+// 有符号归一化 i8，每个元素补齐到 4 字节。
+fn encode_snorm8(data: &[f32], components: usize) -> Vec<u8> {
+    let mut bytes = Vec::with_capacity(data.len() / components * 4);
+    for element in data.chunks_exact(components) {
+        for &value in element {
+            bytes.push((value.clamp(-1.0, 1.0) * i8::MAX as f32).round() as i8 as u8);
+        }
+        bytes.resize(bytes.len() + 4 - components, 0);
     }
-    t
+    bytes
 }
 
-fn handedness(normal: [f32; 3], tangent: [f32; 3], bitangent: [f32; 3]) -> f32 {
-    let cross = [
-        normal[1] * tangent[2] - normal[2] * tangent[1],
-        normal[2] * tangent[0] - normal[0] * tangent[2],
-        normal[0] * tangent[1] - normal[1] * tangent[0],
-    ];
-    let dot = cross[0] * bitangent[0] + cross[1] * bitangent[1] + cross[2] * bitangent[2];
-    if dot < 0.0 {
-        -1.0
-    } else {
-        1.0
+fn push_accessor(
+    accessors: &mut Vec<Value>,
+    view_index: usize,
+    component_type: u32,
+    normalized: bool,
+    count: usize,
+    element_type: &str,
+) -> usize {
+    let mut accessor = json!({
+        "bufferView": view_index,
+        "componentType": component_type,
+        "count": count,
+        "type": element_type
+    });
+    if normalized {
+        accessor["normalized"] = json!(true);
     }
+    accessors.push(accessor);
+    accessors.len() - 1
 }
 
-fn push_accessor_vec3(
-    buffer: &mut BufferBuilder,
+fn push_accessor_vec3<'a>(
+    buffer: &mut BufferBuilder<'a>,
     buffer_views: &mut Vec<Value>,
     accessors: &mut Vec<Value>,
-    data: &[f32],
-    target: u32,
+    data: Cow<'a, [f32]>,
 ) -> Result<(usize, [f32; 3], [f32; 3])> {
-    let view_index = buffer.push_f32(buffer_views, data, Some(target))?;
+    let (min, max) = min_max_vec3(&data);
     let count = data.len() / 3;
+    let view_index = buffer.push_f32_attribute(buffer_views, data, 3)?;
     let accessor_index = accessors.len();
     accessors.push(json!({
         "bufferView": view_index,
@@ -546,21 +918,17 @@ fn push_accessor_vec3(
         "count": count,
         "type": "VEC3"
     }));
-
-    let (min, max) = min_max_vec3(data);
     Ok((accessor_index, min, max))
 }
 
-
-fn push_accessor_vec2(
-    buffer: &mut BufferBuilder,
+fn push_accessor_vec2<'a>(
+    buffer: &mut BufferBuilder<'a>,
     buffer_views: &mut Vec<Value>,
     accessors: &mut Vec<Value>,
-    data: &[f32],
-    target: u32,
+    data: Cow<'a, [f32]>,
 ) -> Result<(usize, usize)> {
-    let view_index = buffer.push_f32(buffer_views, data, Some(target))?;
     let count = data.len() / 2;
+    let view_index = buffer.push_f32_attribute(buffer_views, data, 2)?;
     let accessor_index = accessors.len();
     accessors.push(json!({
         "bufferView": view_index,
@@ -571,16 +939,14 @@ fn push_accessor_vec2(
     Ok((accessor_index, count))
 }
 
-
-fn push_accessor_vec4(
-    buffer: &mut BufferBuilder,
+fn push_accessor_vec4<'a>(
+    buffer: &mut BufferBuilder<'a>,
     buffer_views: &mut Vec<Value>,
     accessors: &mut Vec<Value>,
-    data: &[f32],
-    target: u32,
+    data: Cow<'a, [f32]>,
 ) -> Result<(usize, usize)> {
-    let view_index = buffer.push_f32(buffer_views, data, Some(target))?;
     let count = data.len() / 4;
+    let view_index = buffer.push_f32_attribute(buffer_views, data, 4)?;
     let accessor_index = accessors.len();
     accessors.push(json!({
         "bufferView": view_index,
@@ -591,6 +957,43 @@ fn push_accessor_vec4(
     Ok((accessor_index, count))
 }
 
+fn push_accessor_indices<'a>(
+    buffer: &mut BufferBuilder<'a>,
+    buffer_views: &mut Vec<Value>,
+    accessors: &mut Vec<Value>,
+    indices: &'a [u32],
+    vertex_count: usize,
+) -> Result<usize> {
+    // 65535 是 u16 的图元重启值，不允许作为索引出现。
+    let (view_index, component_type) = if buffer.compression.is_some() {
+        let index_size = if vertex_count <= u16::MAX as usize { 2 } else { 4 };
+        let view_index = buffer.push_compressed_indices(buffer_views, indices, index_size);
+        let component_type = if index_size == 2 {
+            COMPONENT_UNSIGNED_SHORT
+        } else {
+            COMPONENT_UNSIGNED_INT
+        };
+        (view_index, component_type)
+    } else if vertex_count <= u16::MAX as usize {
+        let segment = BinSegment::U16(indices.into());
+        let (view_index, _) =
+            buffer.push_segment(buffer_views, segment, Some(TARGET_ELEMENT_ARRAY_BUFFER));
+        (view_index, COMPONENT_UNSIGNED_SHORT)
+    } else {
+        let segment = BinSegment::U32(indices.into());
+        let (view_index, _) =
+            buffer.push_segment(buffer_views, segment, Some(TARGET_ELEMENT_ARRAY_BUFFER));
+        (view_index, COMPONENT_UNSIGNED_INT)
+    };
+    let accessor_index = accessors.len();
+    accessors.push(json!({
+        "bufferView": view_index,
+        "componentType": component_type,
+        "count": indices.len(),
+        "type": "SCALAR"
+    }));
+    Ok(accessor_index)
+}
 
 fn update_accessor_bounds(accessor: &mut Value, min: [f32; 3], max: [f32; 3]) {
     accessor["min"] = json!(min);
@@ -623,44 +1026,215 @@ fn min_max_vec3(data: &[f32]) -> ([f32; 3], [f32; 3]) {
     (min, max)
 }
 
-#[derive(Default)]
-struct BufferBuilder {
-    data: Vec<u8>,
+// BIN chunk 中的一段数据：未压缩的属性与索引只借用源网格，写出时才转为小端字节；
+// 量化、压缩后的数据与内嵌图片才持有自己的字节。
+enum BinSegment<'a> {
+    F32(Cow<'a, [f32]>),
+    // 索引按 u16 写出（调用方保证顶点数 ≤ 65535）。
+    U16(Cow<'a, [u32]>),
+    U32(Cow<'a, [u32]>),
+    Bytes(Vec<u8>),
+    Image(Arc<EncodedTexture>),
 }
 
-impl BufferBuilder {
+impl BinSegment<'_> {
+    fn byte_len(&self) -> usize {
+        match self {
+            BinSegment::F32(data) => data.len() * 4,
+            BinSegment::U16(data) => data.len() * 2,
+            BinSegment::U32(data) => data.len() * 4,
+            BinSegment::Bytes(bytes) => bytes.len(),
+            BinSegment::Image(texture) => texture.image.bytes.len(),
+        }
+    }
+
+    fn into_owned(self) -> BinSegment<'static> {
+        match self {
+            BinSegment::F32(data) => BinSegment::F32(Cow::Owned(data.into_owned())),
+            BinSegment::U16(data) => BinSegment::U16(Cow::Owned(data.into_owned())),
+            BinSegment::U32(data) => BinSegment::U32(Cow::Owned(data.into_owned())),
+            BinSegment::Bytes(bytes) => BinSegment::Bytes(bytes),
+            BinSegment::Image(texture) => BinSegment::Image(texture),
+        }
+    }
+
+    fn write_to(&self, out: &mut impl Write) -> std::io::Result<()> {
+        match self {
+            BinSegment::F32(data) => write_le(out, data, |v| v.to_le_bytes()),
+            BinSegment::U16(data) => write_le(out, data, |v| (v as u16).to_le_bytes()),
+            BinSegment::U32(data) => write_le(out, data, |v| v.to_le_bytes()),
+            BinSegment::Bytes(bytes) => out.write_all(bytes),
+            BinSegment::Image(texture) => out.write_all(&texture.image.bytes),
+        }
+    }
+}
+
+// 按块转换为小端字节后写出，避免为整段属性分配临时缓冲。
+fn write_le<T: Copy, const N: usize>(
+    out: &mut impl Write,
+    data: &[T],
+    to_bytes: impl Fn(T) -> [u8; N],
+) -> std::io::Result<()> {
+    const BLOCK_BYTES: usize = 16 * 1024;
+    let mut block = [0u8; BLOCK_BYTES];
+    for chunk in data.chunks(BLOCK_BYTES / N) {
+        for (bytes, &value) in block.chunks_exact_mut(N).zip(chunk) {
+            bytes.copy_from_slice(&to_bytes(value));
+        }
+        out.write_all(&block[..chunk.len() * N])?;
+    }
+    Ok(())
+}
+
+// 只计算 buffer 0 的布局（各段 4 字节对齐后的偏移），数据在 write_glb_container 中才写出。
+struct BufferBuilder<'a> {
+    segments: Vec<(usize, BinSegment<'a>)>,
+    len: usize,
+    compression: Option<Compression>,
+    // 压缩视图在回退缓冲中的解压后布局长度。
+    fallback_len: usize,
+}
+
+impl<'a> BufferBuilder<'a> {
+    fn new(compression: Option<Compression>) -> Self {
+        Self {
+            segments: Vec::new(),
+            len: 0,
+            compression,
+            fallback_len: 0,
+        }
+    }
+
+    // 从当前布局末尾继续的空 builder，借用更短生命周期的数据，用 join 并回。
+    fn fork<'b>(&self) -> BufferBuilder<'b> {
+        BufferBuilder {
+            segments: Vec::new(),
+            len: self.len,
+            compression: self.compression,
+            fallback_len: self.fallback_len,
+        }
+    }
+
+    fn join(&mut self, other: BufferBuilder<'_>) {
+        self.segments.extend(
+            other
+                .segments
+                .into_iter()
+                .map(|(offset, segment)| (offset, segment.into_owned())),
+        );
+        self.len = other.len;
+        self.fallback_len = other.fallback_len;
+    }
+
     fn align4(&mut self) {
-        let pad = (4 - (self.data.len() % 4)) % 4;
-        if pad > 0 {
-            self.data.extend(std::iter::repeat(0u8).take(pad));
+        self.len = self.len.next_multiple_of(4);
+    }
+
+    fn push_f32_attribute(
+        &mut self,
+        buffer_views: &mut Vec<Value>,
+        data: Cow<'a, [f32]>,
+        components: usize,
+    ) -> Result<usize> {
+        if self.compression.is_none() {
+            let segment = BinSegment::F32(data);
+            let (view_index, _) =
+                self.push_segment(buffer_views, segment, Some(TARGET_ARRAY_BUFFER));
+            return Ok(view_index);
         }
+        let bytes: Vec<u8> = data.iter().flat_map(|v| v.to_le_bytes()).collect();
+        self.push_vertex_bytes(buffer_views, bytes, components * 4)
     }
 
-    fn push_f32(
+    // 交错步长的顶点属性视图；glTF 要求步长为 4 的倍数。
+    fn push_vertex_bytes(
         &mut self,
         buffer_views: &mut Vec<Value>,
-        data: &[f32],
-        target: Option<u32>,
+        bytes: Vec<u8>,
+        stride: usize,
     ) -> Result<usize> {
-        let mut bytes = Vec::with_capacity(data.len() * 4);
-        for value in data {
-            bytes.extend_from_slice(&value.to_le_bytes());
+        if self.compression == Some(Compression::Meshopt) {
+            let encoded = encode_vertex_buffer(&bytes, stride);
+            let count = bytes.len() / stride;
+            let view_index = self.push_meshopt_view(
+                buffer_views,
+                encoded,
+                count,
+                stride,
+                "ATTRIBUTES",
+                TARGET_ARRAY_BUFFER,
+            );
+            buffer_views[view_index]["byteStride"] = json!(stride);
+            return Ok(view_index);
         }
-        let (view_index, _) = self.push_bytes(buffer_views, &bytes, target)?;
+        let segment = BinSegment::Bytes(bytes);
+        let (view_index, _) = self.push_segment(buffer_views, segment, Some(TARGET_ARRAY_BUFFER));
+        buffer_views[view_index]["byteStride"] = json!(stride);
         Ok(view_index)
     }
 
-    fn push_bytes(
+    fn push_compressed_indices(
         &mut self,
         buffer_views: &mut Vec<Value>,
-        bytes: &[u8],
+        indices: &[u32],
+        index_size: usize,
+    ) -> usize {
+        let encoded = encode_index_buffer(indices);
+        self.push_meshopt_view(
+            buffer_views,
+            encoded,
+            indices.len(),
+            index_size,
+            "TRIANGLES",
+            TARGET_ELEMENT_ARRAY_BUFFER,
+        )
+    }
+
+    // 压缩数据写入 buffer 0，视图本身指向回退缓冲中的解压后位置。
+    fn push_meshopt_view(
+        &mut self,
+        buffer_views: &mut Vec<Value>,
+        encoded: Vec<u8>,
+        count: usize,
+        stride: usize,
+        mode: &str,
+        target: u32,
+    ) -> usize {
+        let encoded_len = encoded.len();
+        let offset = self.push_raw(BinSegment::Bytes(encoded));
+
+        let fallback_offset = self.fallback_len.next_multiple_of(4);
+        let length = count * stride;
+        self.fallback_len = fallback_offset + length;
+
+        let view_index = buffer_views.len();
+        buffer_views.push(json!({
+            "buffer": 1,
+            "byteOffset": fallback_offset,
+            "byteLength": length,
+            "target": target,
+            "extensions": {
+                EXT_MESHOPT_COMPRESSION: {
+                    "buffer": 0,
+                    "byteOffset": offset,
+                    "byteLength": encoded_len,
+                    "byteStride": stride,
+                    "mode": mode,
+                    "count": count
+                }
+            }
+        }));
+        view_index
+    }
+
+    fn push_segment(
+        &mut self,
+        buffer_views: &mut Vec<Value>,
+        segment: BinSegment<'a>,
         target: Option<u32>,
-    ) -> Result<(usize, usize)> {
-        self.align4();
-        let offset = self.data.len();
-        self.data.extend_from_slice(bytes);
-        let length = bytes.len();
-        self.align4();
+    ) -> (usize, usize) {
+        let length = segment.byte_len();
+        let offset = self.push_raw(segment);
 
         let mut view = json!({
             "buffer": 0,
@@ -672,35 +1246,73 @@ impl BufferBuilder {
         }
         let view_index = buffer_views.len();
         buffer_views.push(view);
-        Ok((view_index, length))
+        (view_index, length)
     }
-}
 
+    // 按 4 字节对齐放置一段数据，返回其偏移。
+    fn push_raw(&mut self, segment: BinSegment<'a>) -> usize {
+        self.align4();
+        let offset = self.len;
+        self.len += segment.byte_len();
+        self.segments.push((offset, segment));
+        self.align4();
+        offset
+    }
+}
 
-fn write_glb_container(path: &Path, gltf: Value, mut bin: Vec<u8>) -> Result<()> {
+// 布局已知，先写头部与 JSON，再把各段数据依次写出，段间空隙补零。
+// 文件经 BufWriter 直接写出；归档条目先在内存中拼好，再整体追加到归档。
+fn write_glb_container(target: GlbTarget, gltf: Value, bin: BufferBuilder) -> Result<()> {
     let mut json_bytes = serde_json::to_vec(&gltf)?;
     pad_bytes(&mut json_bytes, 0x20);
 
-    pad_bytes(&mut bin, 0x00);
-
-    let total_length = 12 + 8 + json_bytes.len() + 8 + bin.len();
-
-    let mut file = File::create(path)
-        .with_context(|| format!("open output file {}", path.display()))?;
-
-    file.write_all(&GLTF_MAGIC.to_le_bytes())?;
-    file.write_all(&GLTF_VERSION.to_le_bytes())?;
-    file.write_all(&(total_length as u32).to_le_bytes())?;
-
-    file.write_all(&(json_bytes.len() as u32).to_le_bytes())?;
-    file.write_all(&CHUNK_TYPE_JSON.to_le_bytes())?;
-    file.write_all(&json_bytes)?;
-
-    file.write_all(&(bin.len() as u32).to_le_bytes())?;
-    file.write_all(&CHUNK_TYPE_BIN.to_le_bytes())?;
-    file.write_all(&bin)?;
+    let bin_len = bin.len.next_multiple_of(4);
+    let total_length = 12 + 8 + json_bytes.len() + 8 + bin_len;
+
+    let _span = stats::span("glb_io");
+    stats::add("glb.files", 1);
+    stats::add("glb.bytes", total_length as u64);
+    match target {
+        GlbTarget::File(path) => {
+            let file = File::create(path)
+                .with_context(|| format!("open output file {}", path.display()))?;
+            let mut out = BufWriter::with_capacity(1 << 20, file);
+            write_glb_bytes(&mut out, &json_bytes, &bin, total_length)
+                .with_context(|| format!("write output file {}", path.display()))
+        }
+        GlbTarget::Archive(archive, name) => {
+            let mut bytes = Vec::with_capacity(total_length);
+            write_glb_bytes(&mut bytes, &json_bytes, &bin, total_length)?;
+            archive.add(name, &bytes)
+        }
+    }
+}
 
-    Ok(())
+fn write_glb_bytes(
+    out: &mut impl Write,
+    json_bytes: &[u8],
+    bin: &BufferBuilder,
+    total_length: usize,
+) -> std::io::Result<()> {
+    let bin_len = bin.len.next_multiple_of(4);
+    out.write_all(&GLTF_MAGIC.to_le_bytes())?;
+    out.write_all(&GLTF_VERSION.to_le_bytes())?;
+    out.write_all(&(total_length as u32).to_le_bytes())?;
+
+    out.write_all(&(json_bytes.len() as u32).to_le_bytes())?;
+    out.write_all(&CHUNK_TYPE_JSON.to_le_bytes())?;
+    out.write_all(json_bytes)?;
+
+    out.write_all(&(bin_len as u32).to_le_bytes())?;
+    out.write_all(&CHUNK_TYPE_BIN.to_le_bytes())?;
+    let mut written = 0;
+    for (offset, segment) in &bin.segments {
+        out.write_all(&[0u8; 4][..offset - written])?;
+        segment.write_to(out)?;
+        written = offset + segment.byte_len();
+    }
+    out.write_all(&[0u8; 4][..bin_len - written])?;
+    out.flush()
 }
 
 fn pad_bytes(bytes: &mut Vec<u8>, pad: u8) {
@@ -1,14 +1,291 @@
-use crate::ufbx_loader::TextureSource;
+use crate::stats::{self, TextureCacheKind};
+use crate::ufbx_loader::{Material, TextureSource};
 use anyhow::{Context, Result};
-use image::{DynamicImage, ImageFormat};
+use image::imageops::FilterType;
+use image::{DynamicImage, ImageFormat, ImageReader, RgbaImage};
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
 use std::fs;
+use std::hash::{Hash, Hasher};
 use std::io::Cursor;
-use std::path::Path;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, OnceLock};
 
 pub struct ImageData {
     pub bytes: Vec<u8>,
     pub mime_type: String,
     pub has_alpha: bool,
+    pub width: u32,
+    pub height: u32,
+}
+
+#[derive(Clone, Copy, Debug, Default)]
+pub struct TextureOptions {
+    // 最长边上限（像素），0 表示不限制；超出时等比缩小后重新编码。
+    pub max_size: u32,
+}
+
+// 编码后的纹理及其字节哈希（用于去重与外部文件命名）。
+pub struct EncodedTexture {
+    pub image: ImageData,
+    pub hash: u64,
+}
+
+#[derive(Clone, PartialEq, Eq, Hash)]
+enum TextureKey {
+    File(PathBuf),
+    Embedded(usize),
+}
+
+impl TextureKey {
+    fn of(source: &TextureSource) -> Self {
+        match source {
+            TextureSource::File(path) => TextureKey::File(path.clone()),
+            TextureSource::Embedded { bytes, .. } => {
+                TextureKey::Embedded(bytes.as_ptr() as usize)
+            }
+        }
+    }
+}
+
+type Variant = Arc<OnceLock<Option<Arc<EncodedTexture>>>>;
+type DecodedVariant = Arc<OnceLock<Option<Arc<RgbaImage>>>>;
+
+// 场景级纹理注册表：load_scene 之后构建一次，每个纹理源只解码/编码一次，
+// 之后各 tile 直接按纹理源身份（路径或内嵌字节指针）查询结果。
+// 降采样变体（1/2、1/4…）在首次被 tile 请求时生成，按（原图哈希, 级别）缓存。
+#[derive(Default)]
+pub struct TextureRegistry {
+    entries: HashMap<TextureKey, Option<Arc<EncodedTexture>>>,
+    options: TextureOptions,
+    variants: Mutex<HashMap<(u64, u32), Variant>>,
+    // 图集烘焙用的解码像素，同样按（原图哈希, 级别）缓存。
+    decoded: Mutex<HashMap<(u64, u32), DecodedVariant>>,
+}
+
+// 跨场景共享的原图编码缓存（批量转换用）：外部文件按规范化路径、内嵌纹理按内容哈希，
+// 连同输出选项作为键；共用纹理库的多个模型只解码/编码一次。
+#[derive(Default)]
+pub struct SharedTextures {
+    encoded: Mutex<HashMap<SharedKey, SharedEntry>>,
+}
+
+#[derive(PartialEq, Eq, Hash)]
+struct SharedKey {
+    source: SharedSource,
+    max_size: u32,
+}
+
+#[derive(PartialEq, Eq, Hash)]
+enum SharedSource {
+    File(PathBuf),
+    Embedded(u64),
+}
+
+type SharedEntry = Arc<OnceLock<Result<Option<Arc<EncodedTexture>>, String>>>;
+
+impl SharedTextures {
+    // 同一键并发请求时只有一个线程编码，其余等待其结果。
+    fn encode(
+        &self,
+        source: &TextureSource,
+        options: &TextureOptions,
+    ) -> Result<Option<Arc<EncodedTexture>>> {
+        let source_key = match source {
+            TextureSource::File(path) => {
+                SharedSource::File(fs::canonicalize(path).unwrap_or_else(|_| path.clone()))
+            }
+            TextureSource::Embedded { bytes, .. } => SharedSource::Embedded(hash_bytes(bytes)),
+        };
+        let key = SharedKey {
+            source: source_key,
+            max_size: options.max_size,
+        };
+        let entry = self.encoded.lock().unwrap().entry(key).or_default().clone();
+        stats::cache_lookup(TextureCacheKind::Shared, entry.get().is_some());
+        entry
+            .get_or_init(|| {
+                encode_entry(source, options, 0).map_err(|err| format!("{err:#}"))
+            })
+            .clone()
+            .map_err(anyhow::Error::msg)
+    }
+}
+
+impl TextureRegistry {
+    pub fn build(materials: &[Material], options: TextureOptions) -> Result<Self> {
+        Self::build_with(materials, options, None)
+    }
+
+    // 原图编码经由 shared 缓存，与同一批次的其他场景共用。
+    pub fn build_shared(
+        materials: &[Material],
+        options: TextureOptions,
+        shared: &SharedTextures,
+    ) -> Result<Self> {
+        Self::build_with(materials, options, Some(shared))
+    }
+
+    fn build_with(
+        materials: &[Material],
+        options: TextureOptions,
+        shared: Option<&SharedTextures>,
+    ) -> Result<Self> {
+        let encode = |source: &TextureSource| match shared {
+            Some(shared) => shared.encode(source, &options),
+            None => encode_entry(source, &options, 0),
+        };
+        let mut registry = Self {
+            options,
+            ..Self::default()
+        };
+        // 不同材质可能各自拷贝了相同的内嵌字节，按原始内容再合并一次。
+        let mut by_content: HashMap<u64, Option<Arc<EncodedTexture>>> = HashMap::new();
+        for material in materials {
+            for source in [
+                &material.base_color_texture,
+                &material.normal_texture,
+                &material.emissive_texture,
+            ]
+            .into_iter()
+            .flatten()
+            {
+                let key = TextureKey::of(source);
+                if registry.entries.contains_key(&key) {
+                    continue;
+                }
+                let entry = match source {
+                    TextureSource::Embedded { bytes, .. } => {
+                        let content_hash = hash_bytes(bytes);
+                        let existing = by_content.get(&content_hash);
+                        stats::cache_lookup(TextureCacheKind::Registry, existing.is_some());
+                        match existing {
+                            Some(existing) => existing.clone(),
+                            None => {
+                                let encoded = encode(source)?;
+                                by_content.insert(content_hash, encoded.clone());
+                                encoded
+                            }
+                        }
+                    }
+                    TextureSource::File(_) => encode(source)?,
+                };
+                registry.entries.insert(key, entry);
+            }
+        }
+        Ok(registry)
+    }
+
+    // 未登记的纹理源（例如调用方未用同一场景构建注册表）退化为即时编码。
+    pub fn get(&self, source: &TextureSource) -> Result<Option<Arc<EncodedTexture>>> {
+        match self.entries.get(&TextureKey::of(source)) {
+            Some(entry) => Ok(entry.clone()),
+            None => encode_entry(source, &self.options, 0),
+        }
+    }
+
+    // 第 lod 级降采样变体（每级边长减半，最短到 1 像素）；生成失败时退回原图。
+    pub fn get_lod(&self, source: &TextureSource, lod: u32) -> Result<Option<Arc<EncodedTexture>>> {
+        let Some(entry) = self.entries.get(&TextureKey::of(source)) else {
+            return self.get(source);
+        };
+        let Some(full) = entry else {
+            return Ok(None);
+        };
+        let max_dim = full.image.width.max(full.image.height).max(1);
+        let lod = lod.min(max_dim.ilog2());
+        if lod == 0 {
+            return Ok(Some(full.clone()));
+        }
+        let variant = self
+            .variants
+            .lock()
+            .unwrap()
+            .entry((full.hash, lod))
+            .or_default()
+            .clone();
+        stats::cache_lookup(TextureCacheKind::Lod, variant.get().is_some());
+        let texture = variant.get_or_init(|| {
+            match encode_entry(source, &self.options, lod) {
+                Ok(texture) => texture,
+                Err(err) => {
+                    eprintln!("warning: texture variant skipped: {err:#}");
+                    None
+                }
+            }
+        });
+        Ok(Some(texture.clone().unwrap_or_else(|| full.clone())))
+    }
+
+    // 与 get_lod 同尺寸的 RGBA8 像素；从纹理源重新解码，不依赖编码结果。
+    pub fn decode_rgba(&self, source: &TextureSource, lod: u32) -> Option<Arc<RgbaImage>> {
+        let full = self.entries.get(&TextureKey::of(source))?.as_ref()?;
+        let max_dim = full.image.width.max(full.image.height).max(1);
+        let lod = lod.min(max_dim.ilog2());
+        let decoded = self
+            .decoded
+            .lock()
+            .unwrap()
+            .entry((full.hash, lod))
+            .or_default()
+            .clone();
+        decoded
+            .get_or_init(|| {
+                decode_scaled(source, &self.options, lod)
+                    .map(|image| Arc::new(image.to_rgba8()))
+            })
+            .clone()
+    }
+
+    pub fn dimensions(&self, source: &TextureSource) -> Option<(u32, u32)> {
+        let texture = self.entries.get(&TextureKey::of(source))?.as_ref()?;
+        Some((texture.image.width, texture.image.height))
+    }
+
+    // 原图编码结果的字节哈希，随纹理源内容与输出选项变化；增量导出据此判断纹理是否改动。
+    pub fn content_hash(&self, source: &TextureSource) -> Option<u64> {
+        let texture = self.entries.get(&TextureKey::of(source))?.as_ref()?;
+        Some(texture.hash)
+    }
+
+    pub fn options(&self) -> TextureOptions {
+        self.options
+    }
+}
+
+fn encode_entry(
+    source: &TextureSource,
+    options: &TextureOptions,
+    lod: u32,
+) -> Result<Option<Arc<EncodedTexture>>> {
+    let _span = stats::span("texture_encode");
+    let image = if lod == 0 {
+        match encode_texture(source)? {
+            Some(image) if fits_max_size(&image, options.max_size) => Some(image),
+            Some(_) => transcode(source, options, lod)?,
+            None => None,
+        }
+    } else {
+        transcode(source, options, lod)?
+    };
+    if let Some(image) = &image {
+        stats::add("texture.encoded", 1);
+        stats::add("texture.encoded_bytes", image.bytes.len() as u64);
+    }
+    Ok(image.map(|image| {
+        let hash = hash_bytes(&image.bytes);
+        Arc::new(EncodedTexture { image, hash })
+    }))
+}
+
+fn fits_max_size(image: &ImageData, max_size: u32) -> bool {
+    max_size == 0 || image.width.max(image.height) <= max_size
+}
+
+pub fn hash_bytes(bytes: &[u8]) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    bytes.hash(&mut hasher);
+    hasher.finish()
 }
 
 pub fn encode_texture(source: &TextureSource) -> Result<Option<ImageData>> {
@@ -24,6 +301,75 @@ pub fn encode_texture(source: &TextureSource) -> Result<Option<ImageData>> {
     }
 }
 
+// 解码后先按 max_size 等比缩小，再按 lod 逐级减半；解码失败时给出警告并返回 None。
+fn decode_scaled(source: &TextureSource, options: &TextureOptions, lod: u32) -> Option<DynamicImage> {
+    let _span = stats::span("texture_decode");
+    let decoded = match source {
+        TextureSource::File(path) => image::open(path)
+            .with_context(|| format!("decode texture {}", path.display())),
+        TextureSource::Embedded { bytes, name } => decode_embedded(bytes, name.as_deref()),
+    };
+    let image = match decoded {
+        Ok(image) => image,
+        Err(err) => {
+            eprintln!("warning: texture skipped: {err:#}");
+            return None;
+        }
+    };
+    let (width, height) = scaled_dimensions(image.width(), image.height(), options.max_size, lod);
+    if (width, height) == (image.width(), image.height()) {
+        Some(image)
+    } else {
+        Some(image.resize_exact(width, height, FilterType::Triangle))
+    }
+}
+
+fn transcode(
+    source: &TextureSource,
+    options: &TextureOptions,
+    lod: u32,
+) -> Result<Option<ImageData>> {
+    let Some(image) = decode_scaled(source, options, lod) else {
+        return Ok(None);
+    };
+    Ok(Some(encode_image(image)?))
+}
+
+fn scaled_dimensions(width: u32, height: u32, max_size: u32, lod: u32) -> (u32, u32) {
+    let longest = width.max(height);
+    let (width, height) = if max_size > 0 && longest > max_size {
+        let scale = max_size as f64 / longest as f64;
+        (
+            ((width as f64 * scale).round() as u32).max(1),
+            ((height as f64 * scale).round() as u32).max(1),
+        )
+    } else {
+        (width, height)
+    };
+    ((width >> lod).max(1), (height >> lod).max(1))
+}
+
+fn decode_embedded(bytes: &[u8], name: Option<&str>) -> Result<DynamicImage> {
+    if let Ok(image) = image::load_from_memory(bytes) {
+        return Ok(image);
+    }
+    let format = name.and_then(format_from_name);
+    match format {
+        Some(format) => image::load_from_memory_with_format(bytes, format)
+            .with_context(|| format!("decode embedded texture {}", name.unwrap_or_default())),
+        None => anyhow::bail!("decode embedded texture {}", name.unwrap_or_default()),
+    }
+}
+
+// 只读文件头获取尺寸，原样保留的 JPEG 无需完整解码。
+fn probe_dimensions(bytes: &[u8]) -> (u32, u32) {
+    ImageReader::new(Cursor::new(bytes))
+        .with_guessed_format()
+        .ok()
+        .and_then(|reader| reader.into_dimensions().ok())
+        .unwrap_or((0, 0))
+}
+
 fn encode_from_path(path: &Path) -> Result<ImageData> {
     let ext = path
         .extension()
@@ -41,12 +387,17 @@ fn encode_from_path(path: &Path) -> Result<ImageData> {
                 bytes,
                 mime_type: "image/png".to_string(),
                 has_alpha: image.color().has_alpha(),
+                width: image.width(),
+                height: image.height(),
             });
         }
+        let (width, height) = probe_dimensions(&bytes);
         return Ok(ImageData {
             bytes,
             mime_type: "image/jpeg".to_string(),
             has_alpha: false,
+            width,
+            height,
         });
     }
 
@@ -63,14 +414,19 @@ fn encode_from_bytes(bytes: &[u8], name: Option<&str>) -> Result<Option<ImageDat
                     bytes: bytes.to_vec(),
                     mime_type: "image/png".to_string(),
                     has_alpha: image.color().has_alpha(),
+                    width: image.width(),
+                    height: image.height(),
                 }));
             }
         }
         if format == ImageFormat::Jpeg {
+            let (width, height) = probe_dimensions(bytes);
             return Ok(Some(ImageData {
                 bytes: bytes.to_vec(),
                 mime_type: "image/jpeg".to_string(),
                 has_alpha: false,
+                width,
+                height,
             }));
         }
         if let Ok(image) = image::load_from_memory_with_format(bytes, format) {
@@ -102,6 +458,17 @@ fn format_from_name(name: &str) -> Option<ImageFormat> {
     ImageFormat::from_extension(ext)
 }
 
+// 按像素实际 alpha 选择 PNG 或 JPEG（烘焙生成的 RGBA 图像总带 alpha 通道）。
+pub fn encode_rgba(image: RgbaImage) -> Result<ImageData> {
+    let opaque = image.as_raw().chunks_exact(4).all(|px| px[3] == u8::MAX);
+    let image = DynamicImage::from(image);
+    if opaque {
+        encode_image(DynamicImage::from(image.to_rgb8()))
+    } else {
+        encode_image(image)
+    }
+}
+
 fn encode_image(image: DynamicImage) -> Result<ImageData> {
     let has_alpha = image.color().has_alpha();
     let format = if has_alpha {
@@ -123,5 +490,7 @@ fn encode_image(image: DynamicImage) -> Result<ImageData> {
         bytes: data,
         mime_type: mime_type.to_string(),
         has_alpha,
+        width: image.width(),
+        height: image.height(),
     })
 }
@@ -0,0 +1,155 @@
+use serde_json::{json, Value};
+use std::collections::HashMap;
+
+const SUBTREE_MAGIC: u32 = 0x7462_7573; // "subt"
+const SUBTREE_VERSION: u32 = 1;
+
+// 隐式四叉树中的一个可用 tile：相对隐式根的层级与坐标，以及是否带内容。
+pub struct ImplicitTile {
+    pub level: u32,
+    pub x: u32,
+    pub y: u32,
+    pub has_content: bool,
+}
+
+// 每 subtree_levels 层切一个子树，编码为 3D Tiles 1.1 的二进制 .subtree；
+// 返回 (子树根的 level, x, y) 与文件内容，按层级与 Morton 序排列。
+pub fn encode_subtrees(
+    tiles: &[ImplicitTile],
+    subtree_levels: u32,
+) -> Vec<((u32, u32, u32), Vec<u8>)> {
+    let mut subtrees: HashMap<(u32, u32, u32), SubtreeBits> = HashMap::new();
+    for tile in tiles {
+        let root_level = tile.level - tile.level % subtree_levels;
+        let depth = tile.level - root_level;
+        let key = (root_level, tile.x >> depth, tile.y >> depth);
+        let subtree = subtrees
+            .entry(key)
+            .or_insert_with(|| SubtreeBits::new(subtree_levels));
+        let local_x = tile.x - (key.1 << depth);
+        let local_y = tile.y - (key.2 << depth);
+        // 每层在位流中的起点为其上各层 tile 数之和 (4^depth - 1) / 3。
+        let bit = ((1u64 << (2 * depth)) - 1) / 3 + interleave(local_x, local_y);
+        set_bit(&mut subtree.tiles, bit);
+        if tile.has_content {
+            set_bit(&mut subtree.content, bit);
+        }
+    }
+
+    // 子树根 tile 的可用性同时登记为父子树的子树可用位。
+    let roots: Vec<(u32, u32, u32)> = subtrees.keys().copied().filter(|key| key.0 > 0).collect();
+    for (level, x, y) in roots {
+        let parent = (level - subtree_levels, x >> subtree_levels, y >> subtree_levels);
+        if let Some(subtree) = subtrees.get_mut(&parent) {
+            let local_x = x - (parent.1 << subtree_levels);
+            let local_y = y - (parent.2 << subtree_levels);
+            set_bit(&mut subtree.children, interleave(local_x, local_y));
+        }
+    }
+
+    let mut encoded: Vec<((u32, u32, u32), Vec<u8>)> = subtrees
+        .into_iter()
+        .map(|(key, subtree)| (key, subtree.encode()))
+        .collect();
+    encoded.sort_by_key(|((level, x, y), _)| (*level, interleave(*x, *y)));
+    encoded
+}
+
+// (x, y) 按位交错的 Morton 序号，x 占低位；与隐式四叉树的子节点编号一致。
+pub fn interleave(x: u32, y: u32) -> u64 {
+    fn spread(value: u32) -> u64 {
+        let mut v = value as u64;
+        v = (v | (v << 16)) & 0x0000_ffff_0000_ffff;
+        v = (v | (v << 8)) & 0x00ff_00ff_00ff_00ff;
+        v = (v | (v << 4)) & 0x0f0f_0f0f_0f0f_0f0f;
+        v = (v | (v << 2)) & 0x3333_3333_3333_3333;
+        (v | (v << 1)) & 0x5555_5555_5555_5555
+    }
+    spread(x) | (spread(y) << 1)
+}
+
+fn set_bit(bits: &mut [u8], index: u64) {
+    bits[(index / 8) as usize] |= 1 << (index % 8);
+}
+
+struct SubtreeBits {
+    tile_count: u64,
+    child_count: u64,
+    tiles: Vec<u8>,
+    content: Vec<u8>,
+    children: Vec<u8>,
+}
+
+impl SubtreeBits {
+    fn new(levels: u32) -> Self {
+        let child_count = 1u64 << (2 * levels);
+        let tile_count = (child_count - 1) / 3;
+        let bytes = |count: u64| vec![0u8; count.div_ceil(8) as usize];
+        Self {
+            tile_count,
+            child_count,
+            tiles: bytes(tile_count),
+            content: bytes(tile_count),
+            children: bytes(child_count),
+        }
+    }
+
+    // 头部（magic、版本、JSON 与二进制长度）+ JSON + 二进制位流，各段按 8 字节对齐。
+    fn encode(self) -> Vec<u8> {
+        let mut body = SubtreeBody::default();
+        let tiles = body.availability(&self.tiles, self.tile_count);
+        let content = body.availability(&self.content, self.tile_count);
+        let children = body.availability(&self.children, self.child_count);
+        let mut subtree = json!({
+            "tileAvailability": tiles,
+            "contentAvailability": [content],
+            "childSubtreeAvailability": children,
+        });
+        if !body.views.is_empty() {
+            pad_to_8(&mut body.binary, 0);
+            subtree["buffers"] = json!([{ "byteLength": body.binary.len() }]);
+            subtree["bufferViews"] = Value::Array(body.views);
+        }
+
+        let mut json_bytes = serde_json::to_vec(&subtree).expect("subtree json");
+        pad_to_8(&mut json_bytes, b' ');
+        let mut out = Vec::with_capacity(24 + json_bytes.len() + body.binary.len());
+        out.extend_from_slice(&SUBTREE_MAGIC.to_le_bytes());
+        out.extend_from_slice(&SUBTREE_VERSION.to_le_bytes());
+        out.extend_from_slice(&(json_bytes.len() as u64).to_le_bytes());
+        out.extend_from_slice(&(body.binary.len() as u64).to_le_bytes());
+        out.extend_from_slice(&json_bytes);
+        out.extend_from_slice(&body.binary);
+        out
+    }
+}
+
+#[derive(Default)]
+struct SubtreeBody {
+    binary: Vec<u8>,
+    views: Vec<Value>,
+}
+
+impl SubtreeBody {
+    // 全 0 或全 1 的可用性写成常量，否则追加位流。
+    fn availability(&mut self, bits: &[u8], count: u64) -> Value {
+        let available: u64 = bits.iter().map(|byte| byte.count_ones() as u64).sum();
+        if available == 0 || available == count {
+            return json!({ "constant": u8::from(available > 0) });
+        }
+        pad_to_8(&mut self.binary, 0);
+        self.views.push(json!({
+            "buffer": 0,
+            "byteOffset": self.binary.len(),
+            "byteLength": bits.len(),
+        }));
+        self.binary.extend_from_slice(bits);
+        json!({ "bitstream": self.views.len() - 1, "availableCount": available })
+    }
+}
+
+fn pad_to_8(bytes: &mut Vec<u8>, fill: u8) {
+    while bytes.len() % 8 != 0 {
+        bytes.push(fill);
+    }
+}
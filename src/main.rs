@@ -1,10 +1,23 @@
 use anyhow::{Context, Result};
-use clap::{Parser, Subcommand};
+use clap::{Parser, Subcommand, ValueEnum};
 use std::path::PathBuf;
 
+mod archive;
+mod atlas;
+mod batch;
+mod bench;
 mod geo;
 mod gltf_writer;
 mod image_utils;
+mod implicit;
+mod manifest;
+mod merge;
+mod meshopt;
+mod parallel;
+mod reorder;
+mod simplify;
+mod stats;
+mod tangents;
 mod tiles;
 mod ufbx_loader;
 mod ufbx_sys;
@@ -19,6 +32,33 @@ struct Args {
     /// Disable V flip on UVs (default: flip V)
     #[arg(long)]
     no_flip_v: bool,
+    /// Quantize vertex attributes with KHR_mesh_quantization (gltf mode)
+    #[arg(long)]
+    quantize: bool,
+    /// Compress geometry streams (gltf mode)
+    #[arg(long, value_enum)]
+    compress: Option<CompressArg>,
+    /// Maximum texture width/height in pixels, 0 for no limit (gltf mode)
+    #[arg(long, default_value_t = 0)]
+    max_texture_size: u32,
+    /// Only export mesh nodes whose name, or an ancestor's, matches this glob (gltf mode)
+    #[arg(long = "node", value_name = "GLOB")]
+    nodes: Vec<String>,
+    /// Only export mesh nodes in a display layer matching this glob (gltf mode)
+    #[arg(long = "layer", value_name = "GLOB")]
+    layers: Vec<String>,
+    /// Only export meshes intersecting this FBX world box: minx,miny,minz,maxx,maxy,maxz (gltf mode)
+    #[arg(long, value_delimiter = ',', allow_hyphen_values = true)]
+    bounds: Vec<f64>,
+    /// Write repeated meshes once with EXT_mesh_gpu_instancing (gltf mode)
+    #[arg(long)]
+    instancing: bool,
+    /// Write per-stage timings, counters, peak memory and cache hit rates as JSON
+    #[arg(long, global = true, value_name = "PATH")]
+    stats: Option<PathBuf>,
+    /// Write a Chrome trace (chrome://tracing, Perfetto) of the recorded spans
+    #[arg(long, global = true, value_name = "PATH")]
+    trace: Option<PathBuf>,
     #[command(subcommand)]
     command: Option<Command>,
 }
@@ -55,18 +95,276 @@ enum Command {
         /// Maximum quadtree level override
         #[arg(long)]
         max_level: Option<u32>,
+        /// Split tiles adaptively until each holds at most this many triangles
+        #[arg(long)]
+        max_triangles_per_tile: Option<usize>,
+        /// Split tiles adaptively until each holds at most this many geometry bytes
+        #[arg(long)]
+        max_bytes_per_tile: Option<usize>,
+        /// Quantize vertex attributes with KHR_mesh_quantization
+        #[arg(long)]
+        quantize: bool,
+        /// Compress geometry streams in each tile
+        #[arg(long, value_enum)]
+        compress: Option<CompressArg>,
+        /// Maximum texture width/height in pixels, 0 for no limit
+        #[arg(long, default_value_t = 0)]
+        max_texture_size: u32,
+        /// Embed textures in each tile (default: shared external textures)
+        #[arg(long)]
+        embed_textures: bool,
+        /// Bake mergeable materials of each tile into one texture atlas and primitive
+        #[arg(long)]
+        atlas: bool,
+        /// Bake the top N quadtree levels into per-tile atlases merged bottom-up from the children
+        #[arg(long, default_value_t = 0)]
+        coarse_levels: u32,
+        /// Maximum coarse-level atlas width/height in pixels
+        #[arg(long, default_value_t = 1024)]
+        coarse_texture_size: u32,
+        /// Disable V flip on UVs (default: flip V)
+        #[arg(long)]
+        no_flip_v: bool,
+        /// Number of mesh extraction and tile writer threads (0: all available cores)
+        #[arg(long, default_value_t = 0)]
+        jobs: usize,
+        /// Stream geometry per mesh node and spill binned tiles to disk
+        #[arg(long)]
+        out_of_core: bool,
+        /// Memory budget in MB for buffered tile data in out-of-core mode
+        #[arg(long, default_value_t = 2048)]
+        memory_limit_mb: usize,
+        /// Only rewrite tiles whose input changed since the last incremental export
+        #[arg(long)]
+        incremental: bool,
+        /// Write implicit tiling (.subtree availability files) instead of explicit children
+        #[arg(long)]
+        implicit: bool,
+        /// Pack tileset.json, tiles and textures into one 3TZ archive; OUTPUT_DIR is the .3tz path
+        #[arg(long)]
+        archive: bool,
+        /// Write repeated meshes once per tile with EXT_mesh_gpu_instancing
+        #[arg(long)]
+        instancing: bool,
+        /// Only export mesh nodes whose name, or an ancestor's, matches this glob (repeatable)
+        #[arg(long = "node", value_name = "GLOB")]
+        nodes: Vec<String>,
+        /// Only export mesh nodes in a display layer matching this glob (repeatable)
+        #[arg(long = "layer", value_name = "GLOB")]
+        layers: Vec<String>,
+        /// Only export meshes intersecting this FBX world box: minx,miny,minz,maxx,maxy,maxz
+        #[arg(long, value_delimiter = ',', allow_hyphen_values = true)]
+        bounds: Vec<f64>,
+    },
+    /// Merge FBX files listed in a JSON or CSV manifest into one 3D Tiles 1.1 tileset
+    Merge {
+        /// Manifest with input paths and per-file geo options (same format as batch, no output)
+        manifest: PathBuf,
+        /// Output directory for tileset.json and tiles/
+        output_dir: PathBuf,
+        /// Origin latitude of the shared frame in degrees (default: first entry)
+        #[arg(long)]
+        origin_lat: Option<f64>,
+        /// Origin longitude of the shared frame in degrees (default: first entry)
+        #[arg(long)]
+        origin_lon: Option<f64>,
+        /// Origin height of the shared frame in meters (default: first entry)
+        #[arg(long)]
+        origin_height: Option<f64>,
+        /// Root tile size in meters
+        #[arg(long, default_value_t = 100.0)]
+        tile_size: f64,
+        /// Minimum tile size in meters
+        #[arg(long, default_value_t = 12.5)]
+        min_tile_size: f64,
+        /// Maximum quadtree level override
+        #[arg(long)]
+        max_level: Option<u32>,
+        /// Split tiles adaptively until each holds at most this many triangles
+        #[arg(long)]
+        max_triangles_per_tile: Option<usize>,
+        /// Split tiles adaptively until each holds at most this many geometry bytes
+        #[arg(long)]
+        max_bytes_per_tile: Option<usize>,
+        /// Quantize vertex attributes with KHR_mesh_quantization
+        #[arg(long)]
+        quantize: bool,
+        /// Compress geometry streams in each tile
+        #[arg(long, value_enum)]
+        compress: Option<CompressArg>,
+        /// Maximum texture width/height in pixels, 0 for no limit
+        #[arg(long, default_value_t = 0)]
+        max_texture_size: u32,
         /// Embed textures in each tile (default: shared external textures)
         #[arg(long)]
         embed_textures: bool,
+        /// Bake mergeable materials of each tile into one texture atlas and primitive
+        #[arg(long)]
+        atlas: bool,
+        /// Bake the top N quadtree levels into per-tile atlases merged bottom-up from the children
+        #[arg(long, default_value_t = 0)]
+        coarse_levels: u32,
+        /// Maximum coarse-level atlas width/height in pixels
+        #[arg(long, default_value_t = 1024)]
+        coarse_texture_size: u32,
         /// Disable V flip on UVs (default: flip V)
         #[arg(long)]
         no_flip_v: bool,
+        /// Number of mesh extraction and tile writer threads (0: all available cores)
+        #[arg(long, default_value_t = 0)]
+        jobs: usize,
+        /// Only rewrite tiles whose input changed since the last incremental export
+        #[arg(long)]
+        incremental: bool,
+        /// Write implicit tiling (.subtree availability files) instead of explicit children
+        #[arg(long)]
+        implicit: bool,
+        /// Pack tileset.json, tiles and textures into one 3TZ archive; OUTPUT_DIR is the .3tz path
+        #[arg(long)]
+        archive: bool,
+        /// Only export mesh nodes whose name, or an ancestor's, matches this glob (repeatable)
+        #[arg(long = "node", value_name = "GLOB")]
+        nodes: Vec<String>,
+        /// Only export mesh nodes in a display layer matching this glob (repeatable)
+        #[arg(long = "layer", value_name = "GLOB")]
+        layers: Vec<String>,
+        /// Only export meshes intersecting this FBX world box: minx,miny,minz,maxx,maxy,maxz
+        #[arg(long, value_delimiter = ',', allow_hyphen_values = true)]
+        bounds: Vec<f64>,
+    },
+    /// Convert many FBX files listed in a JSON or CSV manifest in one process
+    Batch {
+        /// Manifest with input, output and per-file geo options (JSON array or CSV with header)
+        manifest: PathBuf,
+        /// Number of files converted concurrently (0: one per available core)
+        #[arg(long, default_value_t = 0)]
+        concurrency: usize,
+        /// Total worker threads shared by concurrent conversions (0: all available cores)
+        #[arg(long, default_value_t = 0)]
+        jobs: usize,
+        /// Memory budget in MB across concurrent conversions, estimated from input sizes
+        #[arg(long, default_value_t = 8192)]
+        memory_limit_mb: usize,
+        /// Split tiles adaptively until each holds at most this many triangles
+        #[arg(long)]
+        max_triangles_per_tile: Option<usize>,
+        /// Split tiles adaptively until each holds at most this many geometry bytes
+        #[arg(long)]
+        max_bytes_per_tile: Option<usize>,
+        /// Shared external texture directory for all tilesets (default: per-tileset textures/)
+        #[arg(long)]
+        texture_dir: Option<PathBuf>,
+        /// Write per-file timings as JSON
+        #[arg(long)]
+        report: Option<PathBuf>,
+        /// Quantize vertex attributes with KHR_mesh_quantization
+        #[arg(long)]
+        quantize: bool,
+        /// Compress geometry streams
+        #[arg(long, value_enum)]
+        compress: Option<CompressArg>,
+        /// Maximum texture width/height in pixels, 0 for no limit
+        #[arg(long, default_value_t = 0)]
+        max_texture_size: u32,
+        /// Embed textures in each tile (default: shared external textures)
+        #[arg(long)]
+        embed_textures: bool,
+        /// Bake mergeable materials of each tile into one texture atlas and primitive
+        #[arg(long)]
+        atlas: bool,
+        /// Disable V flip on UVs (default: flip V)
+        #[arg(long)]
+        no_flip_v: bool,
+        /// Only rewrite tiles whose input changed since the last incremental export
+        #[arg(long)]
+        incremental: bool,
+        /// Write implicit tiling (.subtree availability files) instead of explicit children
+        #[arg(long)]
+        implicit: bool,
+        /// Only export mesh nodes whose name, or an ancestor's, matches this glob (repeatable)
+        #[arg(long = "node", value_name = "GLOB")]
+        nodes: Vec<String>,
+        /// Only export mesh nodes in a display layer matching this glob (repeatable)
+        #[arg(long = "layer", value_name = "GLOB")]
+        layers: Vec<String>,
+        /// Only export meshes intersecting this FBX world box: minx,miny,minz,maxx,maxy,maxz
+        #[arg(long, value_delimiter = ',', allow_hyphen_values = true)]
+        bounds: Vec<f64>,
     },
+    /// Time each pipeline stage on generated synthetic FBX scenes
+    Bench {
+        /// Directory for the generated scenes, textures and GLB outputs
+        work_dir: PathBuf,
+        /// Synthetic scene to run (repeatable, default: all)
+        #[arg(long = "scene", value_enum)]
+        scenes: Vec<BenchSceneArg>,
+        /// Scene size multiplier; triangle and texture counts grow with its square
+        #[arg(long, default_value_t = 1)]
+        size: usize,
+        /// Runs per stage; the best and median times are reported
+        #[arg(long, default_value_t = 5)]
+        iterations: usize,
+        /// Number of mesh extraction threads (0: all available cores)
+        #[arg(long, default_value_t = 0)]
+        jobs: usize,
+        /// Quantize vertex attributes in the GLB stage
+        #[arg(long)]
+        quantize: bool,
+        /// Compress geometry streams in the GLB stage
+        #[arg(long, value_enum)]
+        compress: Option<CompressArg>,
+    },
+}
+
+#[derive(Clone, Copy, ValueEnum)]
+enum CompressArg {
+    /// EXT_meshopt_compression
+    Meshopt,
+}
+
+impl From<CompressArg> for gltf_writer::Compression {
+    fn from(arg: CompressArg) -> Self {
+        match arg {
+            CompressArg::Meshopt => gltf_writer::Compression::Meshopt,
+        }
+    }
+}
+
+#[derive(Clone, Copy, ValueEnum)]
+enum BenchSceneArg {
+    /// One large undulating grid mesh
+    Terrain,
+    /// Thousands of small boxes, each its own mesh node
+    Meshes,
+    /// Ground patches that each use a distinct texture
+    Textures,
+}
+
+impl From<BenchSceneArg> for bench::BenchScene {
+    fn from(arg: BenchSceneArg) -> Self {
+        match arg {
+            BenchSceneArg::Terrain => bench::BenchScene::Terrain,
+            BenchSceneArg::Meshes => bench::BenchScene::Meshes,
+            BenchSceneArg::Textures => bench::BenchScene::Textures,
+        }
+    }
 }
 
 fn main() -> Result<()> {
     let args = Args::parse();
+    let stats_path = args.stats.clone();
+    let trace_path = args.trace.clone();
+    if stats_path.is_some() || trace_path.is_some() {
+        stats::enable(trace_path.is_some());
+    }
+    // 转换失败时也写出统计，便于定位耗时或内存出在哪个阶段。
+    let result = run(args);
+    let written = stats::write_reports(stats_path.as_deref(), trace_path.as_deref());
+    result?;
+    written
+}
 
+fn run(args: Args) -> Result<()> {
     match args.command {
         Some(Command::Tiles {
             input,
@@ -79,14 +377,33 @@ fn main() -> Result<()> {
             tile_size,
             min_tile_size,
             max_level,
+            max_triangles_per_tile,
+            max_bytes_per_tile,
+            quantize,
+            compress,
+            max_texture_size,
             embed_textures,
+            atlas,
+            coarse_levels,
+            coarse_texture_size,
             no_flip_v,
+            jobs,
+            out_of_core,
+            memory_limit_mb,
+            incremental,
+            implicit,
+            archive,
+            instancing,
+            nodes,
+            layers,
+            bounds,
         }) => {
-            let mut scene = ufbx_loader::load_scene(&input)
-                .with_context(|| format!("failed to load FBX: {}", input.display()))?;
-            if no_flip_v {
-                ufbx_loader::flip_v(&mut scene);
-            }
+            let load = ufbx_loader::LoadOptions {
+                instancing,
+                ..ufbx_loader::LoadOptions::new(nodes, layers, &bounds)?
+            };
+            let tile_budget =
+                tiles::TileBudget::from_limits(max_triangles_per_tile, max_bytes_per_tile);
             let options = tiles::TilesetOptions {
                 origin_lat,
                 origin_lon,
@@ -97,10 +414,199 @@ fn main() -> Result<()> {
                 min_tile_size,
                 max_level,
                 embed_textures,
+                jobs,
+                memory_limit_mb,
+                glb: gltf_writer::GlbOptions {
+                    quantize,
+                    compression: compress.map(Into::into),
+                },
+                atlas,
+                coarse_levels,
+                coarse_texture_size,
+                incremental,
+                texture_dir: None,
+                tile_budget,
+                implicit,
+                archive,
+                load,
+            };
+            let texture_options = image_utils::TextureOptions {
+                max_size: max_texture_size,
+            };
+            let export_context = || format!("failed to export tileset to {}", output_dir.display());
+            if out_of_core {
+                let mut stream = ufbx_loader::SceneStream::open(&input, &options.load)
+                    .with_context(|| format!("failed to load FBX: {}", input.display()))?;
+                let registry =
+                    image_utils::TextureRegistry::build(&stream.materials, texture_options)?;
+                tiles::export_tileset_streaming(&mut stream, no_flip_v, &registry, &output_dir, &options)
+                    .with_context(export_context)?;
+            } else {
+                let mut scene = ufbx_loader::load_scene(&input, jobs, &options.load)
+                    .with_context(|| format!("failed to load FBX: {}", input.display()))?;
+                if no_flip_v {
+                    ufbx_loader::flip_v(&mut scene);
+                }
+                let registry =
+                    image_utils::TextureRegistry::build(&scene.materials, texture_options)?;
+                tiles::export_tileset(&scene, &registry, &output_dir, &options)
+                    .with_context(export_context)?;
+            }
+        }
+        Some(Command::Merge {
+            manifest,
+            output_dir,
+            origin_lat,
+            origin_lon,
+            origin_height,
+            tile_size,
+            min_tile_size,
+            max_level,
+            max_triangles_per_tile,
+            max_bytes_per_tile,
+            quantize,
+            compress,
+            max_texture_size,
+            embed_textures,
+            atlas,
+            coarse_levels,
+            coarse_texture_size,
+            no_flip_v,
+            jobs,
+            incremental,
+            implicit,
+            archive,
+            nodes,
+            layers,
+            bounds,
+        }) => {
+            let load = ufbx_loader::LoadOptions::new(nodes, layers, &bounds)?;
+            let entries = batch::load_sources(&manifest)?;
+            let Some(first) = entries.first() else {
+                anyhow::bail!("merge manifest has no entries");
+            };
+            // 共同坐标系：heading 0、缩放 1 的 ENU，原点默认取第一个模型的原点。
+            let tile_budget =
+                tiles::TileBudget::from_limits(max_triangles_per_tile, max_bytes_per_tile);
+            let options = tiles::TilesetOptions {
+                origin_lat: origin_lat.unwrap_or(first.origin_lat),
+                origin_lon: origin_lon.unwrap_or(first.origin_lon),
+                origin_height: origin_height.unwrap_or(first.origin_height),
+                heading: 0.0,
+                scale: 1.0,
+                tile_size,
+                min_tile_size,
+                max_level,
+                embed_textures,
+                jobs,
+                memory_limit_mb: 0,
+                glb: gltf_writer::GlbOptions {
+                    quantize,
+                    compression: compress.map(Into::into),
+                },
+                atlas,
+                coarse_levels,
+                coarse_texture_size,
+                incremental,
+                texture_dir: None,
+                tile_budget,
+                implicit,
+                archive,
+                load,
+            };
+            let frame = geo::GeoContext::new(
+                options.origin_lat,
+                options.origin_lon,
+                options.origin_height,
+                options.heading,
+                options.scale,
+            );
+            let scene =
+                merge::load_merged_scene(&entries, &frame, jobs, no_flip_v, &options.load)?;
+            let texture_options = image_utils::TextureOptions {
+                max_size: max_texture_size,
             };
-            tiles::export_tileset(&scene, &output_dir, &options).with_context(|| {
-                format!("failed to export tileset to {}", output_dir.display())
-            })?;
+            let registry = image_utils::TextureRegistry::build(&scene.materials, texture_options)?;
+            tiles::export_tileset(&scene, &registry, &output_dir, &options)
+                .with_context(|| format!("failed to export tileset to {}", output_dir.display()))?;
+        }
+        Some(Command::Batch {
+            manifest,
+            concurrency,
+            jobs,
+            memory_limit_mb,
+            max_triangles_per_tile,
+            max_bytes_per_tile,
+            texture_dir,
+            report,
+            quantize,
+            compress,
+            max_texture_size,
+            embed_textures,
+            atlas,
+            no_flip_v,
+            incremental,
+            implicit,
+            nodes,
+            layers,
+            bounds,
+        }) => {
+            let load = ufbx_loader::LoadOptions::new(nodes, layers, &bounds)?;
+            let entries = batch::load_manifest(&manifest)?;
+            let tile_budget =
+                tiles::TileBudget::from_limits(max_triangles_per_tile, max_bytes_per_tile);
+            let options = batch::BatchOptions {
+                concurrency,
+                jobs,
+                memory_limit_mb,
+                tile_budget,
+                glb: gltf_writer::GlbOptions {
+                    quantize,
+                    compression: compress.map(Into::into),
+                },
+                textures: image_utils::TextureOptions {
+                    max_size: max_texture_size,
+                },
+                embed_textures,
+                atlas,
+                no_flip_v,
+                incremental,
+                implicit,
+                texture_dir,
+                load,
+                report,
+            };
+            batch::run_batch(entries, &options)?;
+        }
+        Some(Command::Bench {
+            work_dir,
+            scenes,
+            size,
+            iterations,
+            jobs,
+            quantize,
+            compress,
+        }) => {
+            let scenes = if scenes.is_empty() {
+                vec![BenchSceneArg::Terrain, BenchSceneArg::Meshes, BenchSceneArg::Textures]
+            } else {
+                scenes
+            };
+            let options = bench::BenchOptions {
+                work_dir,
+                scenes: scenes.into_iter().map(Into::into).collect(),
+                size,
+                iterations,
+                jobs,
+                glb: gltf_writer::GlbOptions {
+                    quantize,
+                    compression: compress.map(Into::into),
+                },
+                textures: image_utils::TextureOptions {
+                    max_size: 0,
+                },
+            };
+            bench::run_bench(&options)?;
         }
         None => {
             let input = args
@@ -109,12 +615,24 @@ fn main() -> Result<()> {
             let output = args
                 .output
                 .ok_or_else(|| anyhow::anyhow!("missing output path"))?;
-            let mut scene = ufbx_loader::load_scene(&input)
+            let load = ufbx_loader::LoadOptions {
+                instancing: args.instancing,
+                ..ufbx_loader::LoadOptions::new(args.nodes, args.layers, &args.bounds)?
+            };
+            let mut scene = ufbx_loader::load_scene(&input, 0, &load)
                 .with_context(|| format!("failed to load FBX: {}", input.display()))?;
             if args.no_flip_v {
                 ufbx_loader::flip_v(&mut scene);
             }
-            gltf_writer::write_glb(&scene, &output)
+            let texture_options = image_utils::TextureOptions {
+                max_size: args.max_texture_size,
+            };
+            let registry = image_utils::TextureRegistry::build(&scene.materials, texture_options)?;
+            let glb_options = gltf_writer::GlbOptions {
+                quantize: args.quantize,
+                compression: args.compress.map(Into::into),
+            };
+            gltf_writer::write_glb(&scene, &registry, &output, &glb_options)
                 .with_context(|| format!("failed to write GLB: {}", output.display()))?;
         }
     }
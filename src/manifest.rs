@@ -0,0 +1,120 @@
+use anyhow::{Context, Result};
+use serde_json::{json, Value};
+use std::collections::HashMap;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+
+pub const MANIFEST_NAME: &str = "fbx2tiles_manifest.json";
+const MANIFEST_VERSION: u64 = 1;
+
+// 增量导出清单：记录每个 tile 文件的输入内容哈希（三角形、材质、纹理内容）与导出选项指纹。
+// 再次导出时哈希一致且文件仍在的 tile 不再编码写出，已不存在的 tile 在收尾时删除。
+pub struct TileManifest {
+    path: PathBuf,
+    previous: HashMap<String, u64>,
+    // 选项指纹不一致时旧哈希全部作废，但旧 tile 仍在收尾时清理。
+    reusable: bool,
+    // 本次导出涉及的所有 tile（包括跳过写出的）；多个 tile 线程并发登记。
+    current: Mutex<HashMap<String, u64>>,
+    options_hash: u64,
+}
+
+impl TileManifest {
+    // 选项指纹不一致或清单不可读时按全量导出处理。旧清单读入后立即删除，
+    // 中途失败时磁盘上不会留下与 tile 内容不符的清单。
+    pub fn load(output_dir: &Path, options_hash: u64) -> Result<Self> {
+        let path = output_dir.join(MANIFEST_NAME);
+        let mut previous = HashMap::new();
+        let mut reusable = false;
+        if let Ok(bytes) = fs::read(&path) {
+            if let Ok(value) = serde_json::from_slice::<Value>(&bytes) {
+                reusable = value["version"].as_u64() == Some(MANIFEST_VERSION)
+                    && parse_hash(&value["options"]) == Some(options_hash);
+                if let Some(tiles) = value["tiles"].as_object() {
+                    for (name, hash) in tiles {
+                        if let Some(hash) = parse_hash(hash) {
+                            previous.insert(name.clone(), hash);
+                        }
+                    }
+                }
+            }
+            fs::remove_file(&path)
+                .with_context(|| format!("remove manifest {}", path.display()))?;
+        }
+        Ok(Self {
+            path,
+            previous,
+            reusable,
+            current: Mutex::new(HashMap::new()),
+            options_hash,
+        })
+    }
+
+    // 登记 tile 的内容哈希（按文件名）；返回 true 表示上次导出的文件仍然有效，可跳过写出。
+    pub fn check(&self, path: &Path, hash: u64) -> bool {
+        let name = path
+            .file_name()
+            .map(|name| name.to_string_lossy().into_owned())
+            .unwrap_or_default();
+        let unchanged =
+            self.reusable && self.previous.get(&name) == Some(&hash) && path.is_file();
+        self.current.lock().unwrap().insert(name, hash);
+        unchanged
+    }
+
+    // 删除旧清单中本次未生成的 tile，并写出新清单。
+    pub fn finish(self, tiles_dir: &Path) -> Result<()> {
+        let current = self.current.into_inner().unwrap();
+        for name in self.previous.keys() {
+            if !current.contains_key(name) {
+                let path = tiles_dir.join(name);
+                if path.is_file() {
+                    fs::remove_file(&path)
+                        .with_context(|| format!("remove stale tile {}", path.display()))?;
+                }
+            }
+        }
+
+        let mut names: Vec<&String> = current.keys().collect();
+        names.sort();
+        let tiles: serde_json::Map<String, Value> = names
+            .into_iter()
+            .map(|name| (name.clone(), json!(format_hash(current[name]))))
+            .collect();
+        let manifest = json!({
+            "version": MANIFEST_VERSION,
+            "options": format_hash(self.options_hash),
+            "tiles": tiles,
+        });
+        let file = fs::File::create(&self.path)
+            .with_context(|| format!("write manifest {}", self.path.display()))?;
+        serde_json::to_writer_pretty(file, &manifest)?;
+        Ok(())
+    }
+}
+
+// 非增量导出会重写全部 tile，遗留的清单不再可信。
+pub fn remove_manifest(output_dir: &Path) -> Result<()> {
+    let path = output_dir.join(MANIFEST_NAME);
+    if path.is_file() {
+        fs::remove_file(&path).with_context(|| format!("remove manifest {}", path.display()))?;
+    }
+    Ok(())
+}
+
+// 内容未变化时不重写文件，保持修改时间与 CDN 缓存。
+pub fn write_if_changed(path: &Path, bytes: &[u8]) -> Result<()> {
+    if fs::read(path).is_ok_and(|existing| existing == bytes) {
+        return Ok(());
+    }
+    fs::write(path, bytes).with_context(|| format!("write {}", path.display()))
+}
+
+fn format_hash(hash: u64) -> String {
+    format!("{hash:016x}")
+}
+
+fn parse_hash(value: &Value) -> Option<u64> {
+    u64::from_str_radix(value.as_str()?, 16).ok()
+}
@@ -0,0 +1,104 @@
+use crate::batch::BatchEntry;
+use crate::geo::GeoContext;
+use crate::parallel::{parallel_map, resolve_jobs};
+use crate::stats;
+use crate::ufbx_loader::{flip_v, load_scene, LoadOptions, MeshPart, SceneData};
+use anyhow::{bail, Context, Result};
+
+// 合并导出：把各带地理参考（原点/heading/缩放）的多个 FBX 变换到 frame 的模型坐标系并拼成一个场景，
+// 之后按单个场景分块写出一个 tileset，相邻模型共用同一棵四叉树与 tile。
+pub fn load_merged_scene(
+    entries: &[BatchEntry],
+    frame: &GeoContext,
+    jobs: usize,
+    no_flip_v: bool,
+    load: &LoadOptions,
+) -> Result<SceneData> {
+    let _span = stats::span("load_merged_scene");
+    if entries.is_empty() {
+        bail!("merge manifest has no entries");
+    }
+    let per_input_jobs = (resolve_jobs(jobs, usize::MAX) / entries.len()).max(1);
+    let scenes = parallel_map(jobs, entries.iter().collect(), |entry: &BatchEntry| {
+        let mut scene = load_scene(&entry.input, per_input_jobs, load)
+            .with_context(|| format!("failed to load FBX: {}", entry.input.display()))?;
+        if no_flip_v {
+            flip_v(&mut scene);
+        }
+        let geo = GeoContext::new(
+            entry.origin_lat,
+            entry.origin_lon,
+            entry.origin_height,
+            entry.heading,
+            entry.scale,
+        );
+        let matrix = geo.relative_transform(frame);
+        if !is_identity(&matrix) {
+            for part in &mut scene.parts {
+                transform_part(part, &matrix);
+            }
+        }
+        Ok(scene)
+    })?;
+
+    let mut scenes = scenes.into_iter();
+    let mut merged = scenes.next().expect("at least one scene");
+    for scene in scenes {
+        let material_offset = merged.materials.len();
+        merged.materials.extend(scene.materials);
+        merged.parts.extend(scene.parts.into_iter().map(|mut part| {
+            part.material_index += material_offset;
+            part
+        }));
+    }
+    Ok(merged)
+}
+
+fn is_identity(m: &[f64; 16]) -> bool {
+    (0..16).all(|i| {
+        let expected = if i % 5 == 0 { 1.0 } else { 0.0 };
+        (m[i] - expected).abs() < 1e-12
+    })
+}
+
+// 位置按完整仿射变换（f64 计算后写回 f32），法线与切线只取线性部分并重新归一化；
+// 线性部分行列式为负（镜像）时翻转三角形绕序与切线手性。
+fn transform_part(part: &mut MeshPart, m: &[f64; 16]) {
+    for p in part.positions.to_mut().chunks_exact_mut(3) {
+        let (x, y, z) = (p[0] as f64, p[1] as f64, p[2] as f64);
+        for row in 0..3 {
+            p[row] = (m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row]) as f32;
+        }
+    }
+    for n in part.normals.to_mut().chunks_exact_mut(3) {
+        transform_direction(n, m);
+    }
+
+    let det = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2])
+        + m[8] * (m[1] * m[6] - m[5] * m[2]);
+    for t in part.tangents.to_mut().chunks_exact_mut(4) {
+        transform_direction(&mut t[..3], m);
+        if det < 0.0 {
+            t[3] = -t[3];
+        }
+    }
+    if det < 0.0 {
+        if part.indices.is_empty() {
+            part.indices = (0..part.vertex_count() as u32).collect::<Vec<_>>().into();
+        }
+        for tri in part.indices.to_mut().chunks_exact_mut(3) {
+            tri.swap(1, 2);
+        }
+    }
+}
+
+fn transform_direction(d: &mut [f32], m: &[f64; 16]) {
+    let (x, y, z) = (d[0] as f64, d[1] as f64, d[2] as f64);
+    let v = [0, 1, 2].map(|row| m[row] * x + m[4 + row] * y + m[8 + row] * z);
+    let len = (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]).sqrt();
+    if len > 0.0 {
+        for row in 0..3 {
+            d[row] = (v[row] / len) as f32;
+        }
+    }
+}
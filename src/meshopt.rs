@@ -0,0 +1,595 @@
+// EXT_meshopt_compression 码流编码（ATTRIBUTES 模式 v0 与 TRIANGLES 模式 v1），
+// 与 meshoptimizer 的 meshopt_encodeVertexBuffer / meshopt_encodeIndexBuffer 输出格式一致。
+
+const VERTEX_HEADER: u8 = 0xa0;
+const INDEX_HEADER: u8 = 0xe0;
+const INDEX_VERSION: u8 = 1;
+
+const BYTE_GROUP_SIZE: usize = 16;
+const VERTEX_BLOCK_SIZE_BYTES: usize = 8192;
+const VERTEX_BLOCK_MAX_SIZE: usize = 256;
+const TAIL_MAX_SIZE: usize = 32;
+
+// 按顶点的第 k 个字节分组做差分 + zigzag，再按 16 字节一组选择 0/2/4/8 位变长编码。
+// stride 必须是 4 的倍数且不超过 256。
+pub fn encode_vertex_buffer(data: &[u8], stride: usize) -> Vec<u8> {
+    debug_assert!(stride > 0 && stride <= 256 && stride % 4 == 0);
+    let vertex_count = data.len() / stride;
+    let mut out = Vec::with_capacity(data.len() / 2 + TAIL_MAX_SIZE + 1);
+    out.push(VERTEX_HEADER);
+
+    let mut first_vertex = vec![0u8; stride];
+    if vertex_count > 0 {
+        first_vertex.copy_from_slice(&data[..stride]);
+    }
+    let mut last_vertex = first_vertex.clone();
+
+    let block_size = vertex_block_size(stride);
+    let mut buffer = [0u8; VERTEX_BLOCK_MAX_SIZE];
+    let mut offset = 0;
+    while offset < vertex_count {
+        let count = block_size.min(vertex_count - offset);
+        let block = &data[offset * stride..(offset + count) * stride];
+        let aligned = (count + BYTE_GROUP_SIZE - 1) & !(BYTE_GROUP_SIZE - 1);
+        for k in 0..stride {
+            let mut prev = last_vertex[k];
+            for i in 0..count {
+                let value = block[i * stride + k];
+                buffer[i] = zigzag8(value.wrapping_sub(prev));
+                prev = value;
+            }
+            buffer[count..aligned].fill(0);
+            encode_bytes(&mut out, &buffer[..aligned]);
+        }
+        last_vertex.copy_from_slice(&block[(count - 1) * stride..]);
+        offset += count;
+    }
+
+    // 尾部写入首个顶点（补齐到 32 字节），供解码端初始化差分基准。
+    if stride < TAIL_MAX_SIZE {
+        out.resize(out.len() + TAIL_MAX_SIZE - stride, 0);
+    }
+    out.extend_from_slice(&first_vertex);
+    out
+}
+
+fn vertex_block_size(stride: usize) -> usize {
+    let size = (VERTEX_BLOCK_SIZE_BYTES / stride) & !(BYTE_GROUP_SIZE - 1);
+    size.min(VERTEX_BLOCK_MAX_SIZE)
+}
+
+fn zigzag8(value: u8) -> u8 {
+    (((value as i8) >> 7) as u8) ^ (value << 1)
+}
+
+fn encode_bytes(out: &mut Vec<u8>, buffer: &[u8]) {
+    let group_count = buffer.len() / BYTE_GROUP_SIZE;
+    let header_offset = out.len();
+    out.resize(header_offset + group_count.div_ceil(4), 0);
+
+    for (group_index, group) in buffer.chunks_exact(BYTE_GROUP_SIZE).enumerate() {
+        // bits = 1 表示整组为 0（不写数据）。
+        let mut best_bits = 8;
+        let mut best_size = BYTE_GROUP_SIZE;
+        for bits in [1, 2, 4] {
+            if let Some(size) = measure_group(group, bits) {
+                if size < best_size {
+                    best_bits = bits;
+                    best_size = size;
+                }
+            }
+        }
+        let bitslog2 = match best_bits {
+            1 => 0,
+            2 => 1,
+            4 => 2,
+            _ => 3,
+        };
+        out[header_offset + group_index / 4] |= bitslog2 << ((group_index % 4) * 2);
+        encode_group(out, group, best_bits);
+    }
+}
+
+fn measure_group(group: &[u8], bits: usize) -> Option<usize> {
+    if bits == 1 {
+        return group.iter().all(|&b| b == 0).then_some(0);
+    }
+    let sentinel = ((1u32 << bits) - 1) as u8;
+    Some(BYTE_GROUP_SIZE * bits / 8 + group.iter().filter(|&&b| b >= sentinel).count())
+}
+
+// 定长部分每个值占 bits 位（高位在前），等于哨兵值的项随后以完整字节写出。
+fn encode_group(out: &mut Vec<u8>, group: &[u8], bits: usize) {
+    match bits {
+        1 => return,
+        8 => {
+            out.extend_from_slice(group);
+            return;
+        }
+        _ => {}
+    }
+    let per_byte = 8 / bits;
+    let sentinel = ((1u32 << bits) - 1) as u8;
+    for chunk in group.chunks_exact(per_byte) {
+        let mut byte = 0u8;
+        for &value in chunk {
+            byte = (byte << bits) | value.min(sentinel);
+        }
+        out.push(byte);
+    }
+    for &value in group {
+        if value >= sentinel {
+            out.push(value);
+        }
+    }
+}
+
+const TRIANGLE_INDEX_ORDER: [[usize; 3]; 3] = [[0, 1, 2], [1, 2, 0], [2, 0, 1]];
+const CODE_AUX_TABLE: [u8; 16] = [
+    0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0, 0,
+];
+
+// 三角形列表编码：16 项边 FIFO + 16 项顶点 FIFO，未命中的索引按与上一个自由索引的差值 varint 编码。
+pub fn encode_index_buffer(indices: &[u32]) -> Vec<u8> {
+    let triangle_count = indices.len() / 3;
+    let mut codes = Vec::with_capacity(triangle_count);
+    let mut data = Vec::with_capacity(indices.len());
+
+    let mut edge_fifo = [[u32::MAX; 2]; 16];
+    let mut vertex_fifo = [u32::MAX; 16];
+    let mut edge_offset = 0usize;
+    let mut vertex_offset = 0usize;
+    let mut next = 0u32;
+    let mut last = 0u32;
+    let fecmax = 13;
+
+    for tri in indices.chunks_exact(3) {
+        let fer = edge_fifo_find(&edge_fifo, tri, edge_offset);
+        if let Some(fer) = fer.filter(|fer| (fer >> 2) < 15) {
+            let order = TRIANGLE_INDEX_ORDER[fer & 3];
+            let (a, b, c) = (tri[order[0]], tri[order[1]], tri[order[2]]);
+            let fe = fer >> 2;
+            let fc = vertex_fifo_find(&vertex_fifo, c, vertex_offset);
+            let mut fec = match fc {
+                Some(fc) if (1..fecmax).contains(&fc) => fc,
+                _ if c == next => {
+                    next += 1;
+                    0
+                }
+                _ => 15,
+            };
+            if fec == 15 {
+                // 对条带状序列用 last - 1 / last + 1 的短码。
+                if c.wrapping_add(1) == last {
+                    fec = 13;
+                    last = c;
+                }
+                if c == last.wrapping_add(1) {
+                    fec = 14;
+                    last = c;
+                }
+            }
+            codes.push(((fe << 4) | fec) as u8);
+            if fec == 15 {
+                encode_index(&mut data, c, last);
+                last = c;
+            }
+            if fec == 0 || fec >= fecmax {
+                push_vertex_fifo(&mut vertex_fifo, c, &mut vertex_offset);
+            }
+            push_edge_fifo(&mut edge_fifo, c, b, &mut edge_offset);
+            push_edge_fifo(&mut edge_fifo, a, c, &mut edge_offset);
+        } else {
+            let rotation = if tri[1] == next {
+                1
+            } else if tri[2] == next {
+                2
+            } else {
+                0
+            };
+            let order = TRIANGLE_INDEX_ORDER[rotation];
+            let (a, b, c) = (tri[order[0]], tri[order[1]], tri[order[2]]);
+
+            let mut reset = false;
+            if a == 0 && b == 1 && c == 2 && next > 0 {
+                reset = true;
+                next = 0;
+                vertex_fifo = [u32::MAX; 16];
+            }
+
+            let fb = vertex_fifo_find(&vertex_fifo, b, vertex_offset);
+            let fc = vertex_fifo_find(&vertex_fifo, c, vertex_offset);
+            let fea = if a == next {
+                next += 1;
+                0
+            } else {
+                15
+            };
+            let feb = match fb {
+                Some(fb) if fb < 14 => fb + 1,
+                _ if b == next => {
+                    next += 1;
+                    0
+                }
+                _ => 15,
+            };
+            let fec = match fc {
+                Some(fc) if fc < 14 => fc + 1,
+                _ if c == next => {
+                    next += 1;
+                    0
+                }
+                _ => 15,
+            };
+
+            let code_aux = ((feb << 4) | fec) as u8;
+            let aux_index = CODE_AUX_TABLE[..14].iter().position(|&v| v == code_aux);
+            match aux_index {
+                Some(aux_index) if fea == 0 && !reset => codes.push(0xf0 | aux_index as u8),
+                _ => {
+                    codes.push(0xf0 | 14 | fea as u8);
+                    data.push(code_aux);
+                }
+            }
+
+            if fea == 15 {
+                encode_index(&mut data, a, last);
+                last = a;
+            }
+            if feb == 15 {
+                encode_index(&mut data, b, last);
+                last = b;
+            }
+            if fec == 15 {
+                encode_index(&mut data, c, last);
+                last = c;
+            }
+            if fea == 0 || fea == 15 {
+                push_vertex_fifo(&mut vertex_fifo, a, &mut vertex_offset);
+            }
+            if feb == 0 || feb == 15 {
+                push_vertex_fifo(&mut vertex_fifo, b, &mut vertex_offset);
+            }
+            if fec == 0 || fec == 15 {
+                push_vertex_fifo(&mut vertex_fifo, c, &mut vertex_offset);
+            }
+            push_edge_fifo(&mut edge_fifo, b, a, &mut edge_offset);
+            push_edge_fifo(&mut edge_fifo, c, b, &mut edge_offset);
+            push_edge_fifo(&mut edge_fifo, a, c, &mut edge_offset);
+        }
+    }
+
+    // 码表写在末尾，同时充当解码端越界保护的填充。
+    let mut out = Vec::with_capacity(1 + codes.len() + data.len() + 16);
+    out.push(INDEX_HEADER | INDEX_VERSION);
+    out.extend_from_slice(&codes);
+    out.extend_from_slice(&data);
+    out.extend_from_slice(&CODE_AUX_TABLE);
+    out
+}
+
+fn edge_fifo_find(fifo: &[[u32; 2]; 16], tri: &[u32], offset: usize) -> Option<usize> {
+    let (a, b, c) = (tri[0], tri[1], tri[2]);
+    for i in 0..16 {
+        let [e0, e1] = fifo[(offset.wrapping_sub(1 + i)) & 15];
+        if e0 == a && e1 == b {
+            return Some(i << 2);
+        }
+        if e0 == b && e1 == c {
+            return Some((i << 2) | 1);
+        }
+        if e0 == c && e1 == a {
+            return Some((i << 2) | 2);
+        }
+    }
+    None
+}
+
+fn push_edge_fifo(fifo: &mut [[u32; 2]; 16], a: u32, b: u32, offset: &mut usize) {
+    fifo[*offset] = [a, b];
+    *offset = (*offset + 1) & 15;
+}
+
+fn vertex_fifo_find(fifo: &[u32; 16], v: u32, offset: usize) -> Option<usize> {
+    (0..16).find(|&i| fifo[(offset.wrapping_sub(1 + i)) & 15] == v)
+}
+
+fn push_vertex_fifo(fifo: &mut [u32; 16], v: u32, offset: &mut usize) {
+    fifo[*offset] = v;
+    *offset = (*offset + 1) & 15;
+}
+
+fn encode_index(data: &mut Vec<u8>, index: u32, last: u32) {
+    let d = index.wrapping_sub(last);
+    let mut v = (d << 1) ^ (((d as i32) >> 31) as u32);
+    loop {
+        let byte = (v & 127) as u8;
+        v >>= 7;
+        if v == 0 {
+            data.push(byte);
+            break;
+        }
+        data.push(byte | 128);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // 按 meshoptimizer 的 meshopt_decodeVertexBuffer（v0）独立实现的解码器，只用于校验。
+    fn decode_vertex_buffer(buffer: &[u8], vertex_count: usize, stride: usize) -> Vec<u8> {
+        assert_eq!(buffer[0], VERTEX_HEADER);
+        let tail_size = stride.max(TAIL_MAX_SIZE);
+        let mut last_vertex = buffer[buffer.len() - stride..].to_vec();
+        let mut out = vec![0u8; vertex_count * stride];
+        let mut pos = 1;
+        let block_size = vertex_block_size(stride);
+        let mut offset = 0;
+        while offset < vertex_count {
+            let count = block_size.min(vertex_count - offset);
+            let aligned = count.div_ceil(BYTE_GROUP_SIZE) * BYTE_GROUP_SIZE;
+            for k in 0..stride {
+                let deltas = decode_bytes(buffer, &mut pos, aligned);
+                let mut prev = last_vertex[k];
+                for (i, &delta) in deltas[..count].iter().enumerate() {
+                    prev = prev.wrapping_add(((delta >> 1) as i8 ^ -((delta & 1) as i8)) as u8);
+                    out[(offset + i) * stride + k] = prev;
+                }
+            }
+            let end = (offset + count) * stride;
+            last_vertex.copy_from_slice(&out[end - stride..end]);
+            offset += count;
+        }
+        assert_eq!(pos + tail_size, buffer.len());
+        out
+    }
+
+    fn decode_bytes(buffer: &[u8], pos: &mut usize, size: usize) -> Vec<u8> {
+        let group_count = size / BYTE_GROUP_SIZE;
+        let header = *pos;
+        *pos += group_count.div_ceil(4);
+        let mut out = Vec::with_capacity(size);
+        for group in 0..group_count {
+            let bitslog2 = (buffer[header + group / 4] >> ((group % 4) * 2)) & 3;
+            match bitslog2 {
+                0 => out.extend_from_slice(&[0; BYTE_GROUP_SIZE]),
+                3 => {
+                    out.extend_from_slice(&buffer[*pos..*pos + BYTE_GROUP_SIZE]);
+                    *pos += BYTE_GROUP_SIZE;
+                }
+                _ => {
+                    let bits = 1usize << bitslog2;
+                    let sentinel = ((1u32 << bits) - 1) as u8;
+                    let packed = &buffer[*pos..*pos + BYTE_GROUP_SIZE * bits / 8];
+                    *pos += packed.len();
+                    for i in 0..BYTE_GROUP_SIZE {
+                        let shift = 8 - bits * (i % (8 / bits) + 1);
+                        let value = (packed[i * bits / 8] >> shift) & sentinel;
+                        if value == sentinel {
+                            out.push(buffer[*pos]);
+                            *pos += 1;
+                        } else {
+                            out.push(value);
+                        }
+                    }
+                }
+            }
+        }
+        out
+    }
+
+    // 按 meshopt_decodeIndexBuffer（v1）独立实现的解码器；三角形可能被旋转，但绕序不变。
+    fn decode_index_buffer(buffer: &[u8], index_count: usize) -> Vec<u32> {
+        assert_eq!(buffer[0], INDEX_HEADER | INDEX_VERSION);
+        let aux_table = &buffer[buffer.len() - 16..];
+        let mut code = 1;
+        let mut data = 1 + index_count / 3;
+        let mut edges = [[u32::MAX; 2]; 16];
+        let mut vertices = [u32::MAX; 16];
+        let (mut edge_offset, mut vertex_offset) = (0usize, 0usize);
+        let (mut next, mut last) = (0u32, 0u32);
+        let mut out = Vec::with_capacity(index_count);
+
+        let read_index = |data: &mut usize, last: u32| {
+            let mut v = 0u32;
+            let mut shift = 0;
+            loop {
+                let byte = buffer[*data];
+                *data += 1;
+                v |= ((byte & 127) as u32) << shift;
+                shift += 7;
+                if byte < 128 {
+                    break;
+                }
+            }
+            last.wrapping_add((v >> 1) ^ (v & 1).wrapping_neg())
+        };
+        let fifo =
+            |vertices: &[u32; 16], offset: usize, i: usize| vertices[offset.wrapping_sub(i) & 15];
+
+        for _ in 0..index_count / 3 {
+            let codetri = buffer[code];
+            code += 1;
+            let (a, b, c);
+            if codetri < 0xf0 {
+                [a, b] = edges[edge_offset.wrapping_sub(1 + (codetri >> 4) as usize) & 15];
+                let fec = (codetri & 15) as usize;
+                if fec == 0 {
+                    c = next;
+                    next += 1;
+                    push_vertex_fifo(&mut vertices, c, &mut vertex_offset);
+                } else if fec < 13 {
+                    c = fifo(&vertices, vertex_offset, fec + 1);
+                } else {
+                    c = match fec {
+                        13 => last.wrapping_sub(1),
+                        14 => last.wrapping_add(1),
+                        _ => read_index(&mut data, last),
+                    };
+                    last = c;
+                    push_vertex_fifo(&mut vertices, c, &mut vertex_offset);
+                }
+            } else {
+                let (fea, aux) = if codetri < 0xfe {
+                    (0, aux_table[(codetri & 15) as usize])
+                } else {
+                    data += 1;
+                    (if codetri == 0xfe { 0 } else { 15 }, buffer[data - 1])
+                };
+                if codetri >= 0xfe && aux == 0 {
+                    next = 0;
+                }
+                let (feb, fec) = ((aux >> 4) as usize, (aux & 15) as usize);
+                let pick = |fe: usize, next: &mut u32, data: &mut usize, last: &mut u32| {
+                    match fe {
+                        0 => {
+                            *next += 1;
+                            *next - 1
+                        }
+                        15 => {
+                            *last = read_index(data, *last);
+                            *last
+                        }
+                        _ => fifo(&vertices, vertex_offset, fe),
+                    }
+                };
+                a = pick(fea, &mut next, &mut data, &mut last);
+                b = pick(feb, &mut next, &mut data, &mut last);
+                c = pick(fec, &mut next, &mut data, &mut last);
+                push_vertex_fifo(&mut vertices, a, &mut vertex_offset);
+                if feb == 0 || feb == 15 {
+                    push_vertex_fifo(&mut vertices, b, &mut vertex_offset);
+                }
+                if fec == 0 || fec == 15 {
+                    push_vertex_fifo(&mut vertices, c, &mut vertex_offset);
+                }
+                push_edge_fifo(&mut edges, b, a, &mut edge_offset);
+            }
+            push_edge_fifo(&mut edges, c, b, &mut edge_offset);
+            push_edge_fifo(&mut edges, a, c, &mut edge_offset);
+            out.extend_from_slice(&[a, b, c]);
+        }
+        assert_eq!(data + 16, buffer.len());
+        out
+    }
+
+    fn assert_same_triangles(decoded: &[u32], indices: &[u32]) {
+        assert_eq!(decoded.len(), indices.len());
+        for (got, want) in decoded.chunks_exact(3).zip(indices.chunks_exact(3)) {
+            let rotations = [
+                [got[0], got[1], got[2]],
+                [got[1], got[2], got[0]],
+                [got[2], got[0], got[1]],
+            ];
+            assert!(rotations.contains(&[want[0], want[1], want[2]]), "{got:?} != {want:?}");
+        }
+    }
+
+    fn round_trip_indices(indices: &[u32]) {
+        let encoded = encode_index_buffer(indices);
+        assert_same_triangles(&decode_index_buffer(&encoded, indices.len()), indices);
+    }
+
+    // 线性同余伪随机数，保证测试可复现。
+    fn lcg(seed: &mut u32) -> u32 {
+        *seed = seed.wrapping_mul(1664525).wrapping_add(1013904223);
+        *seed >> 8
+    }
+
+    #[test]
+    fn single_triangle_is_byte_exact() {
+        let mut expected = vec![0xe1, 0xf0];
+        expected.extend_from_slice(&CODE_AUX_TABLE);
+        assert_eq!(encode_index_buffer(&[0, 1, 2]), expected);
+    }
+
+    #[test]
+    fn index_reset_is_byte_exact() {
+        // 第二个三角形重新从 0 编号：长码 0xfe 加 codeaux 0 表示复位。
+        let mut expected = vec![0xe1, 0xf0, 0xfe, 0x00];
+        expected.extend_from_slice(&CODE_AUX_TABLE);
+        assert_eq!(encode_index_buffer(&[0, 1, 2, 0, 1, 2]), expected);
+    }
+
+    #[test]
+    fn single_vertex_is_byte_exact() {
+        let mut expected = vec![0xa0, 0, 0, 0, 0];
+        expected.extend_from_slice(&[0; TAIL_MAX_SIZE - 4]);
+        expected.extend_from_slice(&[1, 2, 3, 4]);
+        assert_eq!(encode_vertex_buffer(&[1, 2, 3, 4], 4), expected);
+    }
+
+    #[test]
+    fn index_strip_round_trips() {
+        let mut indices = Vec::new();
+        for i in 0..200u32 {
+            if i % 2 == 0 {
+                indices.extend_from_slice(&[i, i + 1, i + 2]);
+            } else {
+                indices.extend_from_slice(&[i + 1, i, i + 2]);
+            }
+        }
+        // 编号递减的条带走 last - 1 短码。
+        for i in 0..200u32 {
+            let v = 10_000 - i;
+            if i % 2 == 0 {
+                indices.extend_from_slice(&[v, v - 1, v - 2]);
+            } else {
+                indices.extend_from_slice(&[v - 1, v, v - 2]);
+            }
+        }
+        round_trip_indices(&indices);
+    }
+
+    #[test]
+    fn index_fan_round_trips() {
+        let indices: Vec<u32> = (1..100u32).flat_map(|i| [0, i, i + 1]).collect();
+        round_trip_indices(&indices);
+    }
+
+    #[test]
+    fn index_reset_round_trips() {
+        // 多个子网格各自从 0 开始编号时触发 next 复位。
+        let mesh = [0, 1, 2, 2, 1, 3, 3, 1, 4];
+        let indices: Vec<u32> = mesh.iter().chain(&mesh).chain(&mesh).copied().collect();
+        round_trip_indices(&indices);
+    }
+
+    #[test]
+    fn index_u32_and_scattered_round_trips() {
+        let mut seed = 1;
+        let grid = 20u32;
+        let mut indices = Vec::new();
+        for y in 0..grid - 1 {
+            for x in 0..grid - 1 {
+                let v = 70_000 + y * grid + x;
+                indices.extend_from_slice(&[v, v + grid, v + 1, v + 1, v + grid, v + grid + 1]);
+            }
+        }
+        for _ in 0..300 {
+            indices.extend_from_slice(&[lcg(&mut seed), lcg(&mut seed), lcg(&mut seed)]);
+        }
+        indices.extend_from_slice(&[u32::MAX, 0, u32::MAX - 1]);
+        round_trip_indices(&indices);
+    }
+
+    #[test]
+    fn vertex_buffer_round_trips() {
+        let mut seed = 7;
+        for (stride, count) in [(4, 0), (4, 1), (12, 17), (16, 1000), (32, 300), (256, 40)] {
+            let mut data = vec![0u8; stride * count];
+            let half = data.len() / 2;
+            for (i, byte) in data.iter_mut().enumerate() {
+                // 前半平滑变化（小差值），后半随机，覆盖 0/2/4/8 位各种分组。
+                *byte = if i < half {
+                    (i / stride + i % stride) as u8 / 3
+                } else {
+                    lcg(&mut seed) as u8
+                };
+            }
+            let encoded = encode_vertex_buffer(&data, stride);
+            assert_eq!(decode_vertex_buffer(&encoded, count, stride), data, "stride {stride}");
+        }
+    }
+}
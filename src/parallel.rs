@@ -0,0 +1,69 @@
+use anyhow::Result;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Mutex;
+use std::thread;
+
+pub fn resolve_jobs(requested: usize, item_count: usize) -> usize {
+    let jobs = if requested == 0 {
+        thread::available_parallelism().map(|n| n.get()).unwrap_or(1)
+    } else {
+        requested
+    };
+    jobs.min(item_count).max(1)
+}
+
+// 在 jobs 个线程上并行处理 items，结果保持输入顺序；任一任务失败后其余线程尽快停止。
+pub fn parallel_map<T: Send, R: Send>(
+    jobs: usize,
+    items: Vec<T>,
+    f: impl Fn(T) -> Result<R> + Sync,
+) -> Result<Vec<R>> {
+    parallel_map_with(jobs, items, || (), |_, item| f(item))
+}
+
+// 同 parallel_map，但每个工作线程先用 init 创建一份独享状态（如临时缓冲），在其处理的所有任务间复用。
+pub fn parallel_map_with<T: Send, R: Send, S>(
+    jobs: usize,
+    items: Vec<T>,
+    init: impl Fn() -> S + Sync,
+    f: impl Fn(&mut S, T) -> Result<R> + Sync,
+) -> Result<Vec<R>> {
+    let count = items.len();
+    let jobs = resolve_jobs(jobs, count);
+    let queue = Mutex::new(items.into_iter().enumerate());
+    let failed = AtomicBool::new(false);
+    let mut results: Vec<Option<R>> = (0..count).map(|_| None).collect();
+    thread::scope(|s| -> Result<()> {
+        let workers: Vec<_> = (0..jobs)
+            .map(|_| {
+                s.spawn(|| -> Result<Vec<(usize, R)>> {
+                    let mut state = init();
+                    let mut done = Vec::new();
+                    while !failed.load(Ordering::Relaxed) {
+                        let Some((index, item)) = queue.lock().unwrap().next() else {
+                            break;
+                        };
+                        match f(&mut state, item) {
+                            Ok(result) => done.push((index, result)),
+                            Err(err) => {
+                                failed.store(true, Ordering::Relaxed);
+                                return Err(err);
+                            }
+                        }
+                    }
+                    Ok(done)
+                })
+            })
+            .collect();
+        for worker in workers {
+            for (index, result) in worker.join().expect("worker thread panicked")? {
+                results[index] = Some(result);
+            }
+        }
+        Ok(())
+    })?;
+    Ok(results
+        .into_iter()
+        .map(|result| result.expect("parallel_map result missing"))
+        .collect())
+}
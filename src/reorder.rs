@@ -0,0 +1,251 @@
+use crate::ufbx_loader::MeshPart;
+
+// 模拟的后变换顶点缓存大小（FIFO）。
+const CACHE_SIZE: usize = 16;
+
+// 压缩前的网格重排：顶点缓存优化 -> 按簇的过绘制排序 -> 顶点按首次引用重新编号。
+// 重排后相邻三角形共享边、相邻顶点在内存中也相邻，meshopt 的差分编码收益更大。
+pub fn optimize_mesh_part(part: &MeshPart) -> MeshPart {
+    let vertex_count = part.vertex_count();
+    let indices = optimize_vertex_cache(&part.indices, vertex_count);
+    let indices = optimize_overdraw(&indices, &part.positions);
+
+    let mut remap = vec![u32::MAX; vertex_count];
+    let mut next = 0u32;
+    let indices: Vec<u32> = indices
+        .iter()
+        .map(|&index| {
+            let slot = &mut remap[index as usize];
+            if *slot == u32::MAX {
+                *slot = next;
+                next += 1;
+            }
+            *slot
+        })
+        .collect();
+    let new_count = next as usize;
+
+    MeshPart {
+        name: part.name.clone(),
+        material_index: part.material_index,
+        positions: remap_attribute(&part.positions, 3, &remap, new_count).into(),
+        normals: remap_attribute(&part.normals, 3, &remap, new_count).into(),
+        uvs: remap_attribute(&part.uvs, 2, &remap, new_count).into(),
+        colors: remap_attribute(&part.colors, 4, &remap, new_count).into(),
+        tangents: remap_attribute(&part.tangents, 4, &remap, new_count).into(),
+        indices: indices.into(),
+    }
+}
+
+// 长度与顶点数不符的属性（缺失）原样保留，写出端会省略它。
+fn remap_attribute(data: &[f32], components: usize, remap: &[u32], new_count: usize) -> Vec<f32> {
+    if data.len() != remap.len() * components {
+        return data.to_vec();
+    }
+    let mut out = vec![0.0f32; new_count * components];
+    for (old, &new) in remap.iter().enumerate() {
+        if new != u32::MAX {
+            let new = new as usize;
+            out[new * components..(new + 1) * components]
+                .copy_from_slice(&data[old * components..(old + 1) * components]);
+        }
+    }
+    out
+}
+
+fn vertex_score(cache_position: Option<usize>, live_triangles: u32) -> f32 {
+    if live_triangles == 0 {
+        return -1.0;
+    }
+    let cache = match cache_position {
+        Some(position) if position < 3 => 0.75,
+        Some(position) => {
+            (1.0 - (position - 3) as f32 / (CACHE_SIZE - 3) as f32).powf(1.5)
+        }
+        None => 0.0,
+    };
+    cache + 2.0 / (live_triangles as f32).sqrt()
+}
+
+// Forsyth 线性顶点缓存优化：每步从缓存内顶点的相邻三角形中取得分最高者，
+// 没有候选时按输入顺序取下一个未输出的三角形。
+pub fn optimize_vertex_cache(indices: &[u32], vertex_count: usize) -> Vec<u32> {
+    let triangle_count = indices.len() / 3;
+
+    // 顶点 -> 三角形邻接表（CSR），live[v] 之前的部分为尚未输出的三角形。
+    let mut offsets = vec![0usize; vertex_count + 1];
+    for &index in indices {
+        offsets[index as usize + 1] += 1;
+    }
+    for v in 0..vertex_count {
+        offsets[v + 1] += offsets[v];
+    }
+    let mut adjacency = vec![0u32; indices.len()];
+    let mut live = vec![0u32; vertex_count];
+    for (tri, corners) in indices.chunks_exact(3).enumerate() {
+        for &v in corners {
+            let v = v as usize;
+            adjacency[offsets[v] + live[v] as usize] = tri as u32;
+            live[v] += 1;
+        }
+    }
+
+    let mut cache_position: Vec<Option<usize>> = vec![None; vertex_count];
+    let mut vertex_scores: Vec<f32> = live.iter().map(|&n| vertex_score(None, n)).collect();
+    let triangle_score = |scores: &[f32], tri: usize| {
+        indices[tri * 3..tri * 3 + 3]
+            .iter()
+            .map(|&v| scores[v as usize])
+            .sum::<f32>()
+    };
+    let mut emitted = vec![false; triangle_count];
+    let mut cache: Vec<u32> = Vec::with_capacity(CACHE_SIZE + 3);
+    let mut next_cache: Vec<u32> = Vec::with_capacity(CACHE_SIZE + 3);
+    let mut out = Vec::with_capacity(indices.len());
+    let mut input_cursor = 0;
+    let mut best: Option<usize> = None;
+
+    loop {
+        let tri = match best {
+            Some(tri) => tri,
+            None => {
+                while input_cursor < triangle_count && emitted[input_cursor] {
+                    input_cursor += 1;
+                }
+                if input_cursor == triangle_count {
+                    break;
+                }
+                input_cursor
+            }
+        };
+        let corners = &indices[tri * 3..tri * 3 + 3];
+        out.extend_from_slice(corners);
+        emitted[tri] = true;
+
+        for &v in corners {
+            let v = v as usize;
+            let range = &mut adjacency[offsets[v]..offsets[v] + live[v] as usize];
+            if let Some(slot) = range.iter().position(|&t| t as usize == tri) {
+                let last = range.len() - 1;
+                range.swap(slot, last);
+                live[v] -= 1;
+            }
+        }
+
+        next_cache.clear();
+        next_cache.extend_from_slice(corners);
+        next_cache.extend(cache.iter().copied().filter(|v| !corners.contains(v)));
+        for (position, &v) in next_cache.iter().enumerate() {
+            let position = (position < CACHE_SIZE).then_some(position);
+            cache_position[v as usize] = position;
+            vertex_scores[v as usize] = vertex_score(position, live[v as usize]);
+        }
+
+        best = None;
+        let mut best_score = f32::NEG_INFINITY;
+        for &v in &next_cache {
+            let v = v as usize;
+            for &t in &adjacency[offsets[v]..offsets[v] + live[v] as usize] {
+                let score = triangle_score(&vertex_scores, t as usize);
+                if score > best_score {
+                    best_score = score;
+                    best = Some(t as usize);
+                }
+            }
+        }
+
+        next_cache.truncate(CACHE_SIZE);
+        std::mem::swap(&mut cache, &mut next_cache);
+    }
+    out
+}
+
+// 过绘制排序：先按 FIFO 缓存模拟在三个顶点全部未命中处切分簇（保持簇内缓存局部性），
+// 再按簇朝外程度（簇质心相对网格中心的偏移在簇法线上的投影）降序排列，外层表面先绘制。
+pub fn optimize_overdraw(indices: &[u32], positions: &[f32]) -> Vec<u32> {
+    let triangle_count = indices.len() / 3;
+    let vertex_count = positions.len() / 3;
+    if triangle_count == 0 || vertex_count == 0 {
+        return indices.to_vec();
+    }
+
+    let mut cache_time = vec![0usize; vertex_count];
+    let mut timestamp = CACHE_SIZE + 1;
+    let mut cluster_starts = Vec::new();
+    for (tri, corners) in indices.chunks_exact(3).enumerate() {
+        let mut misses = 0;
+        for &v in corners {
+            let v = v as usize;
+            if timestamp - cache_time[v] > CACHE_SIZE {
+                cache_time[v] = timestamp;
+                timestamp += 1;
+                misses += 1;
+            }
+        }
+        if tri == 0 || misses == 3 {
+            cluster_starts.push(tri);
+        }
+    }
+
+    let mut mesh_center = [0.0f64; 3];
+    for p in positions.chunks_exact(3) {
+        for axis in 0..3 {
+            mesh_center[axis] += p[axis] as f64;
+        }
+    }
+    for value in &mut mesh_center {
+        *value /= vertex_count as f64;
+    }
+
+    let position = |v: u32| {
+        let v = v as usize * 3;
+        [
+            positions[v] as f64,
+            positions[v + 1] as f64,
+            positions[v + 2] as f64,
+        ]
+    };
+    let mut clusters: Vec<(f64, usize, usize)> = Vec::with_capacity(cluster_starts.len());
+    for (i, &start) in cluster_starts.iter().enumerate() {
+        let end = cluster_starts.get(i + 1).copied().unwrap_or(triangle_count);
+        let mut centroid = [0.0f64; 3];
+        let mut normal = [0.0f64; 3];
+        let mut area_sum = 0.0f64;
+        for corners in indices[start * 3..end * 3].chunks_exact(3) {
+            let p0 = position(corners[0]);
+            let p1 = position(corners[1]);
+            let p2 = position(corners[2]);
+            let e1 = [p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]];
+            let e2 = [p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]];
+            let n = [
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0],
+            ];
+            let area = (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]).sqrt();
+            for axis in 0..3 {
+                centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.0 * area;
+                normal[axis] += n[axis];
+            }
+            area_sum += area;
+        }
+        let score = if area_sum > 0.0 {
+            let length =
+                (normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]).sqrt();
+            let length = if length > 0.0 { length } else { 1.0 };
+            (0..3)
+                .map(|axis| (centroid[axis] / area_sum - mesh_center[axis]) * normal[axis] / length)
+                .sum()
+        } else {
+            0.0
+        };
+        clusters.push((score, start, end));
+    }
+
+    clusters.sort_by(|a, b| b.0.total_cmp(&a.0));
+    let mut out = Vec::with_capacity(indices.len());
+    for (_, start, end) in clusters {
+        out.extend_from_slice(&indices[start * 3..end * 3]);
+    }
+    out
+}
@@ -0,0 +1,511 @@
+use crate::ufbx_loader::MeshPart;
+use std::cmp::Ordering;
+use std::collections::{BinaryHeap, HashMap};
+
+// 边界边的约束平面权重，越大越倾向于保持开放边界的形状。
+const BORDER_WEIGHT: f64 = 10.0;
+// 折叠后三角形法线与原法线的最小夹角余弦，低于此值视为翻转。
+const MIN_FLIP_COS: f64 = 0.2;
+
+// 对称 4x4 误差二次型，按 (a00 a01 a02 a03 a11 a12 a13 a22 a23 a33) 存放。
+#[derive(Clone, Copy, Default)]
+struct Quadric {
+    m: [f64; 10],
+    weight: f64,
+}
+
+impl Quadric {
+    fn from_plane(n: [f64; 3], d: f64, weight: f64) -> Self {
+        let [a, b, c] = n;
+        Self {
+            m: [
+                a * a * weight,
+                a * b * weight,
+                a * c * weight,
+                a * d * weight,
+                b * b * weight,
+                b * c * weight,
+                b * d * weight,
+                c * c * weight,
+                c * d * weight,
+                d * d * weight,
+            ],
+            weight,
+        }
+    }
+
+    fn add(&mut self, other: &Quadric) {
+        for i in 0..10 {
+            self.m[i] += other.m[i];
+        }
+        self.weight += other.weight;
+    }
+
+    fn eval(&self, p: [f64; 3]) -> f64 {
+        let [x, y, z] = p;
+        let m = &self.m;
+        let value = m[0] * x * x
+            + 2.0 * m[1] * x * y
+            + 2.0 * m[2] * x * z
+            + 2.0 * m[3] * x
+            + m[4] * y * y
+            + 2.0 * m[5] * y * z
+            + 2.0 * m[6] * y
+            + m[7] * z * z
+            + 2.0 * m[8] * z
+            + m[9];
+        value.max(0.0)
+    }
+}
+
+struct Collapse {
+    cost: f64,
+    from: u32,
+    to: u32,
+    from_version: u32,
+    to_version: u32,
+}
+
+impl PartialEq for Collapse {
+    fn eq(&self, other: &Self) -> bool {
+        self.cost.total_cmp(&other.cost) == Ordering::Equal
+    }
+}
+
+impl Eq for Collapse {}
+
+impl PartialOrd for Collapse {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for Collapse {
+    // BinaryHeap 为大顶堆，这里反转比较让代价最小的折叠先出堆。
+    fn cmp(&self, other: &Self) -> Ordering {
+        other.cost.total_cmp(&self.cost)
+    }
+}
+
+// 基于二次误差度量（QEM）的半边折叠简化，直到三角形数不超过 target_triangles。
+// 拓扑在“位置组”（坐标完全相同的顶点）上计算，因此法线/UV 接缝两侧可以一起折叠；
+// 输出时每个角点从目标位置组中挑选属性最接近原顶点的那一个。
+// locked 标记不可移动的顶点（例如 tile 边界上的顶点，保证相邻 tile 不开裂）。
+// 返回简化后的网格与最大误差（本地坐标单位下的距离）。
+pub fn simplify_mesh(part: &MeshPart, locked: &[bool], target_triangles: usize) -> (MeshPart, f64) {
+    let vertex_count = part.vertex_count();
+    let triangle_count = part.triangle_count();
+    if triangle_count <= target_triangles || vertex_count < 3 {
+        return (part.clone(), 0.0);
+    }
+
+    let (vertex_group, group_count) = position_groups(&part.positions);
+    let mut group_vertices: Vec<Vec<u32>> = vec![Vec::new(); group_count];
+    for (vertex, group) in vertex_group.iter().enumerate() {
+        group_vertices[*group as usize].push(vertex as u32);
+    }
+    let group_position = |group: u32| -> [f64; 3] {
+        let vertex = group_vertices[group as usize][0] as usize;
+        [
+            part.positions[vertex * 3] as f64,
+            part.positions[vertex * 3 + 1] as f64,
+            part.positions[vertex * 3 + 2] as f64,
+        ]
+    };
+
+    let mut group_locked = vec![false; group_count];
+    for (vertex, is_locked) in locked.iter().enumerate().take(vertex_count) {
+        if *is_locked {
+            group_locked[vertex_group[vertex] as usize] = true;
+        }
+    }
+
+    // 三角形：原始角点顶点 + 当前所在的位置组。
+    let mut corners: Vec<[u32; 3]> = Vec::with_capacity(triangle_count);
+    let mut tri_groups: Vec<[u32; 3]> = Vec::with_capacity(triangle_count);
+    for tri in 0..triangle_count {
+        let vertices = part.triangle(tri);
+        if vertices.iter().any(|&v| v >= vertex_count) {
+            continue;
+        }
+        let groups = vertices.map(|v| vertex_group[v]);
+        if groups[0] == groups[1] || groups[1] == groups[2] || groups[0] == groups[2] {
+            continue;
+        }
+        corners.push(vertices.map(|v| v as u32));
+        tri_groups.push(groups);
+    }
+
+    let mut tri_alive = vec![true; tri_groups.len()];
+    let mut live_triangles = tri_groups.len();
+    let mut group_tris: Vec<Vec<u32>> = vec![Vec::new(); group_count];
+    for (tri, groups) in tri_groups.iter().enumerate() {
+        for group in groups {
+            group_tris[*group as usize].push(tri as u32);
+        }
+    }
+
+    let mut quadrics = vec![Quadric::default(); group_count];
+    let mut edge_use: HashMap<(u32, u32), u32> = HashMap::new();
+    for groups in &tri_groups {
+        let p = groups.map(group_position);
+        let normal = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+        let area2 = length(normal);
+        if area2 <= 0.0 {
+            continue;
+        }
+        let n = scale(normal, 1.0 / area2);
+        let q = Quadric::from_plane(n, -dot(n, p[0]), area2 * 0.5);
+        for group in groups {
+            quadrics[*group as usize].add(&q);
+        }
+        for i in 0..3 {
+            let a = groups[i];
+            let b = groups[(i + 1) % 3];
+            *edge_use.entry((a.min(b), a.max(b))).or_insert(0) += 1;
+        }
+    }
+
+    // 开放边界：沿边加一个垂直于三角形的约束平面。
+    let mut group_border = vec![false; group_count];
+    for groups in &tri_groups {
+        let p = groups.map(group_position);
+        let normal = normalize(cross(sub(p[1], p[0]), sub(p[2], p[0])));
+        for i in 0..3 {
+            let a = groups[i];
+            let b = groups[(i + 1) % 3];
+            if edge_use.get(&(a.min(b), a.max(b))).copied() != Some(1) {
+                continue;
+            }
+            group_border[a as usize] = true;
+            group_border[b as usize] = true;
+            let pa = p[i];
+            let pb = p[(i + 1) % 3];
+            let edge = sub(pb, pa);
+            let edge_len_sq = dot(edge, edge);
+            let border_normal = normalize(cross(edge, normal));
+            if length(border_normal) <= 0.0 {
+                continue;
+            }
+            let q = Quadric::from_plane(
+                border_normal,
+                -dot(border_normal, pa),
+                edge_len_sq * BORDER_WEIGHT,
+            );
+            quadrics[a as usize].add(&q);
+            quadrics[b as usize].add(&q);
+        }
+    }
+    drop(edge_use);
+
+    let collapse_cost = |quadrics: &[Quadric], from: u32, to: u32| -> f64 {
+        let mut q = quadrics[from as usize];
+        q.add(&quadrics[to as usize]);
+        let cost = q.eval(group_position(to));
+        if q.weight > 0.0 { cost / q.weight } else { cost }
+    };
+
+    let mut version = vec![0u32; group_count];
+    let mut heap = BinaryHeap::new();
+    let push_edges = |heap: &mut BinaryHeap<Collapse>,
+                      quadrics: &[Quadric],
+                      version: &[u32],
+                      tri_groups: &[[u32; 3]],
+                      tris: &[u32],
+                      center: u32| {
+        for tri in tris {
+            for other in tri_groups[*tri as usize] {
+                if other == center {
+                    continue;
+                }
+                for (from, to) in [(center, other), (other, center)] {
+                    if group_locked[from as usize] {
+                        continue;
+                    }
+                    heap.push(Collapse {
+                        cost: collapse_cost(quadrics, from, to),
+                        from,
+                        to,
+                        from_version: version[from as usize],
+                        to_version: version[to as usize],
+                    });
+                }
+            }
+        }
+    };
+    for group in 0..group_count as u32 {
+        if group_locked[group as usize] {
+            continue;
+        }
+        for tri in &group_tris[group as usize] {
+            for other in tri_groups[*tri as usize] {
+                if other == group {
+                    continue;
+                }
+                heap.push(Collapse {
+                    cost: collapse_cost(&quadrics, group, other),
+                    from: group,
+                    to: other,
+                    from_version: 0,
+                    to_version: 0,
+                });
+            }
+        }
+    }
+
+    let mut remap: Vec<u32> = (0..group_count as u32).collect();
+    let mut max_error = 0.0f64;
+    let mut neighbor_scratch: Vec<u32> = Vec::new();
+
+    while live_triangles > target_triangles {
+        let Some(collapse) = heap.pop() else {
+            break;
+        };
+        let from = collapse.from;
+        let to = collapse.to;
+        if version[from as usize] != collapse.from_version
+            || version[to as usize] != collapse.to_version
+            || remap[from as usize] != from
+            || remap[to as usize] != to
+        {
+            continue;
+        }
+
+        // 统计共享边 (from, to) 的三角形，并检查边界约束与链接条件。
+        let mut shared = 0usize;
+        for tri in &group_tris[from as usize] {
+            if tri_alive[*tri as usize] && tri_groups[*tri as usize].contains(&to) {
+                shared += 1;
+            }
+        }
+        if shared == 0 {
+            continue;
+        }
+        if group_border[from as usize] && shared != 1 {
+            continue;
+        }
+        neighbor_scratch.clear();
+        for tri in &group_tris[from as usize] {
+            if !tri_alive[*tri as usize] {
+                continue;
+            }
+            for other in tri_groups[*tri as usize] {
+                if other != from && other != to && !neighbor_scratch.contains(&other) {
+                    neighbor_scratch.push(other);
+                }
+            }
+        }
+        let mut common = 0usize;
+        for other in &neighbor_scratch {
+            let adjacent_to_target = group_tris[to as usize].iter().any(|tri| {
+                tri_alive[*tri as usize] && tri_groups[*tri as usize].contains(other)
+            });
+            if adjacent_to_target {
+                common += 1;
+            }
+        }
+        if common > shared {
+            continue;
+        }
+
+        // 检查 from 移动到 to 后周围三角形是否翻转或退化。
+        let target_pos = group_position(to);
+        let mut valid = true;
+        for tri in &group_tris[from as usize] {
+            let tri = *tri as usize;
+            if !tri_alive[tri] || tri_groups[tri].contains(&to) {
+                continue;
+            }
+            let p = tri_groups[tri].map(group_position);
+            let before = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+            let moved = tri_groups[tri].map(|g| if g == from { target_pos } else { group_position(g) });
+            let after = cross(sub(moved[1], moved[0]), sub(moved[2], moved[0]));
+            let before_len = length(before);
+            let after_len = length(after);
+            if after_len <= before_len * 1e-6 || dot(before, after) < MIN_FLIP_COS * before_len * after_len {
+                valid = false;
+                break;
+            }
+        }
+        if !valid {
+            continue;
+        }
+
+        max_error = max_error.max(collapse.cost);
+        remap[from as usize] = to;
+        let from_q = quadrics[from as usize];
+        quadrics[to as usize].add(&from_q);
+        if group_border[from as usize] {
+            group_border[to as usize] = true;
+        }
+
+        let moved_tris = std::mem::take(&mut group_tris[from as usize]);
+        for tri in &moved_tris {
+            let t = *tri as usize;
+            if !tri_alive[t] {
+                continue;
+            }
+            if tri_groups[t].contains(&to) {
+                tri_alive[t] = false;
+                live_triangles -= 1;
+                continue;
+            }
+            for group in tri_groups[t].iter_mut() {
+                if *group == from {
+                    *group = to;
+                }
+            }
+            group_tris[to as usize].push(*tri);
+        }
+        group_tris[to as usize].retain(|tri| tri_alive[*tri as usize]);
+
+        // 只有与 to 相关的折叠代价发生了变化；其余边的合法性在出堆时重新检查。
+        version[to as usize] += 1;
+        push_edges(
+            &mut heap,
+            &quadrics,
+            &version,
+            &tri_groups,
+            &group_tris[to as usize],
+            to,
+        );
+    }
+
+    let mut indices = Vec::with_capacity(live_triangles * 3);
+    for (tri, alive) in tri_alive.iter().enumerate() {
+        if !*alive {
+            continue;
+        }
+        for corner in 0..3 {
+            let original = corners[tri][corner];
+            let group = tri_groups[tri][corner];
+            let vertex = if vertex_group[original as usize] == group {
+                original
+            } else {
+                closest_vertex(part, &group_vertices[group as usize], original as usize)
+            };
+            indices.push(vertex);
+        }
+    }
+
+    (compact_mesh(part, &indices), max_error.sqrt())
+}
+
+// 坐标按位完全相同的顶点归为同一位置组。
+fn position_groups(positions: &[f32]) -> (Vec<u32>, usize) {
+    let mut map: HashMap<[u32; 3], u32> = HashMap::with_capacity(positions.len() / 3);
+    let mut groups = Vec::with_capacity(positions.len() / 3);
+    for p in positions.chunks_exact(3) {
+        let key = [p[0].to_bits(), p[1].to_bits(), p[2].to_bits()];
+        let next = map.len() as u32;
+        groups.push(*map.entry(key).or_insert(next));
+    }
+    let count = map.len();
+    (groups, count)
+}
+
+// 在目标位置组中挑选法线/UV 与原顶点最接近的顶点，尽量保持接缝两侧的属性。
+fn closest_vertex(part: &MeshPart, candidates: &[u32], original: usize) -> u32 {
+    let has_normals = part.normals.len() == part.positions.len();
+    let has_uvs = part.uvs.len() * 3 == part.positions.len() * 2;
+    let mut best = candidates[0];
+    let mut best_score = f32::NEG_INFINITY;
+    for &candidate in candidates {
+        let c = candidate as usize;
+        let mut score = 0.0f32;
+        if has_normals {
+            for axis in 0..3 {
+                score += part.normals[c * 3 + axis] * part.normals[original * 3 + axis];
+            }
+        }
+        if has_uvs {
+            let du = part.uvs[c * 2] - part.uvs[original * 2];
+            let dv = part.uvs[c * 2 + 1] - part.uvs[original * 2 + 1];
+            score -= du * du + dv * dv;
+        }
+        if score > best_score {
+            best_score = score;
+            best = candidate;
+        }
+    }
+    best
+}
+
+// 只保留索引引用到的顶点，并重新编号。
+pub fn compact_mesh(part: &MeshPart, indices: &[u32]) -> MeshPart {
+    let vertex_count = part.vertex_count();
+    let has_normals = part.normals.len() == vertex_count * 3;
+    let has_uvs = part.uvs.len() == vertex_count * 2;
+    let has_colors = part.colors.len() == vertex_count * 4;
+    let has_tangents = part.tangents.len() == vertex_count * 4;
+
+    let mut remap = vec![u32::MAX; vertex_count];
+    let mut positions = Vec::new();
+    let mut normals = Vec::new();
+    let mut uvs = Vec::new();
+    let mut colors = Vec::new();
+    let mut tangents = Vec::new();
+    let mut out_indices = Vec::with_capacity(indices.len());
+    for &index in indices {
+        let v = index as usize;
+        if remap[v] == u32::MAX {
+            remap[v] = (positions.len() / 3) as u32;
+            positions.extend_from_slice(&part.positions[v * 3..v * 3 + 3]);
+            if has_normals {
+                normals.extend_from_slice(&part.normals[v * 3..v * 3 + 3]);
+            }
+            if has_uvs {
+                uvs.extend_from_slice(&part.uvs[v * 2..v * 2 + 2]);
+            }
+            if has_colors {
+                colors.extend_from_slice(&part.colors[v * 4..v * 4 + 4]);
+            }
+            if has_tangents {
+                tangents.extend_from_slice(&part.tangents[v * 4..v * 4 + 4]);
+            }
+        }
+        out_indices.push(remap[v]);
+    }
+    MeshPart {
+        name: part.name.clone(),
+        material_index: part.material_index,
+        positions: positions.into(),
+        normals: normals.into(),
+        uvs: uvs.into(),
+        colors: colors.into(),
+        tangents: tangents.into(),
+        indices: out_indices.into(),
+    }
+}
+
+fn sub(a: [f64; 3], b: [f64; 3]) -> [f64; 3] {
+    [a[0] - b[0], a[1] - b[1], a[2] - b[2]]
+}
+
+fn cross(a: [f64; 3], b: [f64; 3]) -> [f64; 3] {
+    [
+        a[1] * b[2] - a[2] * b[1],
+        a[2] * b[0] - a[0] * b[2],
+        a[0] * b[1] - a[1] * b[0],
+    ]
+}
+
+fn dot(a: [f64; 3], b: [f64; 3]) -> f64 {
+    a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+}
+
+fn length(v: [f64; 3]) -> f64 {
+    dot(v, v).sqrt()
+}
+
+fn scale(v: [f64; 3], s: f64) -> [f64; 3] {
+    [v[0] * s, v[1] * s, v[2] * s]
+}
+
+fn normalize(v: [f64; 3]) -> [f64; 3] {
+    let len = length(v);
+    if len <= 0.0 {
+        return [0.0; 3];
+    }
+    scale(v, 1.0 / len)
+}
@@ -0,0 +1,292 @@
+use anyhow::{Context, Result};
+use serde_json::{json, Map, Value};
+use std::collections::BTreeMap;
+use std::fs;
+use std::path::Path;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Mutex, OnceLock};
+use std::time::{Duration, Instant};
+
+// 进程级运行统计（--stats / --trace）。未启用时 span 与 add 只做一次原子读，热路径上可直接调用；
+// 逐三角形的计数应先在调用方累加，再按批次 add。
+static ENABLED: AtomicBool = AtomicBool::new(false);
+static COLLECTOR: OnceLock<Collector> = OnceLock::new();
+static NEXT_THREAD: AtomicU64 = AtomicU64::new(1);
+
+thread_local! {
+    static THREAD_ID: u64 = NEXT_THREAD.fetch_add(1, Ordering::Relaxed);
+}
+
+// 纹理缓存计数以 texture_cache.<缓存>.hits / .misses 命名，报告中另按缓存汇总命中率。
+const TEXTURE_CACHE_PREFIX: &str = "texture_cache.";
+
+// 报告中的吞吐量：(名称, 计数器, span)，两者都有记录时输出 计数 / span 总耗时。
+const THROUGHPUTS: &[(&str, &str, &str)] = &[
+    ("load_triangles_per_second", "scene.triangles", "load_scene"),
+    ("bin_triangles_per_second", "bin.triangles", "bin_triangles"),
+    ("glb_bytes_per_second", "glb.bytes", "write_glb"),
+    ("texture_bytes_per_second", "texture.encoded_bytes", "texture_encode"),
+];
+
+struct Collector {
+    start: Instant,
+    trace: bool,
+    state: Mutex<State>,
+}
+
+#[derive(Default)]
+struct State {
+    spans: BTreeMap<&'static str, SpanTotals>,
+    counters: BTreeMap<&'static str, u64>,
+    events: Vec<TraceEvent>,
+}
+
+#[derive(Default)]
+struct SpanTotals {
+    count: u64,
+    total: Duration,
+    max: Duration,
+}
+
+struct TraceEvent {
+    name: &'static str,
+    thread: u64,
+    start: Duration,
+    duration: Duration,
+}
+
+// trace 为 true 时另外保留每个 span 的起止时间，供写出 Chrome trace。
+pub fn enable(trace: bool) {
+    COLLECTOR.get_or_init(|| Collector {
+        start: Instant::now(),
+        trace,
+        state: Mutex::new(State::default()),
+    });
+    ENABLED.store(true, Ordering::Release);
+}
+
+fn collector() -> Option<&'static Collector> {
+    if ENABLED.load(Ordering::Acquire) {
+        COLLECTOR.get()
+    } else {
+        None
+    }
+}
+
+// 计时区间：析构时记入同名 span 的次数、总耗时与最长一次。
+pub struct Span {
+    name: &'static str,
+    start: Option<Instant>,
+}
+
+pub fn span(name: &'static str) -> Span {
+    Span {
+        name,
+        start: collector().map(|_| Instant::now()),
+    }
+}
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        let (Some(start), Some(collector)) = (self.start, collector()) else {
+            return;
+        };
+        let duration = start.elapsed();
+        let thread = THREAD_ID.with(|id| *id);
+        let mut state = collector.state.lock().unwrap();
+        let totals = state.spans.entry(self.name).or_default();
+        totals.count += 1;
+        totals.total += duration;
+        totals.max = totals.max.max(duration);
+        if collector.trace {
+            state.events.push(TraceEvent {
+                name: self.name,
+                thread,
+                start: start.saturating_duration_since(collector.start),
+                duration,
+            });
+        }
+    }
+}
+
+pub fn add(name: &'static str, value: u64) {
+    if let Some(collector) = collector() {
+        *collector.state.lock().unwrap().counters.entry(name).or_default() += value;
+    }
+}
+
+#[derive(Clone, Copy)]
+pub enum TextureCacheKind {
+    // 注册表内按内容合并的内嵌纹理。
+    Registry,
+    // 降采样变体。
+    Lod,
+    // 批量转换中跨场景共享的原图编码。
+    Shared,
+    // 共享纹理目录中已写出的文件。
+    Files,
+}
+
+pub fn cache_lookup(cache: TextureCacheKind, hit: bool) {
+    let (hits, misses) = match cache {
+        TextureCacheKind::Registry => {
+            ("texture_cache.registry.hits", "texture_cache.registry.misses")
+        }
+        TextureCacheKind::Lod => ("texture_cache.lod.hits", "texture_cache.lod.misses"),
+        TextureCacheKind::Shared => ("texture_cache.shared.hits", "texture_cache.shared.misses"),
+        TextureCacheKind::Files => ("texture_cache.files.hits", "texture_cache.files.misses"),
+    };
+    add(if hit { hits } else { misses }, 1);
+}
+
+// 统计未启用时什么也不写。
+pub fn write_reports(stats_path: Option<&Path>, trace_path: Option<&Path>) -> Result<()> {
+    let Some(collector) = collector() else {
+        return Ok(());
+    };
+    let wall = collector.start.elapsed();
+    let state = collector.state.lock().unwrap();
+    if let Some(path) = stats_path {
+        let report = build_report(&state, wall);
+        let bytes = serde_json::to_vec_pretty(&report)?;
+        fs::write(path, bytes).with_context(|| format!("write stats {}", path.display()))?;
+    }
+    if let Some(path) = trace_path {
+        let bytes = serde_json::to_vec(&build_trace(&state))?;
+        fs::write(path, bytes).with_context(|| format!("write trace {}", path.display()))?;
+    }
+    Ok(())
+}
+
+fn build_report(state: &State, wall: Duration) -> Value {
+    let spans: Map<String, Value> = state
+        .spans
+        .iter()
+        .map(|(name, totals)| {
+            let value = json!({
+                "count": totals.count,
+                "total_seconds": totals.total.as_secs_f64(),
+                "max_seconds": totals.max.as_secs_f64(),
+            });
+            (name.to_string(), value)
+        })
+        .collect();
+    let counters: Map<String, Value> = state
+        .counters
+        .iter()
+        .map(|(name, value)| (name.to_string(), json!(value)))
+        .collect();
+
+    let mut caches: BTreeMap<&str, (u64, u64)> = BTreeMap::new();
+    for (name, &value) in &state.counters {
+        let Some(rest) = name.strip_prefix(TEXTURE_CACHE_PREFIX) else {
+            continue;
+        };
+        let (cache, kind) = rest.rsplit_once('.').unwrap_or((rest, ""));
+        let entry = caches.entry(cache).or_default();
+        match kind {
+            "hits" => entry.0 += value,
+            "misses" => entry.1 += value,
+            _ => {}
+        }
+    }
+    let texture_cache: Map<String, Value> = caches
+        .into_iter()
+        .map(|(cache, (hits, misses))| {
+            let lookups = hits + misses;
+            let hit_rate = if lookups > 0 { hits as f64 / lookups as f64 } else { 0.0 };
+            let value = json!({ "hits": hits, "misses": misses, "hit_rate": hit_rate });
+            (cache.to_string(), value)
+        })
+        .collect();
+
+    let mut throughput = Map::new();
+    for &(name, counter, span) in THROUGHPUTS {
+        let (Some(&count), Some(totals)) = (state.counters.get(counter), state.spans.get(span))
+        else {
+            continue;
+        };
+        let seconds = totals.total.as_secs_f64();
+        if seconds > 0.0 {
+            throughput.insert(name.to_string(), json!(count as f64 / seconds));
+        }
+    }
+
+    json!({
+        "wall_seconds": wall.as_secs_f64(),
+        "peak_rss_bytes": peak_rss_bytes(),
+        "spans": spans,
+        "counters": counters,
+        "texture_cache": texture_cache,
+        "throughput": throughput,
+    })
+}
+
+// Chrome trace 事件格式（chrome://tracing、Perfetto 可直接打开），时间单位为微秒。
+fn build_trace(state: &State) -> Value {
+    let events: Vec<Value> = state
+        .events
+        .iter()
+        .map(|event| {
+            json!({
+                "name": event.name,
+                "ph": "X",
+                "pid": 1,
+                "tid": event.thread,
+                "ts": event.start.as_secs_f64() * 1e6,
+                "dur": event.duration.as_secs_f64() * 1e6,
+            })
+        })
+        .collect();
+    json!({ "traceEvents": events, "displayTimeUnit": "ms" })
+}
+
+#[cfg(target_os = "linux")]
+fn peak_rss_bytes() -> Option<u64> {
+    let status = fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|line| line.starts_with("VmHWM:"))?;
+    let kib: u64 = line.split_whitespace().nth(1)?.parse().ok()?;
+    Some(kib * 1024)
+}
+
+#[cfg(windows)]
+fn peak_rss_bytes() -> Option<u64> {
+    use std::ffi::c_void;
+
+    #[repr(C)]
+    #[derive(Default)]
+    struct ProcessMemoryCounters {
+        cb: u32,
+        page_fault_count: u32,
+        peak_working_set_size: usize,
+        working_set_size: usize,
+        quota_peak_paged_pool_usage: usize,
+        quota_paged_pool_usage: usize,
+        quota_peak_non_paged_pool_usage: usize,
+        quota_non_paged_pool_usage: usize,
+        pagefile_usage: usize,
+        peak_pagefile_usage: usize,
+    }
+
+    unsafe extern "system" {
+        fn GetCurrentProcess() -> *mut c_void;
+        fn K32GetProcessMemoryInfo(
+            process: *mut c_void,
+            counters: *mut ProcessMemoryCounters,
+            cb: u32,
+        ) -> i32;
+    }
+
+    let cb = size_of::<ProcessMemoryCounters>() as u32;
+    let mut counters = ProcessMemoryCounters {
+        cb,
+        ..Default::default()
+    };
+    let ok = unsafe { K32GetProcessMemoryInfo(GetCurrentProcess(), &mut counters, cb) };
+    (ok != 0).then_some(counters.peak_working_set_size as u64)
+}
+
+#[cfg(not(any(target_os = "linux", windows)))]
+fn peak_rss_bytes() -> Option<u64> {
+    None
+}
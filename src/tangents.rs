@@ -0,0 +1,119 @@
+use crate::ufbx_loader::{Material, MeshPart};
+
+// 只有带法线贴图、且有 UV 与法线的 part 才需要切线；每个源 part 加载时算一次，
+// 之后随裁剪、简化与合并像其他顶点属性一样传递，写出端不再重新计算。
+pub fn generate_tangents(parts: &mut [MeshPart], materials: &[Material]) {
+    for part in parts {
+        let vertex_count = part.vertex_count();
+        let normal_mapped = materials
+            .get(part.material_index)
+            .is_some_and(|material| material.normal_texture.is_some());
+        if normal_mapped
+            && vertex_count > 0
+            && part.uvs.len() == vertex_count * 2
+            && part.normals.len() == vertex_count * 3
+        {
+            part.tangents = compute_tangents(part).into();
+        }
+    }
+}
+
+// 每个三角形按 UV 梯度求切线/副切线并累加到顶点，再对法线做 Gram-Schmidt 正交化，
+// w 为副切线的手性（±1）。
+fn compute_tangents(part: &MeshPart) -> Vec<f32> {
+    let vertex_count = part.vertex_count();
+    let positions = &part.positions;
+    let uvs = &part.uvs;
+    let mut tangent_sum = vec![[0.0f32; 3]; vertex_count];
+    let mut bitangent_sum = vec![[0.0f32; 3]; vertex_count];
+
+    for tri in 0..part.triangle_count() {
+        let [i0, i1, i2] = part.triangle(tri);
+        if i0.max(i1).max(i2) >= vertex_count {
+            continue;
+        }
+        let p0 = vec3_at(positions, i0);
+        let p1 = vec3_at(positions, i1);
+        let p2 = vec3_at(positions, i2);
+
+        let uv0 = [uvs[i0 * 2], uvs[i0 * 2 + 1]];
+        let uv1 = [uvs[i1 * 2], uvs[i1 * 2 + 1]];
+        let uv2 = [uvs[i2 * 2], uvs[i2 * 2 + 1]];
+
+        let edge1 = [p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]];
+        let edge2 = [p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]];
+
+        let delta_uv1 = [uv1[0] - uv0[0], uv1[1] - uv0[1]];
+        let delta_uv2 = [uv2[0] - uv0[0], uv2[1] - uv0[1]];
+
+        let denom = delta_uv1[0] * delta_uv2[1] - delta_uv1[1] * delta_uv2[0];
+        let (tangent, bitangent) = if denom.abs() > f32::EPSILON {
+            let r = 1.0 / denom;
+            let tangent = [
+                (edge1[0] * delta_uv2[1] - edge2[0] * delta_uv1[1]) * r,
+                (edge1[1] * delta_uv2[1] - edge2[1] * delta_uv1[1]) * r,
+                (edge1[2] * delta_uv2[1] - edge2[2] * delta_uv1[1]) * r,
+            ];
+            let bitangent = [
+                (edge2[0] * delta_uv1[0] - edge1[0] * delta_uv2[0]) * r,
+                (edge2[1] * delta_uv1[0] - edge1[1] * delta_uv2[0]) * r,
+                (edge2[2] * delta_uv1[0] - edge1[2] * delta_uv2[0]) * r,
+            ];
+            (tangent, bitangent)
+        } else {
+            ([1.0, 0.0, 0.0], [0.0, 1.0, 0.0])
+        };
+
+        for idx in [i0, i1, i2] {
+            for axis in 0..3 {
+                tangent_sum[idx][axis] += tangent[axis];
+                bitangent_sum[idx][axis] += bitangent[axis];
+            }
+        }
+    }
+
+    let mut tangents = vec![0.0f32; vertex_count * 4];
+    for idx in 0..vertex_count {
+        let normal = vec3_at(&part.normals, idx);
+        let t = orthonormalize(normal, tangent_sum[idx]);
+        let w = handedness(normal, t, bitangent_sum[idx]);
+        tangents[idx * 4..idx * 4 + 4].copy_from_slice(&[t[0], t[1], t[2], w]);
+    }
+    tangents
+}
+
+fn vec3_at(data: &[f32], idx: usize) -> [f32; 3] {
+    [data[idx * 3], data[idx * 3 + 1], data[idx * 3 + 2]]
+}
+
+fn orthonormalize(normal: [f32; 3], tangent: [f32; 3]) -> [f32; 3] {
+    let dot = normal[0] * tangent[0] + normal[1] * tangent[1] + normal[2] * tangent[2];
+    let mut t = [
+        tangent[0] - normal[0] * dot,
+        tangent[1] - normal[1] * dot,
+        tangent[2] - normal[2] * dot,
+    ];
+    let len = (t[0] * t[0] + t[1] * t[1] + t[2] * t[2]).sqrt();
+    if len > f32::EPSILON {
+        t[0] /= len;
+        t[1] /= len;
+        t[2] /= len;
+    } else {
+        t = [1.0, 0.0, 0.0];
+    }
+    t
+}
+
+fn handedness(normal: [f32; 3], tangent: [f32; 3], bitangent: [f32; 3]) -> f32 {
+    let cross = [
+        normal[1] * tangent[2] - normal[2] * tangent[1],
+        normal[2] * tangent[0] - normal[0] * tangent[2],
+        normal[0] * tangent[1] - normal[1] * tangent[0],
+    ];
+    let dot = cross[0] * bitangent[0] + cross[1] * bitangent[1] + cross[2] * bitangent[2];
+    if dot < 0.0 {
+        -1.0
+    } else {
+        1.0
+    }
+}
@@ -1,11 +1,30 @@
-use crate::geo::GeoContext;
-use crate::gltf_writer::{write_glb_with_textures, TextureCache, TextureMode};
-use crate::ufbx_loader::{AxisDir, Material, MeshPart, SceneData};
+use crate::archive::TileArchive;
+use crate::atlas::{
+    bake_coarse_atlases, bake_tile_atlas, embedded_texture, merge_coarse_atlases, CoarseAtlas,
+};
+use crate::geo::{GeoContext, LocalToEnu};
+use crate::gltf_writer::{
+    write_glb_with_textures, GlbOptions, GlbTarget, TextureCache, TextureMode, TextureStore,
+};
+use crate::image_utils::TextureRegistry;
+use crate::implicit::{encode_subtrees, interleave, ImplicitTile};
+use crate::manifest::{remove_manifest, write_if_changed, TileManifest};
+use crate::parallel::{parallel_map, resolve_jobs};
+use crate::reorder::optimize_mesh_part;
+use crate::simplify::simplify_mesh;
+use crate::stats;
+use crate::ufbx_loader::{
+    flip_part_v, InstancedMesh, LoadOptions, Material, MeshPart, SceneData, SceneStream,
+};
 use anyhow::{bail, Context, Result};
 use serde_json::json;
-use std::collections::HashMap;
+use std::collections::hash_map::DefaultHasher;
+use std::collections::{HashMap, HashSet};
 use std::fs;
-use std::path::Path;
+use std::hash::{Hash, Hasher};
+use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
 
 pub struct TilesetOptions {
     pub origin_lat: f64,
@@ -17,9 +36,76 @@ pub struct TilesetOptions {
     pub min_tile_size: f64,
     pub max_level: Option<u32>,
     pub embed_textures: bool,
+    // tile 编码/写出的并行线程数，0 表示使用全部可用核心。
+    pub jobs: usize,
+    // 流式模式下内存中暂存的分箱数据上限，超出后整体落盘。
+    pub memory_limit_mb: usize,
+    pub glb: GlbOptions,
+    // 每个 tile 内把可合并材质的纹理烘焙成图集并合并为一个图元。
+    pub atlas: bool,
+    // 增量导出：按输出目录中的清单跳过输入未变化的 tile，并删除已不存在的 tile。
+    pub incremental: bool,
+    // 外部纹理目录，默认 output_dir/textures；批量转换时多个 tileset 可共用同一目录。
+    pub texture_dir: Option<PathBuf>,
+    // 自适应细分：cell 超出预算时继续细分（必要时沿 Y），None 为均匀叶子网格。
+    pub tile_budget: Option<TileBudget>,
+    // 隐式分块（3D Tiles 1.1 implicit tiling）：子节点列表改为 .subtree 可用性文件与 URI 模板。
+    pub implicit: bool,
+    // 3TZ 归档输出：output_dir 为 .3tz 文件路径，tileset.json、tile、纹理与子树文件都写入其中。
+    pub archive: bool,
+    // 粗层级：顶部 coarse_levels 层的 tile 把可合并材质烘焙成图集（每组一张，边长不超过
+    // coarse_texture_size），父节点的图集由子节点图集缩放拼接而成；0 表示不启用。
+    pub coarse_levels: u32,
+    pub coarse_texture_size: u32,
+    // 加载选项（节点筛选与实例化）；由调用方传给加载函数，这里记入增量导出的选项指纹。
+    pub load: LoadOptions,
 }
 
-#[derive(Clone)]
+// 单个 tile 的几何预算，0 表示该项不限制；字节数按未压缩的顶点与索引数据估算。
+#[derive(Clone, Copy, Debug)]
+pub struct TileBudget {
+    pub max_triangles: usize,
+    pub max_bytes: usize,
+}
+
+impl TileBudget {
+    pub fn from_limits(max_triangles: Option<usize>, max_bytes: Option<usize>) -> Option<Self> {
+        let budget = Self {
+            max_triangles: max_triangles.unwrap_or(0),
+            max_bytes: max_bytes.unwrap_or(0),
+        };
+        (budget.max_triangles > 0 || budget.max_bytes > 0).then_some(budget)
+    }
+
+    // 实例的三角形按每个实例各算一份；字节数中原型每种只算一次，另加每实例的 TRS（10 个 f32）。
+    fn fits(&self, parts: &[MeshPart], instances: &[TileInstance], scene: &SceneData) -> bool {
+        let mut triangles: usize = parts.iter().map(MeshPart::triangle_count).sum();
+        let mut bytes = estimate_geometry_bytes(parts) + instances.len() * 40;
+        let mut meshes: Vec<usize> = instances.iter().map(|instance| instance.mesh).collect();
+        meshes.sort_unstable();
+        for group in meshes.chunk_by(|a, b| a == b) {
+            let prototype = &scene.instanced[group[0]].parts;
+            let mesh_triangles: usize = prototype.iter().map(MeshPart::triangle_count).sum();
+            triangles += mesh_triangles * group.len();
+            bytes += estimate_geometry_bytes(prototype);
+        }
+        (self.max_triangles == 0 || triangles <= self.max_triangles)
+            && (self.max_bytes == 0 || bytes <= self.max_bytes)
+    }
+}
+
+// 顶点属性位：分箱与落盘记录共用。法线/UV/切线只有所有贡献源 part 都带有时才输出；
+// 颜色只要有一个源 part 带有就输出，缺色的 part 按白色补齐。
+const ATTR_NORMALS: u32 = 1;
+const ATTR_UVS: u32 = 2;
+const ATTR_COLORS: u32 = 4;
+const ATTR_TANGENTS: u32 = 8;
+
+fn combine_attributes(current: u32, attributes: u32) -> u32 {
+    (current & attributes) | ((current | attributes) & ATTR_COLORS)
+}
+
+// tile 内按输出属性焊接顶点；只在分箱完成后、逐 tile 写出时使用，不在裁剪热路径上。
 struct PartBuilder {
     name: Option<String>,
     material_index: usize,
@@ -27,416 +113,2264 @@ struct PartBuilder {
     normals: Vec<f32>,
     uvs: Vec<f32>,
     colors: Vec<f32>,
+    tangents: Vec<f32>,
+    indices: Vec<u32>,
+    vertex_map: HashMap<[u32; 16], u32>,
+}
+
+impl PartBuilder {
+    fn with_capacity(name: Option<String>, material_index: usize, corner_count: usize) -> Self {
+        Self {
+            name,
+            material_index,
+            positions: Vec::with_capacity(corner_count * 3),
+            normals: Vec::new(),
+            uvs: Vec::new(),
+            colors: Vec::new(),
+            tangents: Vec::new(),
+            indices: Vec::with_capacity(corner_count),
+            vertex_map: HashMap::with_capacity(corner_count),
+        }
+    }
+
+    fn push_corner(&mut self, bins: &TileBins, corner: usize, run: &BinRun) {
+        self.push_vertex(
+            &bins.positions[corner * 3..corner * 3 + 3],
+            &bins.normals[corner * 3..corner * 3 + 3],
+            &bins.uvs[corner * 2..corner * 2 + 2],
+            &bins.colors[corner * 4..corner * 4 + 4],
+            bins.tangents.get(corner * 4..corner * 4 + 4).unwrap_or(&[0.0; 4]),
+            run.attributes,
+        );
+    }
+
+    // 按输出属性（本地坐标 f32、法线、UV、颜色、切线）焊接顶点，并写入 tile 内索引。
+    fn push_vertex(
+        &mut self,
+        position: &[f32],
+        normal: &[f32],
+        uv: &[f32],
+        color: &[f32],
+        tangent: &[f32],
+        attributes: u32,
+    ) {
+        let mut key = [0u32; 16];
+        for i in 0..3 {
+            key[i] = position[i].to_bits();
+            key[3 + i] = normal[i].to_bits();
+        }
+        key[6] = uv[0].to_bits();
+        key[7] = uv[1].to_bits();
+        for i in 0..4 {
+            key[8 + i] = color[i].to_bits();
+            key[12 + i] = tangent[i].to_bits();
+        }
+
+        let next_index = (self.positions.len() / 3) as u32;
+        let index = *self.vertex_map.entry(key).or_insert(next_index);
+        if index == next_index {
+            self.positions.extend_from_slice(position);
+            if attributes & ATTR_NORMALS != 0 {
+                self.normals.extend_from_slice(normal);
+            }
+            if attributes & ATTR_UVS != 0 {
+                self.uvs.extend_from_slice(uv);
+            }
+            if attributes & ATTR_COLORS != 0 {
+                self.colors.extend_from_slice(color);
+            }
+            if attributes & ATTR_TANGENTS != 0 {
+                self.tangents.extend_from_slice(tangent);
+            }
+        }
+        self.indices.push(index);
+    }
+
+    fn into_mesh_part(self) -> MeshPart {
+        MeshPart {
+            name: self.name,
+            material_index: self.material_index,
+            positions: self.positions.into(),
+            normals: self.normals.into(),
+            uvs: self.uvs.into(),
+            colors: self.colors.into(),
+            tangents: self.tangents.into(),
+            indices: self.indices.into(),
+        }
+    }
+}
+
+const NO_RUN: u32 = u32::MAX;
+
+// 叶子网格的稠密索引：(x, z) -> cell，用数组代替逐三角形的 HashMap 查找。
+struct LeafGrid {
+    min_x: i32,
+    min_z: i32,
+    nx: usize,
+    nz: usize,
+}
+
+impl LeafGrid {
+    fn cell(&self, x: i32, z: i32) -> usize {
+        (z - self.min_z) as usize * self.nx + (x - self.min_x) as usize
+    }
+
+    fn coords(&self, cell: usize) -> (i32, i32) {
+        (
+            self.min_x + (cell % self.nx) as i32,
+            self.min_z + (cell / self.nx) as i32,
+        )
+    }
+
+    fn cell_count(&self) -> usize {
+        self.nx * self.nz
+    }
+}
+
+// 一个 (tile, 材质) 分箱：三角形在 TileBins 连续数组中的区间 [offset, offset + count)。
+struct BinRun {
+    cell: usize,
+    material_index: usize,
+    // 首个落入该分箱的源 part，用于输出命名。
+    part_index: usize,
+    // 输出的属性位，见 combine_attributes。
+    attributes: u32,
+    min_local: [f64; 3],
+    max_local: [f64; 3],
+    offset: usize,
+    count: usize,
+}
+
+struct TileBin {
+    x: i32,
+    z: i32,
+    first_run: usize,
+    run_count: usize,
+    min_local: [f64; 3],
+    max_local: [f64; 3],
+    instances: Vec<TileInstance>,
+}
+
+// 实例化网格的一个实例（SceneData::instanced[mesh].instances[index]），整体归入其包围盒中心所在的 cell，
+// 不裁剪；size 为实例包围盒的对角线长度（米），父节点据此决定保留还是舍弃。
+#[derive(Clone, Copy)]
+struct TileInstance {
+    mesh: usize,
+    index: usize,
+    min_local: [f64; 3],
+    max_local: [f64; 3],
+    size: f64,
+}
+
+impl TileInstance {
+    fn center_enu(&self, geo: &GeoContext) -> [f64; 3] {
+        geo.transform_local([0, 1, 2].map(|axis| 0.5 * (self.min_local[axis] + self.max_local[axis])))
+    }
+}
+
+// 两遍分箱的结果：所有 tile 的裁剪后三角形按 (cell, 材质) 连续存放，每个角点一组属性。
+// 没有任何分箱输出切线时 tangents 为空。
+struct TileBins {
+    positions: Vec<f32>,
+    normals: Vec<f32>,
+    uvs: Vec<f32>,
+    colors: Vec<f32>,
+    tangents: Vec<f32>,
+    runs: Vec<BinRun>,
+    tiles: Vec<TileBin>,
+}
+
+impl TileBins {
+    fn tile_runs(&self, tile: &TileBin) -> &[BinRun] {
+        &self.runs[tile.first_run..tile.first_run + tile.run_count]
+    }
+}
+
+// 空间细分的 cell：四叉树序号 (level, x, z)，自适应细分时还可沿 Y 再分。
+#[derive(Clone, Copy)]
+struct TileCell {
+    level: u32,
+    x: i32,
+    z: i32,
+    // 纵向序号与 ENU 高度范围；None 表示覆盖整个高度。
+    y: Option<(i32, f64, f64)>,
+}
+
+impl TileCell {
+    fn quad(level: u32, x: i32, z: i32) -> Self {
+        Self { level, x, z, y: None }
+    }
+
+    fn size(&self, tile_size: f64) -> f64 {
+        tile_size / 2_f64.powi(self.level as i32)
+    }
+
+    fn y_index(&self) -> Option<i32> {
+        self.y.map(|(y, _, _)| y)
+    }
+}
+
+#[derive(Clone)]
+struct TileNode {
+    level: u32,
+    x: i32,
+    z: i32,
+    y: Option<i32>,
+    min_local: [f64; 3],
+    max_local: [f64; 3],
+    has_content: bool,
+    geometric_error: f64,
+    children: Vec<TileNode>,
+}
+
+impl TileNode {
+    // 同层节点按 Morton 序排列（沿 Y 细分的同一 cell 再按高度），tileset.json 与写出顺序保持空间局部性。
+    fn order_key(&self) -> (u64, Option<i32>) {
+        (morton_key(self.x, self.z), self.y)
+    }
+}
+
+// (x, z) 的 Z-order 键：序号平移到无符号范围后按位交错，x 占低位。
+fn morton_key(x: i32, z: i32) -> u64 {
+    interleave(x as u32 ^ 0x8000_0000, z as u32 ^ 0x8000_0000)
+}
+
+// 裁剪顶点只带模型坐标；ENU 分量由 LocalToEnu 按需求出，热循环中每个顶点少带一份 f64 位置。
+#[derive(Clone, Copy)]
+struct Vertex {
+    pos_local: [f64; 3],
+    normal: [f32; 3],
+    uv: [f32; 2],
+    color: [f32; 4],
+    tangent: [f32; 4],
+}
+
+// ufbx 已统一输出为 Y-up，这里无需额外轴变换。
+
+pub fn export_tileset(
+    scene: &SceneData,
+    registry: &TextureRegistry,
+    output_dir: &Path,
+    options: &TilesetOptions,
+) -> Result<()> {
+    if scene.parts.is_empty() && scene.instanced.is_empty() {
+        bail!("no mesh data found in FBX");
+    }
+    validate_options(options)?;
+
+    let geo = GeoContext::new(
+        options.origin_lat,
+        options.origin_lon,
+        options.origin_height,
+        options.heading,
+        options.scale,
+    );
+
+    let max_level = options
+        .max_level
+        .unwrap_or_else(|| compute_max_level(options.tile_size, options.min_tile_size));
+    let leaf_size = options.tile_size / 2_f64.powi(max_level as i32);
+    // 自适应细分从根 cell 开始逐个向下裁剪，均匀模式直接分箱到叶子网格。
+    let bin_size = if options.tile_budget.is_some() {
+        options.tile_size
+    } else {
+        leaf_size
+    };
+
+    let mut bins = bin_triangles(scene, &geo, bin_size)?;
+    assign_instances(&mut bins, scene_instances(scene, options.scale), &geo, bin_size);
+    if bins.tiles.is_empty() {
+        bail!("no triangles were assigned to tiles");
+    }
+
+    let mut global_min_local = [f64::INFINITY; 3];
+    let mut global_max_local = [f64::NEG_INFINITY; 3];
+    for tile in &bins.tiles {
+        for axis in 0..3 {
+            global_min_local[axis] = global_min_local[axis].min(tile.min_local[axis]);
+            global_max_local[axis] = global_max_local[axis].max(tile.max_local[axis]);
+        }
+    }
+
+    let index_bounds = tile_index_bounds(bins.tiles.iter().map(|tile| (tile.x, tile.z)));
+    let (tiles_dir, texture_cache, archive) = prepare_output_dirs(output_dir, options)?;
+    let manifest = load_manifest(output_dir, options, registry)?;
+
+    let context = LodContext {
+        scene,
+        registry,
+        geo: &geo,
+        tiles_dir: &tiles_dir,
+        texture_cache: texture_cache.as_ref(),
+        archive: archive.as_deref(),
+        tile_size: options.tile_size,
+        leaf_size,
+        scale: options.scale,
+        glb: options.glb,
+        atlas: options.atlas,
+        implicit: options.implicit,
+        coarse_levels: options.coarse_levels,
+        coarse_texture_size: options.coarse_texture_size,
+        manifest: manifest.as_ref(),
+        global_min_y: global_min_local[UP_AXIS],
+        global_max_y: global_max_local[UP_AXIS],
+    };
+
+    let mut tiles: Vec<&TileBin> = bins.tiles.iter().collect();
+    tiles.sort_by_key(|tile| morton_key(tile.x, tile.z));
+    let roots = if let Some(budget) = options.tile_budget {
+        // 各根 cell 子树独立细分，线程按根 cell 数平分，子树内部再按子 cell 平分。
+        let adaptive = AdaptiveContext {
+            lod: &context,
+            budget,
+            max_level,
+        };
+        let subtree_jobs = (resolve_jobs(options.jobs, usize::MAX) / tiles.len()).max(1);
+        let roots = parallel_map(options.jobs, tiles, |tile| {
+            let parts = tile_mesh_parts(&bins, tile, scene);
+            let cell = TileCell::quad(0, tile.x, tile.z);
+            Ok(adaptive.build_node(cell, parts, tile.instances.clone(), subtree_jobs)?.0)
+        })?;
+        drop(bins);
+        roots
+    } else {
+        // 叶子层：写出 GLB，同时保留焊接后的网格作为上一层简化的输入。
+        let leaf_nodes = parallel_map(options.jobs, tiles, |tile| {
+            let parts = tile_mesh_parts(&bins, tile, scene);
+            let cell = TileCell::quad(max_level, tile.x, tile.z);
+            let instances = tile.instances.clone();
+            build_leaf_node(&context, cell, tile.min_local, tile.max_local, parts, instances)
+        })?;
+        drop(bins);
+        build_parent_levels(&context, options.jobs, leaf_nodes, max_level)?
+    };
+    write_tileset_json(output_dir, &context, options, roots, index_bounds, bin_size)?;
+    finish_manifest(manifest, &tiles_dir)?;
+    finish_archive(archive)
+}
+
+// 流式（out-of-core）导出：逐节点取出几何并裁剪，分箱数据先在内存中暂存，
+// 超过 memory_limit_mb 后整体追加到输出目录下的临时文件；随后按子树深度优先逐个 tile 收尾，
+// 任一时刻只有少量 tile 的网格驻留内存。
+pub fn export_tileset_streaming(
+    stream: &mut SceneStream,
+    flip_v: bool,
+    registry: &TextureRegistry,
+    output_dir: &Path,
+    options: &TilesetOptions,
+) -> Result<()> {
+    validate_options(options)?;
+    if options.tile_budget.is_some() {
+        bail!("adaptive tile subdivision is not supported in out-of-core mode");
+    }
+
+    let geo = GeoContext::new(
+        options.origin_lat,
+        options.origin_lon,
+        options.origin_height,
+        options.heading,
+        options.scale,
+    );
+
+    let max_level = options
+        .max_level
+        .unwrap_or_else(|| compute_max_level(options.tile_size, options.min_tile_size));
+    let leaf_size = options.tile_size / 2_f64.powi(max_level as i32);
+
+    // 归档模式下 output_dir 是 .3tz 文件，临时目录放在它旁边。
+    let spill_dir = if options.archive {
+        let mut name = output_dir.as_os_str().to_owned();
+        name.push(SPILL_DIR_NAME);
+        PathBuf::from(name)
+    } else {
+        fs::create_dir_all(output_dir)
+            .with_context(|| format!("create output dir {}", output_dir.display()))?;
+        output_dir.join(SPILL_DIR_NAME)
+    };
+    let with_tangents = stream.materials.iter().any(|material| material.normal_texture.is_some());
+    let mut spill = SpillStore::new(
+        spill_dir,
+        options.memory_limit_mb.saturating_mul(1024 * 1024),
+        with_tangents,
+    )?;
+
+    // 每种材质首个源 part 的名字，用于 tile 内网格命名。
+    let mut part_names: Vec<Option<String>> = vec![None; stream.materials.len()];
+    let mut part_count = 0usize;
+    let bin_span = stats::span("bin_stream");
+    for node_index in 0..stream.node_count() {
+        for mut part in stream.node_parts(node_index) {
+            part_count += 1;
+            if flip_v {
+                flip_part_v(&mut part);
+            }
+            let material_index = part.material_index;
+            if let Some(name) = part_names.get_mut(material_index) {
+                if name.is_none() {
+                    *name = part.name.clone();
+                }
+            }
+            let attributes = part_attributes(&part);
+            let mut result = Ok(());
+            let mut triangles = 0u64;
+            clip_part_triangles(&part, &geo, leaf_size, |x, z, tri| {
+                if result.is_ok() {
+                    triangles += 1;
+                    result = spill.push(x, z, material_index, attributes, tri);
+                }
+            });
+            result?;
+            stats::add("bin.triangles", triangles);
+        }
+    }
+    drop(bin_span);
+    stats::add("bin.tiles", spill.tiles.len() as u64);
+    if part_count == 0 {
+        bail!("no mesh data found in FBX");
+    }
+    if spill.tiles.is_empty() {
+        bail!("no triangles were assigned to tiles");
+    }
+
+    let mut global_min_y = f64::INFINITY;
+    let mut global_max_y = f64::NEG_INFINITY;
+    for tile in spill.tiles.values() {
+        global_min_y = global_min_y.min(tile.min_local[UP_AXIS]);
+        global_max_y = global_max_y.max(tile.max_local[UP_AXIS]);
+    }
+
+    // 每层被占用的 cell，用于深度优先遍历时跳过空子树。
+    let mut occupied: Vec<HashSet<(i32, i32)>> = vec![HashSet::new(); max_level as usize + 1];
+    for &(x, z) in spill.tiles.keys() {
+        for level in 0..=max_level {
+            let shift = max_level - level;
+            occupied[level as usize].insert((x >> shift, z >> shift));
+        }
+    }
+
+    let index_bounds = tile_index_bounds(spill.tiles.keys().copied());
+    let (tiles_dir, texture_cache, archive) = prepare_output_dirs(output_dir, options)?;
+    let manifest = load_manifest(output_dir, options, registry)?;
+    let scene = SceneData {
+        materials: stream.materials.clone(),
+        parts: Vec::new(),
+        instanced: Vec::new(),
+        right_axis: stream.right_axis,
+        up_axis: stream.up_axis,
+    };
+
+    let context = LodContext {
+        scene: &scene,
+        registry,
+        geo: &geo,
+        tiles_dir: &tiles_dir,
+        texture_cache: texture_cache.as_ref(),
+        archive: archive.as_deref(),
+        tile_size: options.tile_size,
+        leaf_size,
+        scale: options.scale,
+        glb: options.glb,
+        atlas: options.atlas,
+        implicit: options.implicit,
+        coarse_levels: options.coarse_levels,
+        coarse_texture_size: options.coarse_texture_size,
+        manifest: manifest.as_ref(),
+        global_min_y,
+        global_max_y,
+    };
+    let streaming = StreamContext {
+        lod: &context,
+        spill: &spill,
+        occupied: &occupied,
+        part_names: &part_names,
+        max_level,
+    };
+
+    // 选最浅的、节点数足以喂饱所有线程的一层作为并行粒度，其下各子树独立深度优先构建。
+    let jobs = resolve_jobs(options.jobs, usize::MAX);
+    let split_level = (0..=max_level)
+        .find(|&level| occupied[level as usize].len() >= jobs)
+        .unwrap_or(max_level);
+    let mut split_cells: Vec<(i32, i32)> = occupied[split_level as usize].iter().copied().collect();
+    split_cells.sort_by_key(|&(x, z)| morton_key(x, z));
+    let split_nodes = parallel_map(options.jobs, split_cells, |(x, z)| {
+        streaming.build_subtree(split_level, x, z)
+    })?;
+
+    let roots = build_parent_levels(&context, options.jobs, split_nodes, split_level)?;
+    write_tileset_json(output_dir, &context, options, roots, index_bounds, leaf_size)?;
+    drop(spill);
+    finish_manifest(manifest, &tiles_dir)?;
+    finish_archive(archive)
+}
+
+// ufbx 已统一输出为 Y-up，本地坐标按 Y 为上轴。
+const UP_AXIS: usize = 1;
+
+// 粗层级图集的最小边长：子节点图集拼接时每格仍要留出复制边缘的像素。
+const MIN_COARSE_TEXTURE_SIZE: u32 = 64;
+
+fn validate_options(options: &TilesetOptions) -> Result<()> {
+    if options.tile_size <= 0.0 {
+        bail!("tile_size must be positive");
+    }
+    if options.min_tile_size <= 0.0 {
+        bail!("min_tile_size must be positive");
+    }
+    // 沿 Y 细分的 cell 无法用隐式四叉树表示。
+    if options.implicit && options.tile_budget.is_some() {
+        bail!("implicit tiling is not supported with adaptive tile subdivision");
+    }
+    // 增量导出按文件逐个比对与删除，共享纹理目录在归档之外，两者都无法写入归档。
+    if options.archive && options.incremental {
+        bail!("archive output is not supported with incremental export");
+    }
+    if options.archive && options.texture_dir.is_some() {
+        bail!("archive output is not supported with a shared texture dir");
+    }
+    if options.coarse_levels > 0 && options.coarse_texture_size < MIN_COARSE_TEXTURE_SIZE {
+        bail!("coarse_texture_size must be at least {MIN_COARSE_TEXTURE_SIZE}");
+    }
+    Ok(())
+}
+
+// 归档模式下不创建目录，tiles_dir 为归档内的相对路径。
+fn prepare_output_dirs(
+    output_dir: &Path,
+    options: &TilesetOptions,
+) -> Result<(PathBuf, Option<TextureCache>, Option<Arc<TileArchive>>)> {
+    if options.archive {
+        let archive = Arc::new(TileArchive::create(output_dir)?);
+        let texture_cache = (!options.embed_textures).then(|| {
+            let store = TextureStore::Archive(archive.clone(), "textures".to_string());
+            TextureCache::with_store(store, "../textures")
+        });
+        return Ok((PathBuf::from("tiles"), texture_cache, Some(archive)));
+    }
+
+    let tiles_dir = output_dir.join("tiles");
+    fs::create_dir_all(&tiles_dir)
+        .with_context(|| format!("create tiles dir {}", tiles_dir.display()))?;
+
+    let texture_cache = if options.embed_textures {
+        None
+    } else {
+        match &options.texture_dir {
+            Some(textures_dir) => {
+                fs::create_dir_all(textures_dir)
+                    .with_context(|| format!("create textures dir {}", textures_dir.display()))?;
+                let uri_prefix = relative_uri(&tiles_dir, textures_dir)?;
+                Some(TextureCache::new(textures_dir.clone(), uri_prefix))
+            }
+            None => {
+                let textures_dir = output_dir.join("textures");
+                fs::create_dir_all(&textures_dir)
+                    .with_context(|| format!("create textures dir {}", textures_dir.display()))?;
+                Some(TextureCache::new(textures_dir, "../textures"))
+            }
+        }
+    };
+    Ok((tiles_dir, texture_cache, None))
+}
+
+// from 目录到 to 目录的相对 URI（以 / 分隔），两者都按绝对路径比较。
+fn relative_uri(from: &Path, to: &Path) -> Result<String> {
+    let from = fs::canonicalize(from).with_context(|| format!("resolve {}", from.display()))?;
+    let to = fs::canonicalize(to).with_context(|| format!("resolve {}", to.display()))?;
+    let from: Vec<_> = from.components().collect();
+    let to: Vec<_> = to.components().collect();
+    let common = from.iter().zip(&to).take_while(|(a, b)| a == b).count();
+    let mut segments: Vec<String> = vec!["..".to_string(); from.len() - common];
+    segments.extend(
+        to[common..]
+            .iter()
+            .map(|component| component.as_os_str().to_string_lossy().into_owned()),
+    );
+    Ok(segments.join("/"))
+}
+
+fn load_manifest(
+    output_dir: &Path,
+    options: &TilesetOptions,
+    registry: &TextureRegistry,
+) -> Result<Option<TileManifest>> {
+    if !options.incremental {
+        remove_manifest(output_dir)?;
+        return Ok(None);
+    }
+    TileManifest::load(output_dir, options_fingerprint(options, registry)).map(Some)
+}
+
+fn finish_manifest(manifest: Option<TileManifest>, tiles_dir: &Path) -> Result<()> {
+    match manifest {
+        Some(manifest) => manifest.finish(tiles_dir),
+        None => Ok(()),
+    }
+}
+
+fn finish_archive(archive: Option<Arc<TileArchive>>) -> Result<()> {
+    match archive {
+        Some(archive) => archive.finish(),
+        None => Ok(()),
+    }
+}
+
+// 归档内以 / 分隔的条目路径。
+fn archive_entry_name(path: &Path) -> String {
+    let components: Vec<_> =
+        path.components().map(|part| part.as_os_str().to_string_lossy()).collect();
+    components.join("/")
+}
+
+// 影响 tile 内容的全部导出选项（线程数、内存上限等不影响输出的除外），连同程序版本一起哈希。
+fn options_fingerprint(options: &TilesetOptions, registry: &TextureRegistry) -> u64 {
+    let fingerprint = format!(
+        "{} {:?} {:?} {:?} {:?} {:?} {:?} {:?} {:?} {} {:?} {:?} {} {:?} {:?} {} {} {} {:?}",
+        env!("CARGO_PKG_VERSION"),
+        options.origin_lat,
+        options.origin_lon,
+        options.origin_height,
+        options.heading,
+        options.scale,
+        options.tile_size,
+        options.min_tile_size,
+        options.max_level,
+        options.embed_textures,
+        options.texture_dir,
+        options.glb,
+        options.atlas,
+        registry.options(),
+        options.tile_budget,
+        options.implicit,
+        options.coarse_levels,
+        options.coarse_texture_size,
+        options.load,
+    );
+    let mut hasher = DefaultHasher::new();
+    fingerprint.hash(&mut hasher);
+    hasher.finish()
+}
+
+// tile 的输入内容哈希：各 part 的网格数据、所用材质（纹理取编码结果的内容哈希）与纹理降采样级别，
+// 有实例时再加上各实例的原型网格与变换。
+fn tile_content_hash(
+    context: &LodContext,
+    parts: &[MeshPart],
+    texture_lods: &[u32],
+    instances: &[TileInstance],
+    coarse: &[CoarseAtlas],
+    cell_size: f64,
+) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    for (part, lod) in parts.iter().zip(texture_lods) {
+        hash_part(context, part, *lod, &mut hasher);
+    }
+    for atlas in coarse {
+        let part = &atlas.part;
+        for value in part.positions.iter().chain(part.uvs.iter()).chain(part.colors.iter()) {
+            value.to_bits().hash(&mut hasher);
+        }
+        part.indices[..].hash(&mut hasher);
+        format!("{:?}", atlas.material).hash(&mut hasher);
+        atlas.image.as_raw()[..].hash(&mut hasher);
+    }
+    let mut hashed_meshes = HashSet::new();
+    for instance in instances {
+        let mesh = &context.scene.instanced[instance.mesh];
+        if hashed_meshes.insert(instance.mesh) {
+            for part in &mesh.parts {
+                let material = &context.scene.materials[part.material_index];
+                hash_part(context, part, texture_lod(context, material, part, cell_size), &mut hasher);
+            }
+        }
+        let transform = &mesh.instances[instance.index];
+        instance.mesh.hash(&mut hasher);
+        for value in transform.translation.iter().chain(&transform.rotation).chain(&transform.scale) {
+            value.to_bits().hash(&mut hasher);
+        }
+    }
+    hasher.finish()
+}
+
+fn hash_part(context: &LodContext, part: &MeshPart, lod: u32, hasher: &mut DefaultHasher) {
+    part.name.hash(hasher);
+    lod.hash(hasher);
+    let material = &context.scene.materials[part.material_index];
+    material.name.hash(hasher);
+    for value in material
+        .base_color
+        .iter()
+        .chain(&material.emissive)
+        .chain([&material.metallic, &material.roughness])
+    {
+        value.to_bits().hash(hasher);
+    }
+    material.double_sided.hash(hasher);
+    for texture in [
+        &material.base_color_texture,
+        &material.normal_texture,
+        &material.emissive_texture,
+    ] {
+        texture
+            .as_ref()
+            .map(|texture| context.registry.content_hash(texture))
+            .hash(hasher);
+    }
+    for buffer in [&part.positions, &part.normals, &part.uvs, &part.colors, &part.tangents] {
+        buffer.len().hash(hasher);
+        for value in buffer.iter() {
+            hasher.write_u32(value.to_bits());
+        }
+    }
+    part.indices[..].hash(hasher);
+}
+
+// 自底向上逐层构建四叉树：父节点合并四个子节点的网格并按 QEM 简化。
+fn build_parent_levels(
+    context: &LodContext,
+    jobs: usize,
+    mut level_nodes: Vec<LodNode>,
+    from_level: u32,
+) -> Result<Vec<LodNode>> {
+    for level in (0..from_level).rev() {
+        let mut groups: HashMap<(i32, i32), Vec<LodNode>> = HashMap::new();
+        for child in level_nodes {
+            groups
+                .entry((child.node.x >> 1, child.node.z >> 1))
+                .or_default()
+                .push(child);
+        }
+        let mut groups: Vec<((i32, i32), Vec<LodNode>)> = groups.into_iter().collect();
+        groups.sort_by_key(|((x, z), _)| morton_key(*x, *z));
+        level_nodes = parallel_map(jobs, groups, |((x, z), children)| {
+            build_lod_node(context, level, x, z, children)
+        })?;
+    }
+    Ok(level_nodes)
+}
+
+fn write_tileset_json(
+    output_dir: &Path,
+    context: &LodContext,
+    options: &TilesetOptions,
+    roots: Vec<LodNode>,
+    (min_tile_x, max_tile_x, min_tile_z, max_tile_z): (i32, i32, i32, i32),
+    grid_size: f64,
+) -> Result<()> {
+    let _span = stats::span("write_tileset_json");
+    let heading_rad = options.heading.to_radians();
+    let scale = options.scale;
+    let root_transform = context.geo.transform_matrix();
+    let root_error = options.tile_size * 0.5;
+    let force_refine_error = root_error * 1_000_000.0;
+    let root_box = rotate_box_y_up_to_z_up(grid_extent_box(
+        min_tile_x,
+        max_tile_x,
+        min_tile_z,
+        max_tile_z,
+        grid_size,
+        context.global_min_y,
+        context.global_max_y,
+        heading_rad,
+        scale,
+        0.005,
+    ));
+
+    let mut root_children: Vec<TileNode> = roots.into_iter().map(|lod| lod.node).collect();
+    root_children.sort_by_key(TileNode::order_key);
+    let children: Vec<serde_json::Value> = if context.implicit {
+        write_implicit_roots(output_dir, context, options, &root_children)?
+    } else {
+        root_children
+            .into_iter()
+            .map(|node| tile_node_to_json(node, options.tile_size, heading_rad, scale))
+            .collect()
+    };
+
+    let tileset = json!({
+        "asset": {
+            "version": "1.1",
+            "generator": "ufbx_rust+quadtree"
+        },
+        "geometricError": force_refine_error,
+        "root": {
+            "transform": root_transform,
+            "boundingVolume": { "box": root_box },
+            "geometricError": force_refine_error,
+            "refine": "REPLACE",
+            "children": children
+        }
+    });
+
+    let bytes = serde_json::to_vec_pretty(&tileset)?;
+    if let Some(archive) = context.archive {
+        return archive.add("tileset.json", &bytes);
+    }
+    let tileset_path = output_dir.join("tileset.json");
+    if context.manifest.is_some() {
+        write_if_changed(&tileset_path, &bytes)
+    } else {
+        fs::write(&tileset_path, bytes)
+            .with_context(|| format!("write tileset {}", tileset_path.display()))
+    }
+}
+
+// 每个 .subtree 覆盖的层数。
+const SUBTREE_LEVELS: u32 = 6;
+const SUBTREES_DIR_NAME: &str = "subtrees";
+
+// 隐式分块：每个根 cell 是一棵隐式四叉树，子 tile 的包围盒与几何误差由根逐层二等分得到；
+// 可用性写入 subtrees/ 下的 .subtree 文件，返回挂在 tileset 根下的各隐式根 tile。
+fn write_implicit_roots(
+    output_dir: &Path,
+    context: &LodContext,
+    options: &TilesetOptions,
+    roots: &[TileNode],
+) -> Result<Vec<serde_json::Value>> {
+    let subtrees_dir = output_dir.join(SUBTREES_DIR_NAME);
+    if context.archive.is_none() {
+        fs::create_dir_all(&subtrees_dir)
+            .with_context(|| format!("create subtrees dir {}", subtrees_dir.display()))?;
+    }
+    let heading_rad = options.heading.to_radians();
+    let mut written = HashSet::new();
+    let mut root_tiles = Vec::with_capacity(roots.len());
+    for root in roots {
+        let (rx, rz) = (root.x, root.z);
+        let mut tiles = Vec::new();
+        let mut root_error = 0.0f64;
+        collect_implicit_tiles(root, &mut tiles, &mut root_error);
+        let available_levels = tiles.iter().map(|tile| tile.level).max().unwrap_or(0) + 1;
+        let subtree_levels = SUBTREE_LEVELS.min(available_levels);
+        for ((level, x, y), bytes) in encode_subtrees(&tiles, subtree_levels) {
+            let name = format!("R{rx}_{rz}_L{level}_X{x}_Y{y}.subtree");
+            let path = subtrees_dir.join(&name);
+            if let Some(archive) = context.archive {
+                archive.add(&format!("{SUBTREES_DIR_NAME}/{name}"), &bytes)?;
+            } else if context.manifest.is_some() {
+                write_if_changed(&path, &bytes)?;
+            } else {
+                fs::write(&path, bytes)
+                    .with_context(|| format!("write subtree {}", path.display()))?;
+            }
+            written.insert(name);
+        }
+
+        // 根 cell 包围盒不加水平余量，逐层二等分后与各层 cell 严格对齐；
+        // 隐式四叉树沿包围盒前两个轴细分，因此把水平的 Z 轴换到第二位、竖直轴放到第三位。
+        let b = rotate_box_y_up_to_z_up(grid_extent_box(
+            rx,
+            rx,
+            rz,
+            rz,
+            options.tile_size,
+            context.global_min_y,
+            context.global_max_y,
+            heading_rad,
+            options.scale,
+            0.0,
+        ));
+        let implicit_box = [
+            b[0], b[1], b[2], b[3], b[4], b[5], b[9], b[10], b[11], b[6], b[7], b[8],
+        ];
+        root_tiles.push(json!({
+            "boundingVolume": { "box": implicit_box },
+            "geometricError": root_error,
+            "refine": "REPLACE",
+            "content": { "uri": format!("tiles/R{rx}_{rz}_L{{level}}_X{{x}}_Y{{y}}.glb") },
+            "implicitTiling": {
+                "subdivisionScheme": "QUADTREE",
+                "subtreeLevels": subtree_levels,
+                "availableLevels": available_levels,
+                "subtrees": {
+                    "uri": format!(
+                        "{SUBTREES_DIR_NAME}/R{rx}_{rz}_L{{level}}_X{{x}}_Y{{y}}.subtree"
+                    )
+                }
+            }
+        }));
+    }
+
+    if context.archive.is_some() {
+        return Ok(root_tiles);
+    }
+    // 清理上次导出遗留、本次不再生成的子树文件。
+    for entry in fs::read_dir(&subtrees_dir)? {
+        let entry = entry?;
+        let name = entry.file_name().to_string_lossy().into_owned();
+        if name.ends_with(".subtree") && !written.contains(&name) {
+            fs::remove_file(entry.path())
+                .with_context(|| format!("remove stale subtree {}", entry.path().display()))?;
+        }
+    }
+    Ok(root_tiles)
+}
+
+// 隐式分块中每层误差是上一层的一半，根误差取能覆盖所有节点实际误差的最小值。
+fn collect_implicit_tiles(node: &TileNode, tiles: &mut Vec<ImplicitTile>, root_error: &mut f64) {
+    let (_, _, x, y) = implicit_coords(node.level, node.x, node.z);
+    tiles.push(ImplicitTile {
+        level: node.level,
+        x,
+        y,
+        has_content: node.has_content,
+    });
+    *root_error = root_error.max(node.geometric_error * 2_f64.powi(node.level as i32));
+    for child in &node.children {
+        collect_implicit_tiles(child, tiles, root_error);
+    }
+}
+
+// 基准入口：按 leaf_size 分箱整个场景，返回非空 tile 数。
+pub fn bin_scene(scene: &SceneData, geo: &GeoContext, leaf_size: f64) -> Result<usize> {
+    Ok(bin_triangles(scene, geo, leaf_size)?.tiles.len())
+}
+
+// 基准入口：只重放分箱时的裁剪序列，不写出顶点，返回裁剪后的三角形数。
+pub fn clip_scene(scene: &SceneData, geo: &GeoContext, leaf_size: f64) -> usize {
+    let part_order: Vec<usize> = (0..scene.parts.len()).collect();
+    let mut count = 0;
+    for_each_clipped_triangle(scene, &part_order, geo, leaf_size, |_, _, _, _| count += 1);
+    count
+}
+
+// 两遍分箱：第一遍只计数每个 (tile, 材质) 的三角形数并求出精确偏移，
+// 第二遍重放同样的裁剪序列，把三角形散射到预分配的连续数组中。
+// 源 part 按材质排序遍历，保证同一 cell 内同材质的三角形连续到达，
+// 因而每个 cell 只需记住“当前分箱”即可，热路径上没有哈希查找。
+fn bin_triangles(scene: &SceneData, geo: &GeoContext, leaf_size: f64) -> Result<TileBins> {
+    let _span = stats::span("bin_triangles");
+    let mut part_order: Vec<usize> = (0..scene.parts.len()).collect();
+    part_order.sort_by_key(|&index| scene.parts[index].material_index);
+
+    let Some(grid) = leaf_grid(scene, geo, leaf_size) else {
+        return Ok(TileBins {
+            positions: Vec::new(),
+            normals: Vec::new(),
+            uvs: Vec::new(),
+            colors: Vec::new(),
+            tangents: Vec::new(),
+            runs: Vec::new(),
+            tiles: Vec::new(),
+        });
+    };
+
+    // 第一遍：计数。cell_run 记录每个 cell 最近的分箱。
+    let mut cell_run = vec![NO_RUN; grid.cell_count()];
+    let mut runs: Vec<BinRun> = Vec::new();
+    for_each_clipped_triangle(scene, &part_order, geo, leaf_size, |part_index, x, z, tri| {
+        let part = &scene.parts[part_index];
+        let cell = grid.cell(x, z);
+        let current = cell_run[cell];
+        let run_index = if current != NO_RUN
+            && runs[current as usize].material_index == part.material_index
+        {
+            current as usize
+        } else {
+            runs.push(BinRun {
+                cell,
+                material_index: part.material_index,
+                part_index,
+                attributes: part_attributes(part),
+                min_local: [f64::INFINITY; 3],
+                max_local: [f64::NEG_INFINITY; 3],
+                offset: 0,
+                count: 0,
+            });
+            cell_run[cell] = (runs.len() - 1) as u32;
+            runs.len() - 1
+        };
+        let run = &mut runs[run_index];
+        run.attributes = combine_attributes(run.attributes, part_attributes(part));
+        for vertex in tri {
+            for axis in 0..3 {
+                run.min_local[axis] = run.min_local[axis].min(vertex.pos_local[axis]);
+                run.max_local[axis] = run.max_local[axis].max(vertex.pos_local[axis]);
+            }
+        }
+        run.count += 1;
+    });
+
+    // 按 (cell, 材质) 排序后求前缀和，得到每个分箱的精确偏移。
+    runs.sort_by_key(|run| (run.cell, run.material_index));
+    let mut total = 0usize;
+    for run in &mut runs {
+        run.offset = total;
+        total += run.count;
+    }
+
+    let mut tiles: Vec<TileBin> = Vec::new();
+    for (index, run) in runs.iter().enumerate() {
+        match tiles.last_mut() {
+            Some(tile) if runs[tile.first_run].cell == run.cell => {
+                tile.run_count += 1;
+                for axis in 0..3 {
+                    tile.min_local[axis] = tile.min_local[axis].min(run.min_local[axis]);
+                    tile.max_local[axis] = tile.max_local[axis].max(run.max_local[axis]);
+                }
+            }
+            _ => {
+                let (x, z) = grid.coords(run.cell);
+                cell_run[run.cell] = index as u32;
+                tiles.push(TileBin {
+                    x,
+                    z,
+                    first_run: index,
+                    run_count: 1,
+                    min_local: run.min_local,
+                    max_local: run.max_local,
+                    instances: Vec::new(),
+                });
+            }
+        }
+    }
+
+    // 第二遍：散射。cell_run 此时指向该 cell 的首个分箱，随材质切换向后推进。
+    stats::add("bin.triangles", total as u64);
+    stats::add("bin.tiles", tiles.len() as u64);
+    let corner_count = total * 3;
+    let mut positions = vec![0.0f32; corner_count * 3];
+    let mut normals = vec![0.0f32; corner_count * 3];
+    let mut uvs = vec![0.0f32; corner_count * 2];
+    let mut colors = vec![0.0f32; corner_count * 4];
+    let has_tangents = runs.iter().any(|run| run.attributes & ATTR_TANGENTS != 0);
+    let mut tangents = vec![0.0f32; if has_tangents { corner_count * 4 } else { 0 }];
+    let mut cursors: Vec<usize> = runs.iter().map(|run| run.offset).collect();
+    for_each_clipped_triangle(scene, &part_order, geo, leaf_size, |part_index, x, z, tri| {
+        let material_index = scene.parts[part_index].material_index;
+        let cell = grid.cell(x, z);
+        let mut run_index = cell_run[cell] as usize;
+        while runs[run_index].material_index != material_index {
+            run_index += 1;
+        }
+        cell_run[cell] = run_index as u32;
+
+        let tri_index = cursors[run_index];
+        cursors[run_index] += 1;
+        for (i, vertex) in tri.into_iter().enumerate() {
+            let corner = tri_index * 3 + i;
+            for axis in 0..3 {
+                positions[corner * 3 + axis] = vertex.pos_local[axis] as f32;
+            }
+            normals[corner * 3..corner * 3 + 3].copy_from_slice(&vertex.normal);
+            uvs[corner * 2..corner * 2 + 2].copy_from_slice(&vertex.uv);
+            colors[corner * 4..corner * 4 + 4].copy_from_slice(&vertex.color);
+            if has_tangents {
+                tangents[corner * 4..corner * 4 + 4].copy_from_slice(&vertex.tangent);
+            }
+        }
+    });
+
+    Ok(TileBins {
+        positions,
+        normals,
+        uvs,
+        colors,
+        tangents,
+        runs,
+        tiles,
+    })
+}
+
+// 预扫描所有顶点的 ENU 范围，确定叶子网格的索引范围。
+fn leaf_grid(scene: &SceneData, geo: &GeoContext, leaf_size: f64) -> Option<LeafGrid> {
+    let mut min = [f64::INFINITY; 2];
+    let mut max = [f64::NEG_INFINITY; 2];
+    for part in &scene.parts {
+        for w in geo.transform_positions(&part.positions) {
+            min[0] = min[0].min(w[0]);
+            max[0] = max[0].max(w[0]);
+            min[1] = min[1].min(w[2]);
+            max[1] = max[1].max(w[2]);
+        }
+    }
+    if min[0] > max[0] || min[1] > max[1] {
+        return None;
+    }
+    let min_x = (min[0] / leaf_size).floor() as i32;
+    let max_x = (max[0] / leaf_size).floor() as i32;
+    let min_z = (min[1] / leaf_size).floor() as i32;
+    let max_z = (max[1] / leaf_size).floor() as i32;
+    Some(LeafGrid {
+        min_x,
+        min_z,
+        nx: (max_x - min_x + 1) as usize,
+        nz: (max_z - min_z + 1) as usize,
+    })
+}
+
+// 所有实例的本地包围盒（原型包围盒的 8 个角点经实例变换后取 AABB）与尺寸。
+fn scene_instances(scene: &SceneData, scale: f64) -> Vec<TileInstance> {
+    let mut instances = Vec::new();
+    for (mesh_index, mesh) in scene.instanced.iter().enumerate() {
+        let (min, max) = parts_local_bounds(&mesh.parts);
+        if min[0] > max[0] {
+            continue;
+        }
+        for (index, transform) in mesh.instances.iter().enumerate() {
+            let mut min_local = [f64::INFINITY; 3];
+            let mut max_local = [f64::NEG_INFINITY; 3];
+            for corner in 0..8 {
+                let p = [0, 1, 2].map(|axis| if corner & (1 << axis) == 0 { min[axis] } else { max[axis] });
+                let p = transform.transform_point(p);
+                for axis in 0..3 {
+                    min_local[axis] = min_local[axis].min(p[axis]);
+                    max_local[axis] = max_local[axis].max(p[axis]);
+                }
+            }
+            let diagonal = (0..3)
+                .map(|axis| (max_local[axis] - min_local[axis]).powi(2))
+                .sum::<f64>()
+                .sqrt();
+            instances.push(TileInstance {
+                mesh: mesh_index,
+                index,
+                min_local,
+                max_local,
+                size: diagonal * scale.abs(),
+            });
+        }
+    }
+    instances
+}
+
+// 实例按中心点归入 cell，没有三角形的 cell 新建只含实例的 tile；tile 包围盒扩展到完整覆盖其实例。
+fn assign_instances(
+    bins: &mut TileBins,
+    instances: Vec<TileInstance>,
+    geo: &GeoContext,
+    cell_size: f64,
+) {
+    let mut tile_index: HashMap<(i32, i32), usize> = bins
+        .tiles
+        .iter()
+        .enumerate()
+        .map(|(index, tile)| ((tile.x, tile.z), index))
+        .collect();
+    for instance in instances {
+        let center = instance.center_enu(geo);
+        let key = (
+            (center[0] / cell_size).floor() as i32,
+            (center[2] / cell_size).floor() as i32,
+        );
+        let index = *tile_index.entry(key).or_insert_with(|| {
+            bins.tiles.push(TileBin {
+                x: key.0,
+                z: key.1,
+                first_run: 0,
+                run_count: 0,
+                min_local: [f64::INFINITY; 3],
+                max_local: [f64::NEG_INFINITY; 3],
+                instances: Vec::new(),
+            });
+            bins.tiles.len() - 1
+        });
+        let tile = &mut bins.tiles[index];
+        for axis in 0..3 {
+            tile.min_local[axis] = tile.min_local[axis].min(instance.min_local[axis]);
+            tile.max_local[axis] = tile.max_local[axis].max(instance.max_local[axis]);
+        }
+        tile.instances.push(instance);
+    }
+}
+
+// 按给定 part 顺序遍历每个源三角形，裁剪到覆盖的叶子 cell 并扇形三角化，
+// 对每个非退化子三角形回调 (part, x, z, 顶点)。两遍分箱依赖其输出序列完全一致。
+fn for_each_clipped_triangle(
+    scene: &SceneData,
+    part_order: &[usize],
+    geo: &GeoContext,
+    leaf_size: f64,
+    mut emit: impl FnMut(usize, i32, i32, [&Vertex; 3]),
+) {
+    for &part_index in part_order {
+        clip_part_triangles(&scene.parts[part_index], geo, leaf_size, |x, z, tri| {
+            emit(part_index, x, z, tri)
+        });
+    }
+}
+
+fn part_attributes(part: &MeshPart) -> u32 {
+    let vertex_count = part.vertex_count();
+    let mut attributes = 0;
+    if part.normals.len() == vertex_count * 3 {
+        attributes |= ATTR_NORMALS;
+    }
+    if part.uvs.len() == vertex_count * 2 {
+        attributes |= ATTR_UVS;
+    }
+    if part.colors.len() == vertex_count * 4 {
+        attributes |= ATTR_COLORS;
+    }
+    if part.tangents.len() == vertex_count * 4 {
+        attributes |= ATTR_TANGENTS;
+    }
+    attributes
+}
+
+fn clip_part_triangles(
+    part: &MeshPart,
+    geo: &GeoContext,
+    leaf_size: f64,
+    mut emit: impl FnMut(i32, i32, [&Vertex; 3]),
+) {
+    let vertex_count = part.vertex_count();
+    if vertex_count < 3 {
+        return;
+    }
+    let attributes = part_attributes(part);
+    let enu = geo.local_to_enu();
+    let enu_positions = geo.transform_positions(&part.positions);
+
+    for tri in 0..part.triangle_count() {
+        let corners = part.triangle(tri);
+        if corners.iter().any(|&idx| idx >= vertex_count) {
+            continue;
+        }
+        let tri_vertices = corners.map(|idx| read_vertex(part, idx, attributes));
+        let [w0, w1, w2] = corners.map(|idx| enu_positions[idx]);
+
+        let tri_min_x = w0[0].min(w1[0]).min(w2[0]);
+        let tri_max_x = w0[0].max(w1[0]).max(w2[0]);
+        let tri_min_z = w0[2].min(w1[2]).min(w2[2]);
+        let tri_max_z = w0[2].max(w1[2]).max(w2[2]);
+
+        let tile_x_min = (tri_min_x / leaf_size).floor() as i32;
+        let tile_x_max = (tri_max_x / leaf_size).floor() as i32;
+        let tile_z_min = (tri_min_z / leaf_size).floor() as i32;
+        let tile_z_max = (tri_max_z / leaf_size).floor() as i32;
+
+        // 常见情况：三角形完全落在单个叶子 cell 内，无需裁剪。
+        if tile_x_min == tile_x_max && tile_z_min == tile_z_max {
+            let [a, b, c] = &tri_vertices;
+            if !is_degenerate_triangle(a, b, c, &enu) {
+                emit(tile_x_min, tile_z_min, [a, b, c]);
+            }
+            continue;
+        }
+
+        for tile_x in tile_x_min..=tile_x_max {
+            let x0 = tile_x as f64 * leaf_size;
+            let x1 = x0 + leaf_size;
+            for tile_z in tile_z_min..=tile_z_max {
+                let z0 = tile_z as f64 * leaf_size;
+                let z1 = z0 + leaf_size;
+
+                // 只对三角形包围盒实际跨越的平面裁剪。
+                let planes = [
+                    (0, x0, true, tri_min_x < x0),
+                    (0, x1, false, tri_max_x > x1),
+                    (2, z0, true, tri_min_z < z0),
+                    (2, z1, false, tri_max_z > z1),
+                ];
+                let polygon = clip_triangle_to_tile(&tri_vertices, &planes, attributes, &enu);
+                let polygon = polygon.vertices();
+                if polygon.len() < 3 {
+                    continue;
+                }
+
+                let first = &polygon[0];
+                for i in 1..polygon.len() - 1 {
+                    let a = first;
+                    let b = &polygon[i];
+                    let c = &polygon[i + 1];
+                    if is_degenerate_triangle(a, b, c, &enu) {
+                        continue;
+                    }
+                    emit(tile_x, tile_z, [a, b, c]);
+                }
+            }
+        }
+    }
+}
+
+// 缺失的属性补零（颜色补白色），只有属性位中的属性会被输出。
+fn read_vertex(part: &MeshPart, idx: usize, attributes: u32) -> Vertex {
+    let pos_local = [
+        part.positions[idx * 3] as f64,
+        part.positions[idx * 3 + 1] as f64,
+        part.positions[idx * 3 + 2] as f64,
+    ];
+    let normal = if attributes & ATTR_NORMALS != 0 {
+        [
+            part.normals[idx * 3],
+            part.normals[idx * 3 + 1],
+            part.normals[idx * 3 + 2],
+        ]
+    } else {
+        [0.0; 3]
+    };
+    let uv = if attributes & ATTR_UVS != 0 {
+        [part.uvs[idx * 2], part.uvs[idx * 2 + 1]]
+    } else {
+        [0.0; 2]
+    };
+    let color = if attributes & ATTR_COLORS != 0 {
+        [
+            part.colors[idx * 4],
+            part.colors[idx * 4 + 1],
+            part.colors[idx * 4 + 2],
+            part.colors[idx * 4 + 3],
+        ]
+    } else {
+        [1.0; 4]
+    };
+    let tangent = if attributes & ATTR_TANGENTS != 0 {
+        [
+            part.tangents[idx * 4],
+            part.tangents[idx * 4 + 1],
+            part.tangents[idx * 4 + 2],
+            part.tangents[idx * 4 + 3],
+        ]
+    } else {
+        [0.0; 4]
+    };
+    Vertex {
+        pos_local,
+        normal,
+        uv,
+        color,
+        tangent,
+    }
+}
+
+// 每个 part 对应一种材质（按材质升序）；写出时临时改为 tile 内材质索引，写完后还原。
+// 实例按原型写成 EXT_mesh_gpu_instancing 节点，原型网格不在 tile 内重排或简化。
+fn write_tile(
+    mut parts: Vec<MeshPart>,
+    instances: &[TileInstance],
+    coarse: &[CoarseAtlas],
+    context: &LodContext,
+    path: &Path,
+    cell_size: f64,
+) -> Result<Vec<MeshPart>> {
+    let _span = stats::span("write_tile");
+    let scene = context.scene;
+    let global_indices: Vec<usize> = parts.iter().map(|part| part.material_index).collect();
+    let mut texture_lods: Vec<u32> = parts
+        .iter()
+        .map(|part| texture_lod(context, &scene.materials[part.material_index], part, cell_size))
+        .collect();
+    // 三角形按顶点缓存局部性重排（顶点随之按首次引用重新编号）；压缩时写出端已做同样的重排。
+    // 重排在增量检查之前进行，未变化的 tile 与重新写出的 tile 返回同样的网格，上一层简化结果一致。
+    if context.glb.compression.is_none() {
+        for part in &mut parts {
+            if !part.indices.is_empty() {
+                *part = optimize_mesh_part(part);
+            }
+        }
+    }
+    if let Some(manifest) = context.manifest {
+        // 输入未变化的 tile 保留上次的文件；网格仍照常返回，供上一层简化。
+        let hash = tile_content_hash(context, &parts, &texture_lods, instances, coarse, cell_size);
+        if manifest.check(path, hash) {
+            stats::add("tiles.unchanged", 1);
+            return Ok(parts);
+        }
+    }
+    if context.atlas {
+        // 图集烘焙生成新的网格与材质，原 parts 不变，继续作为上一层简化的输入。
+        let baked = bake_tile_atlas(&parts, &scene.materials, &texture_lods, context.registry)
+            .with_context(|| format!("bake atlas for {}", path.display()))?;
+        let mut materials = baked.materials;
+        let mut texture_lods = baked.texture_lods;
+        let instanced =
+            tile_instanced_meshes(context, instances, &[], &mut materials, &mut texture_lods, cell_size);
+        let mut scene_tile = SceneData {
+            materials,
+            parts: baked.parts,
+            instanced,
+            right_axis: scene.right_axis,
+            up_axis: scene.up_axis,
+        };
+        push_coarse_atlases(&mut scene_tile, &mut texture_lods, coarse)?;
+        write_tile_scene(&scene_tile, context, path, &texture_lods)?;
+        return Ok(parts);
+    }
+    let mut materials: Vec<Material> = global_indices
+        .iter()
+        .map(|index| scene.materials[*index].clone())
+        .collect();
+    let instanced = tile_instanced_meshes(
+        context,
+        instances,
+        &global_indices,
+        &mut materials,
+        &mut texture_lods,
+        cell_size,
+    );
+    for (local_index, part) in parts.iter_mut().enumerate() {
+        part.material_index = local_index;
+    }
+    let part_count = parts.len();
+    let mut scene_tile = SceneData {
+        materials,
+        parts,
+        instanced,
+        right_axis: scene.right_axis,
+        up_axis: scene.up_axis,
+    };
+    push_coarse_atlases(&mut scene_tile, &mut texture_lods, coarse)?;
+    let result = write_tile_scene(&scene_tile, context, path, &texture_lods);
+    let mut parts = scene_tile.parts;
+    parts.truncate(part_count);
+    for (part, index) in parts.iter_mut().zip(global_indices) {
+        part.material_index = index;
+    }
+    result.map(|_| parts)
+}
+
+// 粗层级图集追加为 tile 的最后几个图元，各自带一张内嵌图集纹理（写出时按纹理模式外置或内嵌）。
+fn push_coarse_atlases(
+    scene_tile: &mut SceneData,
+    texture_lods: &mut Vec<u32>,
+    coarse: &[CoarseAtlas],
+) -> Result<()> {
+    for atlas in coarse {
+        let mut material = atlas.material.clone();
+        material.base_color_texture = Some(embedded_texture(atlas.image.clone(), "coarse")?);
+        scene_tile.parts.push(MeshPart {
+            material_index: scene_tile.materials.len(),
+            ..atlas.part.clone()
+        });
+        scene_tile.materials.push(material);
+        texture_lods.push(0);
+    }
+    Ok(())
+}
+
+// tile 内的实例按原型分组（原型按序号升序）。原型材质改为 tile 内索引：已被烘焙网格使用的材质
+// （shared 为其全局索引，按 tile 内索引排列）沿用该索引，其余追加到 materials 末尾并补上纹理级别。
+fn tile_instanced_meshes(
+    context: &LodContext,
+    instances: &[TileInstance],
+    shared: &[usize],
+    materials: &mut Vec<Material>,
+    texture_lods: &mut Vec<u32>,
+    cell_size: f64,
+) -> Vec<InstancedMesh> {
+    let scene = context.scene;
+    let mut order: Vec<(usize, usize)> =
+        instances.iter().map(|instance| (instance.mesh, instance.index)).collect();
+    order.sort_unstable();
+    let mut local_materials: HashMap<usize, usize> =
+        shared.iter().enumerate().map(|(local, &global)| (global, local)).collect();
+    let mut meshes = Vec::new();
+    for group in order.chunk_by(|a, b| a.0 == b.0) {
+        let mesh = &scene.instanced[group[0].0];
+        let parts = mesh
+            .parts
+            .iter()
+            .map(|part| {
+                let global = part.material_index;
+                let local = *local_materials.entry(global).or_insert_with(|| {
+                    let material = &scene.materials[global];
+                    materials.push(material.clone());
+                    texture_lods.push(texture_lod(context, material, part, cell_size));
+                    materials.len() - 1
+                });
+                MeshPart {
+                    material_index: local,
+                    ..part.clone()
+                }
+            })
+            .collect();
+        let instances = group.iter().map(|&(_, index)| mesh.instances[index]).collect();
+        meshes.push(InstancedMesh { parts, instances });
+    }
+    meshes
+}
+
+fn write_tile_scene(
+    scene_tile: &SceneData,
+    context: &LodContext,
+    path: &Path,
+    texture_lods: &[u32],
+) -> Result<()> {
+    let mut mode = match context.texture_cache {
+        Some(cache) => TextureMode::External(cache),
+        None => TextureMode::Embed,
+    };
+    let entry_name;
+    let target = match context.archive {
+        Some(archive) => {
+            entry_name = archive_entry_name(path);
+            GlbTarget::Archive(archive, &entry_name)
+        }
+        None => GlbTarget::File(path),
+    };
+    write_glb_with_textures(
+        scene_tile,
+        context.registry,
+        target,
+        &mut mode,
+        &context.glb,
+        texture_lods,
+    )
+    .with_context(|| format!("write tile {}", path.display()))?;
+    stats::add("tiles.written", 1);
+    Ok(())
+}
+
+// 父层 tile 在屏幕上与叶子 tile 尺寸相当，每上升一层所需纹素密度减半；
+// 但降采样后 tile 用到的 UV 范围仍至少覆盖这么多纹素。
+const LOD_TEXTURE_TEXELS: f64 = 512.0;
+
+// 材质纹理的降采样级别：取层级深度与纹素密度允许值中的较小者，叶子层总是原图。
+fn texture_lod(context: &LodContext, material: &Material, part: &MeshPart, cell_size: f64) -> u32 {
+    let depth = (cell_size / context.leaf_size).log2().round().max(0.0) as u32;
+    if depth == 0 || part.uvs.is_empty() {
+        return 0;
+    }
+    let Some((width, height)) = [
+        &material.base_color_texture,
+        &material.normal_texture,
+        &material.emissive_texture,
+    ]
+    .into_iter()
+    .flatten()
+    .filter_map(|texture| context.registry.dimensions(texture))
+    .max_by_key(|(width, height)| (*width).max(*height)) else {
+        return 0;
+    };
+    let mut min = [f32::INFINITY; 2];
+    let mut max = [f32::NEG_INFINITY; 2];
+    for uv in part.uvs.chunks_exact(2) {
+        for axis in 0..2 {
+            min[axis] = min[axis].min(uv[axis]);
+            max[axis] = max[axis].max(uv[axis]);
+        }
+    }
+    let texels = ((max[0] - min[0]) as f64 * width as f64)
+        .max((max[1] - min[1]) as f64 * height as f64);
+    if texels <= LOD_TEXTURE_TEXELS {
+        return 0;
+    }
+    let density_lod = (texels / LOD_TEXTURE_TEXELS).log2().floor() as u32;
+    depth.min(density_lod)
 }
 
-struct TileBucket {
-    parts: HashMap<usize, PartBuilder>,
-    min_local: [f64; 3],
-    max_local: [f64; 3],
+// 每上升一层保留的三角形比例，使各层 tile 的三角形数大致相当。
+const LOD_REDUCTION: f64 = 0.25;
+// 内部节点 geometricError 的下限（相对该层 tile 尺寸），保证父节点误差随层级单调增长。
+const LOD_MIN_ERROR_RATIO: f64 = 1.0 / 256.0;
+// 父节点保留的实例尺寸下限（相对该层 tile 尺寸）；更小的实例只出现在更深的层级。
+const LOD_INSTANCE_MIN_RATIO: f64 = 1.0 / 64.0;
+
+struct LodContext<'a> {
+    scene: &'a SceneData,
+    registry: &'a TextureRegistry,
+    geo: &'a GeoContext,
+    tiles_dir: &'a Path,
+    texture_cache: Option<&'a TextureCache>,
+    // 设置时 tile 写入归档，tiles_dir 为归档内路径。
+    archive: Option<&'a TileArchive>,
+    tile_size: f64,
+    leaf_size: f64,
+    scale: f64,
+    glb: GlbOptions,
+    atlas: bool,
+    implicit: bool,
+    coarse_levels: u32,
+    coarse_texture_size: u32,
+    manifest: Option<&'a TileManifest>,
+    global_min_y: f64,
+    global_max_y: f64,
 }
 
-#[derive(Clone)]
-struct TileNode {
-    level: u32,
-    x: i32,
-    z: i32,
-    min_local: [f64; 3],
-    max_local: [f64; 3],
-    has_content: bool,
-    children: Vec<TileNode>,
+impl LodContext<'_> {
+    // 隐式分块时按所在根 cell 与相对坐标命名，tileset.json 才能用 URI 模板引用。
+    fn tile_path(&self, cell: &TileCell) -> PathBuf {
+        let filename = if self.implicit {
+            implicit_tile_filename(cell.level, cell.x, cell.z)
+        } else {
+            tile_filename(cell.level, cell.x, cell.z, cell.y_index())
+        };
+        self.tiles_dir.join(filename)
+    }
 }
 
-#[derive(Clone)]
-struct Vertex {
-    pos_local: [f64; 3],
-    pos_enu: [f64; 3],
-    normal: [f32; 3],
-    uv: [f32; 2],
-    color: [f32; 4],
+// 构建中的四叉树节点及其网格与实例；两者都只保留到父节点构建完成为止。
+struct LodNode {
+    node: TileNode,
+    parts: Vec<MeshPart>,
+    instances: Vec<TileInstance>,
+    // 粗层级节点的烘焙图集。
+    coarse: Vec<CoarseAtlas>,
 }
 
-// ufbx 已统一输出为 Y-up，这里无需额外轴变换。
+fn build_leaf_node(
+    context: &LodContext,
+    cell: TileCell,
+    mut min_local: [f64; 3],
+    mut max_local: [f64; 3],
+    parts: Vec<MeshPart>,
+    instances: Vec<TileInstance>,
+) -> Result<LodNode> {
+    // 只有沿 Y 细分过的 cell 按实际高度给出包围盒。
+    if cell.y.is_none() {
+        min_local[UP_AXIS] = context.global_min_y;
+        max_local[UP_AXIS] = context.global_max_y;
+    }
+    let path = context.tile_path(&cell);
+    let parts = write_tile(parts, &instances, &[], context, &path, context.leaf_size)?;
+    Ok(LodNode {
+        node: TileNode {
+            level: cell.level,
+            x: cell.x,
+            z: cell.z,
+            y: cell.y_index(),
+            min_local,
+            max_local,
+            has_content: true,
+            geometric_error: 0.0,
+            children: Vec::new(),
+        },
+        parts,
+        instances,
+        coarse: Vec::new(),
+    })
+}
 
-pub fn export_tileset(scene: &SceneData, output_dir: &Path, options: &TilesetOptions) -> Result<()> {
-    if scene.parts.is_empty() {
-        bail!("no mesh data found in FBX");
+fn build_lod_node(
+    context: &LodContext,
+    level: u32,
+    x: i32,
+    z: i32,
+    children: Vec<LodNode>,
+) -> Result<LodNode> {
+    let cell = TileCell::quad(level, x, z);
+    build_parent_node(context, cell, cell.size(context.tile_size), children)
+}
+
+// texture_cell_size 决定纹理降采样级别，自适应细分时按子树实际深度给出。
+fn build_parent_node(
+    context: &LodContext,
+    cell: TileCell,
+    texture_cell_size: f64,
+    children: Vec<LodNode>,
+) -> Result<LodNode> {
+    let _span = stats::span("build_parent_node");
+    let cell_size = cell.size(context.tile_size);
+
+    let mut min_local = [f64::INFINITY; 3];
+    let mut max_local = [f64::NEG_INFINITY; 3];
+    let mut child_error = 0.0f64;
+    let mut child_nodes = Vec::with_capacity(children.len());
+    let mut child_parts = Vec::new();
+    let mut child_instances = Vec::new();
+    let mut child_coarse = Vec::new();
+    for child in children {
+        for axis in 0..3 {
+            min_local[axis] = min_local[axis].min(child.node.min_local[axis]);
+            max_local[axis] = max_local[axis].max(child.node.max_local[axis]);
+        }
+        child_error = child_error.max(child.node.geometric_error);
+        child_nodes.push(child.node);
+        child_parts.extend(child.parts);
+        child_instances.extend(child.instances);
+        child_coarse.extend(child.coarse);
     }
-    if options.tile_size <= 0.0 {
-        bail!("tile_size must be positive");
+    child_nodes.sort_by_key(TileNode::order_key);
+
+    let mut simplify_error = 0.0f64;
+    let mut parts = Vec::new();
+    for part in merge_parts_by_material(child_parts) {
+        let (simplified, error) = simplify_in_cell(context, &cell, &part);
+        simplify_error = simplify_error.max(error);
+        if simplified.triangle_count() > 0 {
+            parts.push(simplified);
+        }
     }
-    if options.min_tile_size <= 0.0 {
-        bail!("min_tile_size must be positive");
+
+    // 粗层级：子节点图集拼接后与网格一起简化；仍带原材质纹理的 part 在本层烘焙，不再向上传递。
+    let mut coarse = Vec::new();
+    if cell.level < context.coarse_levels {
+        for atlas in merge_coarse_atlases(child_coarse, context.coarse_texture_size) {
+            let (simplified, error) = simplify_in_cell(context, &cell, &atlas.part);
+            simplify_error = simplify_error.max(error);
+            if simplified.triangle_count() > 0 {
+                coarse.push(atlas.with_part(simplified));
+            }
+        }
+        let materials = &context.scene.materials;
+        let texture_lods: Vec<u32> = parts
+            .iter()
+            .map(|part| {
+                texture_lod(context, &materials[part.material_index], part, texture_cell_size)
+            })
+            .collect();
+        let (baked, remaining) = bake_coarse_atlases(
+            &parts,
+            materials,
+            &texture_lods,
+            context.registry,
+            context.coarse_texture_size,
+        );
+        if !baked.is_empty() {
+            coarse.extend(baked);
+            let mut remaining = remaining.into_iter().peekable();
+            parts = parts
+                .into_iter()
+                .enumerate()
+                .filter(|(index, _)| remaining.next_if_eq(index).is_some())
+                .map(|(_, part)| part)
+                .collect();
+        }
     }
 
-    let geo = GeoContext::new(
-        options.origin_lat,
-        options.origin_lon,
-        options.origin_height,
-        options.heading,
-        options.scale,
-    );
+    // 实例不简化，只保留相对本层 cell 足够大的；舍弃的实例按其尺寸计入几何误差。
+    let min_instance_size = cell_size * LOD_INSTANCE_MIN_RATIO;
+    let (instances, dropped): (Vec<TileInstance>, Vec<TileInstance>) = child_instances
+        .into_iter()
+        .partition(|instance| instance.size >= min_instance_size);
+    let dropped_error = dropped.iter().map(|instance| instance.size).fold(0.0, f64::max);
+
+    let geometric_error = (child_error + (simplify_error * context.scale.abs()).max(dropped_error))
+        .max(cell_size * LOD_MIN_ERROR_RATIO);
+    if cell.y.is_none() {
+        min_local[UP_AXIS] = context.global_min_y;
+        max_local[UP_AXIS] = context.global_max_y;
+    }
 
-    let max_level = options
-        .max_level
-        .unwrap_or_else(|| compute_max_level(options.tile_size, options.min_tile_size));
-    let leaf_size = options.tile_size / 2_f64.powi(max_level as i32);
+    let has_content = !parts.is_empty() || !instances.is_empty() || !coarse.is_empty();
+    let parts = if has_content {
+        let path = context.tile_path(&cell);
+        write_tile(parts, &instances, &coarse, context, &path, texture_cell_size)?
+    } else {
+        parts
+    };
 
-    let mut buckets: HashMap<(i32, i32), TileBucket> = HashMap::new();
-    let mut global_min_local = [f64::INFINITY; 3];
-    let mut global_max_local = [f64::NEG_INFINITY; 3];
+    Ok(LodNode {
+        node: TileNode {
+            level: cell.level,
+            x: cell.x,
+            z: cell.z,
+            y: cell.y_index(),
+            min_local,
+            max_local,
+            has_content,
+            geometric_error,
+            children: child_nodes,
+        },
+        parts,
+        instances,
+        coarse,
+    })
+}
 
-    for part in &scene.parts {
-        let positions = &part.positions;
-        if positions.len() < 9 {
-            continue;
+// 锁定本节点 cell 边界上的顶点后按 LOD_REDUCTION 简化，相邻节点独立简化后仍能无缝拼接。
+fn simplify_in_cell(context: &LodContext, cell: &TileCell, part: &MeshPart) -> (MeshPart, f64) {
+    let cell_size = cell.size(context.tile_size);
+    let x0 = cell.x as f64 * cell_size;
+    let z0 = cell.z as f64 * cell_size;
+    let eps = context.leaf_size * 1e-3;
+    let locked: Vec<bool> = context
+        .geo
+        .transform_positions(&part.positions)
+        .into_iter()
+        .map(|enu| {
+            (enu[0] - x0).abs() < eps
+                || (enu[0] - x0 - cell_size).abs() < eps
+                || (enu[2] - z0).abs() < eps
+                || (enu[2] - z0 - cell_size).abs() < eps
+                || cell.y.is_some_and(|(_, y0, y1)| {
+                    (enu[1] - y0).abs() < eps || (enu[1] - y1).abs() < eps
+                })
+        })
+        .collect();
+    let target = (part.triangle_count() as f64 * LOD_REDUCTION).ceil() as usize;
+    let _span = stats::span("simplify");
+    simplify_mesh(part, &locked, target)
+}
+
+// 合并同材质的子节点网格（索引按顶点偏移平移），结果按材质升序。
+fn merge_parts_by_material(mut parts: Vec<MeshPart>) -> Vec<MeshPart> {
+    parts.sort_by_key(|part| part.material_index);
+    let mut merged: Vec<MeshPart> = Vec::new();
+    for part in parts {
+        match merged.last_mut() {
+            Some(last) if last.material_index == part.material_index => {
+                let base = last.vertex_count() as u32;
+                let last_count = last.vertex_count();
+                let count = part.vertex_count();
+                // 法线/UV/切线只有在两侧都齐全时才保留；颜色缺失的一侧补白色。
+                if last.normals.len() == last_count * 3 && part.normals.len() == count * 3 {
+                    last.normals.to_mut().extend_from_slice(&part.normals);
+                } else {
+                    last.normals.to_mut().clear();
+                }
+                if last.uvs.len() == last_count * 2 && part.uvs.len() == count * 2 {
+                    last.uvs.to_mut().extend_from_slice(&part.uvs);
+                } else {
+                    last.uvs.to_mut().clear();
+                }
+                let last_colors = last.colors.len() == last_count * 4;
+                let part_colors = part.colors.len() == count * 4;
+                if last_colors || part_colors {
+                    let colors = last.colors.to_mut();
+                    if !last_colors {
+                        *colors = vec![1.0; last_count * 4];
+                    }
+                    if part_colors {
+                        colors.extend_from_slice(&part.colors);
+                    } else {
+                        colors.resize(colors.len() + count * 4, 1.0);
+                    }
+                }
+                if last.tangents.len() == last_count * 4 && part.tangents.len() == count * 4 {
+                    last.tangents.to_mut().extend_from_slice(&part.tangents);
+                } else {
+                    last.tangents.to_mut().clear();
+                }
+                last.positions.to_mut().extend_from_slice(&part.positions);
+                for tri in 0..part.triangle_count() {
+                    for index in part.triangle(tri) {
+                        last.indices.to_mut().push(base + index as u32);
+                    }
+                }
+            }
+            _ => merged.push(part),
         }
-        let has_normals = part.normals.len() == positions.len();
-        let has_uvs = part.uvs.len() * 3 == positions.len() * 2;
-        let has_colors = part.colors.len() * 3 == positions.len() * 4;
-
-        for tri in (0..positions.len()).step_by(9) {
-            let p0 = [
-                positions[tri] as f64,
-                positions[tri + 1] as f64,
-                positions[tri + 2] as f64,
-            ];
-            let p1 = [
-                positions[tri + 3] as f64,
-                positions[tri + 4] as f64,
-                positions[tri + 5] as f64,
-            ];
-            let p2 = [
-                positions[tri + 6] as f64,
-                positions[tri + 7] as f64,
-                positions[tri + 8] as f64,
-            ];
-
-            let w0 = geo.transform_local(p0);
-            let w1 = geo.transform_local(p1);
-            let w2 = geo.transform_local(p2);
-
-            let n0 = if has_normals {
-                [
-                    part.normals[tri],
-                    part.normals[tri + 1],
-                    part.normals[tri + 2],
-                ]
-            } else {
-                [0.0; 3]
-            };
-            let n1 = if has_normals {
-                [
-                    part.normals[tri + 3],
-                    part.normals[tri + 4],
-                    part.normals[tri + 5],
-                ]
-            } else {
-                [0.0; 3]
-            };
-            let n2 = if has_normals {
-                [
-                    part.normals[tri + 6],
-                    part.normals[tri + 7],
-                    part.normals[tri + 8],
-                ]
-            } else {
-                [0.0; 3]
-            };
+    }
+    merged
+}
 
-            let (uv0, uv1, uv2) = if has_uvs {
-                let uv_start = (tri / 3) * 2;
-                (
-                    [part.uvs[uv_start], part.uvs[uv_start + 1]],
-                    [part.uvs[uv_start + 2], part.uvs[uv_start + 3]],
-                    [part.uvs[uv_start + 4], part.uvs[uv_start + 5]],
-                )
-            } else {
-                ([0.0; 2], [0.0; 2], [0.0; 2])
-            };
+// 未压缩几何数据的字节数估算：f32 顶点属性加索引（顶点数 ≤ 65535 时为 u16）。
+fn estimate_geometry_bytes(parts: &[MeshPart]) -> usize {
+    parts
+        .iter()
+        .map(|part| {
+            let attributes = part.positions.len() + part.normals.len() + part.uvs.len();
+            let index_size = if part.vertex_count() <= u16::MAX as usize { 2 } else { 4 };
+            (attributes + part.colors.len() + part.tangents.len()) * 4
+                + part.triangle_count() * 3 * index_size
+        })
+        .sum()
+}
 
-            let (c0, c1, c2) = if has_colors {
-                let color_start = (tri / 3) * 4;
-                (
-                    [
-                        part.colors[color_start],
-                        part.colors[color_start + 1],
-                        part.colors[color_start + 2],
-                        part.colors[color_start + 3],
-                    ],
-                    [
-                        part.colors[color_start + 4],
-                        part.colors[color_start + 5],
-                        part.colors[color_start + 6],
-                        part.colors[color_start + 7],
-                    ],
-                    [
-                        part.colors[color_start + 8],
-                        part.colors[color_start + 9],
-                        part.colors[color_start + 10],
-                        part.colors[color_start + 11],
-                    ],
-                )
-            } else {
-                ([0.0; 4], [0.0; 4], [0.0; 4])
-            };
+fn parts_local_bounds(parts: &[MeshPart]) -> ([f64; 3], [f64; 3]) {
+    let mut min = [f64::INFINITY; 3];
+    let mut max = [f64::NEG_INFINITY; 3];
+    for part in parts {
+        for p in part.positions.chunks_exact(3) {
+            for axis in 0..3 {
+                min[axis] = min[axis].min(p[axis] as f64);
+                max[axis] = max[axis].max(p[axis] as f64);
+            }
+        }
+    }
+    (min, max)
+}
 
-            let v0 = Vertex {
-                pos_local: p0,
-                pos_enu: w0,
-                normal: n0,
-                uv: uv0,
-                color: c0,
-            };
-            let v1 = Vertex {
-                pos_local: p1,
-                pos_enu: w1,
-                normal: n1,
-                uv: uv1,
-                color: c1,
-            };
-            let v2 = Vertex {
-                pos_local: p2,
-                pos_enu: w2,
-                normal: n2,
-                uv: uv2,
-                color: c2,
-            };
-            let tri_vertices = [v0, v1, v2];
-
-            let tri_min_x = w0[0].min(w1[0]).min(w2[0]);
-            let tri_max_x = w0[0].max(w1[0]).max(w2[0]);
-            let tri_min_z = w0[2].min(w1[2]).min(w2[2]);
-            let tri_max_z = w0[2].max(w1[2]).max(w2[2]);
-
-            let tile_x_min = (tri_min_x / leaf_size).floor() as i32;
-            let tile_x_max = (tri_max_x / leaf_size).floor() as i32;
-            let tile_z_min = (tri_min_z / leaf_size).floor() as i32;
-            let tile_z_max = (tri_max_z / leaf_size).floor() as i32;
-
-            for tile_x in tile_x_min..=tile_x_max {
-                let x0 = tile_x as f64 * leaf_size;
-                let x1 = x0 + leaf_size;
-                for tile_z in tile_z_min..=tile_z_max {
-                    let z0 = tile_z as f64 * leaf_size;
-                    let z1 = z0 + leaf_size;
-
-                    let polygon =
-                        clip_triangle_to_tile(&tri_vertices, x0, x1, z0, z1, has_normals);
-                    if polygon.len() < 3 {
-                        continue;
-                    }
+// 自适应细分：超出预算的 cell 裁剪为 4 个子 cell（高度大于边长时沿 Y 再分为 8 个），
+// 直到满足预算或达到 max_level；父节点照常由子节点网格简化得到。
+struct AdaptiveContext<'a> {
+    lod: &'a LodContext<'a>,
+    budget: TileBudget,
+    max_level: u32,
+}
 
-                    let bucket = buckets
-                        .entry((tile_x, tile_z))
-                        .or_insert_with(|| TileBucket {
-                            parts: HashMap::new(),
-                            min_local: [f64::INFINITY; 3],
-                            max_local: [f64::NEG_INFINITY; 3],
-                        });
-
-                    let first = &polygon[0];
-                    for i in 1..polygon.len() - 1 {
-                        let a = first;
-                        let b = &polygon[i];
-                        let c = &polygon[i + 1];
-                        if is_degenerate_triangle(a, b, c) {
-                            continue;
-                        }
+impl AdaptiveContext<'_> {
+    // 返回节点与其子树高度（叶子为 0），高度用于父节点的纹理降采样级别。
+    fn build_node(
+        &self,
+        cell: TileCell,
+        parts: Vec<MeshPart>,
+        instances: Vec<TileInstance>,
+        jobs: usize,
+    ) -> Result<(LodNode, u32)> {
+        let context = self.lod;
+        if cell.level < self.max_level && !self.budget.fits(&parts, &instances, context.scene) {
+            let children = self.split(cell, &parts, &instances);
+            if !children.is_empty() {
+                drop(parts);
+                let child_jobs = (jobs / children.len()).max(1);
+                let built = parallel_map(jobs, children, |(child, parts, instances)| {
+                    self.build_node(child, parts, instances, child_jobs)
+                })?;
+                let height = built.iter().map(|(_, height)| height + 1).max().unwrap_or(1);
+                let nodes = built.into_iter().map(|(node, _)| node).collect();
+                let texture_cell_size = context.leaf_size * 2_f64.powi(height as i32);
+                let node = build_parent_node(context, cell, texture_cell_size, nodes)?;
+                return Ok((node, height));
+            }
+        }
+        let (mut min_local, mut max_local) = parts_local_bounds(&parts);
+        for instance in &instances {
+            for axis in 0..3 {
+                min_local[axis] = min_local[axis].min(instance.min_local[axis]);
+                max_local[axis] = max_local[axis].max(instance.max_local[axis]);
+            }
+        }
+        let node = build_leaf_node(context, cell, min_local, max_local, parts, instances)?;
+        Ok((node, 0))
+    }
 
-                        let mut tri_min_local = [f64::INFINITY; 3];
-                        let mut tri_max_local = [f64::NEG_INFINITY; 3];
-                        for vertex in [a, b, c] {
-                            let local = vertex.pos_local;
-                            tri_min_local[0] = tri_min_local[0].min(local[0]);
-                            tri_min_local[1] = tri_min_local[1].min(local[1]);
-                            tri_min_local[2] = tri_min_local[2].min(local[2]);
-                            tri_max_local[0] = tri_max_local[0].max(local[0]);
-                            tri_max_local[1] = tri_max_local[1].max(local[1]);
-                            tri_max_local[2] = tri_max_local[2].max(local[2]);
-                        }
+    // 把 cell 内的网格裁剪到各子 cell、实例按中心点分到各子 cell，只返回非空的子 cell；
+    // 每个子 cell 内仍按材质升序每种一个 part。
+    fn split(
+        &self,
+        cell: TileCell,
+        parts: &[MeshPart],
+        instances: &[TileInstance],
+    ) -> Vec<(TileCell, Vec<MeshPart>, Vec<TileInstance>)> {
+        let geo = self.lod.geo;
+        let half = cell.size(self.lod.tile_size) * 0.5;
+        let mid_x = (cell.x * 2 + 1) as f64 * half;
+        let mid_z = (cell.z * 2 + 1) as f64 * half;
+
+        // 纵向范围：未沿 Y 细分过的 cell 取网格实际高度。
+        let (y_index, y0, y1) = cell.y.unwrap_or_else(|| {
+            let mut range = (f64::INFINITY, f64::NEG_INFINITY);
+            for part in parts {
+                for enu in geo.transform_positions(&part.positions) {
+                    range = (range.0.min(enu[1]), range.1.max(enu[1]));
+                }
+            }
+            (0, range.0, range.1)
+        });
+        let split_y = y1 - y0 > half * 2.0;
+        let mid_y = 0.5 * (y0 + y1);
+        let ny = if split_y { 2 } else { 1 };
+
+        let mut cells = Vec::with_capacity(4 * ny);
+        for dz in 0..2 {
+            for dx in 0..2 {
+                for dy in 0..ny {
+                    // 纵向序号逐层翻倍，不同父节点的子 cell 文件名不会冲突。
+                    let y = if split_y {
+                        let range = if dy == 0 { (y0, mid_y) } else { (mid_y, y1) };
+                        Some((y_index * 2 + dy as i32, range.0, range.1))
+                    } else {
+                        cell.y.map(|(y, low, high)| (y * 2, low, high))
+                    };
+                    cells.push(TileCell {
+                        level: cell.level + 1,
+                        x: cell.x * 2 + dx,
+                        z: cell.z * 2 + dz,
+                        y,
+                    });
+                }
+            }
+        }
+        let child_index = |dx: usize, dy: usize, dz: usize| (dz * 2 + dx) * ny + dy;
+        let side = |value: f64, mid: f64| usize::from(value >= mid);
+
+        let mut child_instances: Vec<Vec<TileInstance>> = vec![Vec::new(); cells.len()];
+        for instance in instances {
+            let center = instance.center_enu(geo);
+            let dy = if split_y { side(center[1], mid_y) } else { 0 };
+            let child = child_index(side(center[0], mid_x), dy, side(center[2], mid_z));
+            child_instances[child].push(*instance);
+        }
 
-                        for axis in 0..3 {
-                            bucket.min_local[axis] =
-                                bucket.min_local[axis].min(tri_min_local[axis]);
-                            bucket.max_local[axis] =
-                                bucket.max_local[axis].max(tri_max_local[axis]);
-                            global_min_local[axis] =
-                                global_min_local[axis].min(tri_min_local[axis]);
-                            global_max_local[axis] =
-                                global_max_local[axis].max(tri_max_local[axis]);
-                        }
+        let mut child_parts: Vec<Vec<MeshPart>> = (0..cells.len()).map(|_| Vec::new()).collect();
+        let enu = geo.local_to_enu();
+        for part in parts {
+            let attributes = part_attributes(part);
+            let enu_positions = geo.transform_positions(&part.positions);
+            let mut builders: Vec<Option<PartBuilder>> = (0..cells.len()).map(|_| None).collect();
+            let mut emit = |child: usize, tri: [&Vertex; 3]| {
+                let builder = builders[child].get_or_insert_with(|| {
+                    PartBuilder::with_capacity(part.name.clone(), part.material_index, 0)
+                });
+                for vertex in tri {
+                    let position = vertex.pos_local.map(|value| value as f32);
+                    builder.push_vertex(
+                        &position,
+                        &vertex.normal,
+                        &vertex.uv,
+                        &vertex.color,
+                        &vertex.tangent,
+                        attributes,
+                    );
+                }
+            };
 
-                        let builder =
-                            bucket
-                                .parts
-                                .entry(part.material_index)
-                                .or_insert_with(|| PartBuilder {
-                                    name: part.name.clone(),
-                                    material_index: part.material_index,
-                                    positions: Vec::new(),
-                                    normals: Vec::new(),
-                                    uvs: Vec::new(),
-                                    colors: Vec::new(),
-                                });
-
-                        builder.positions.extend_from_slice(&[
-                            a.pos_local[0] as f32,
-                            a.pos_local[1] as f32,
-                            a.pos_local[2] as f32,
-                            b.pos_local[0] as f32,
-                            b.pos_local[1] as f32,
-                            b.pos_local[2] as f32,
-                            c.pos_local[0] as f32,
-                            c.pos_local[1] as f32,
-                            c.pos_local[2] as f32,
-                        ]);
-
-                        if has_normals {
-                            builder.normals.extend_from_slice(&[
-                                a.normal[0],
-                                a.normal[1],
-                                a.normal[2],
-                                b.normal[0],
-                                b.normal[1],
-                                b.normal[2],
-                                c.normal[0],
-                                c.normal[1],
-                                c.normal[2],
-                            ]);
-                        }
-                        if has_uvs {
-                            builder.uvs.extend_from_slice(&[
-                                a.uv[0], a.uv[1], b.uv[0], b.uv[1], c.uv[0], c.uv[1],
-                            ]);
-                        }
-                        if has_colors {
-                            builder.colors.extend_from_slice(&[
-                                a.color[0],
-                                a.color[1],
-                                a.color[2],
-                                a.color[3],
-                                b.color[0],
-                                b.color[1],
-                                b.color[2],
-                                b.color[3],
-                                c.color[0],
-                                c.color[1],
-                                c.color[2],
-                                c.color[3],
-                            ]);
+            for tri in 0..part.triangle_count() {
+                let corners = part.triangle(tri);
+                let tri_vertices = corners.map(|idx| read_vertex(part, idx, attributes));
+                let mut min = [f64::INFINITY; 3];
+                let mut max = [f64::NEG_INFINITY; 3];
+                for idx in corners {
+                    for axis in 0..3 {
+                        min[axis] = min[axis].min(enu_positions[idx][axis]);
+                        max[axis] = max[axis].max(enu_positions[idx][axis]);
+                    }
+                }
+                let (x_lo, x_hi) = (side(min[0], mid_x), side(max[0], mid_x));
+                let (z_lo, z_hi) = (side(min[2], mid_z), side(max[2], mid_z));
+                let (y_lo, y_hi) = if split_y {
+                    (side(min[1], mid_y), side(max[1], mid_y))
+                } else {
+                    (0, 0)
+                };
+
+                let [a, b, c] = &tri_vertices;
+                if x_lo == x_hi && z_lo == z_hi && y_lo == y_hi {
+                    if !is_degenerate_triangle(a, b, c, &enu) {
+                        emit(child_index(x_lo, y_lo, z_lo), [a, b, c]);
+                    }
+                    continue;
+                }
+                for dz in z_lo..=z_hi {
+                    for dx in x_lo..=x_hi {
+                        for dy in y_lo..=y_hi {
+                            let child = child_index(dx, dy, dz);
+                            let x0 = cells[child].x as f64 * half;
+                            let z0 = cells[child].z as f64 * half;
+                            let (cy0, cy1) = if dy == 0 { (y0, mid_y) } else { (mid_y, y1) };
+                            let planes = [
+                                (0, x0, true, min[0] < x0),
+                                (0, x0 + half, false, max[0] > x0 + half),
+                                (2, z0, true, min[2] < z0),
+                                (2, z0 + half, false, max[2] > z0 + half),
+                                (1, cy0, true, split_y && min[1] < cy0),
+                                (1, cy1, false, split_y && max[1] > cy1),
+                            ];
+                            let polygon =
+                                clip_triangle_to_tile(&tri_vertices, &planes, attributes, &enu);
+                            let polygon = polygon.vertices();
+                            for i in 1..polygon.len().saturating_sub(1) {
+                                let (a, b, c) = (&polygon[0], &polygon[i], &polygon[i + 1]);
+                                if !is_degenerate_triangle(a, b, c, &enu) {
+                                    emit(child, [a, b, c]);
+                                }
+                            }
                         }
                     }
                 }
             }
+            for (target, builder) in child_parts.iter_mut().zip(builders) {
+                if let Some(builder) = builder {
+                    target.push(builder.into_mesh_part());
+                }
+            }
         }
-    }
 
-    if buckets.is_empty() {
-        bail!("no triangles were assigned to tiles");
+        cells
+            .into_iter()
+            .zip(child_parts)
+            .zip(child_instances)
+            .map(|((cell, parts), instances)| (cell, parts, instances))
+            .filter(|(_, parts, instances)| !parts.is_empty() || !instances.is_empty())
+            .collect()
     }
+}
 
-    let (min_tile_x, max_tile_x, min_tile_z, max_tile_z) = tile_index_bounds(&buckets);
+const SPILL_DIR_NAME: &str = ".fbx2tiles_spill";
+// 落盘记录：材质索引 u32、属性位 u32，随后 3 个角点各 12 个 f32（位置、法线、UV、颜色），
+// 场景有法线贴图材质时每个角点再加 4 个切线 f32，小端序。
+const SPILL_CORNER_FLOATS: usize = 12;
+const SPILL_TANGENT_FLOATS: usize = 4;
 
-    let tiles_dir = output_dir.join("tiles");
-    fs::create_dir_all(&tiles_dir)
-        .with_context(|| format!("create tiles dir {}", tiles_dir.display()))?;
+struct SpillTile {
+    buffer: Vec<u8>,
+    spilled: bool,
+    min_local: [f64; 3],
+    max_local: [f64; 3],
+}
 
-    let mut texture_cache = if options.embed_textures {
-        None
-    } else {
-        let textures_dir = output_dir.join("textures");
-        fs::create_dir_all(&textures_dir)
-            .with_context(|| format!("create textures dir {}", textures_dir.display()))?;
-        Some(TextureCache::new(textures_dir, "../textures"))
-    };
+// 叶子 tile 的裁剪三角形暂存：内存缓冲总量超过上限时，把所有缓冲追加到各 tile 的临时文件。
+struct SpillStore {
+    dir: PathBuf,
+    tiles: HashMap<(i32, i32), SpillTile>,
+    buffered_bytes: usize,
+    limit_bytes: usize,
+    corner_floats: usize,
+}
 
-    for ((x, z), bucket) in &buckets {
-        let scene_tile = build_tile_scene(bucket, &scene.materials, scene.right_axis, scene.up_axis);
-        let filename = tile_filename(max_level, *x, *z);
-        let path = tiles_dir.join(filename);
-        if let Some(cache) = texture_cache.as_mut() {
-            let mut mode = TextureMode::External(cache);
-            write_glb_with_textures(&scene_tile, &path, &mut mode)
-                .with_context(|| format!("write tile {}", path.display()))?;
-        } else {
-            let mut mode = TextureMode::Embed;
-            write_glb_with_textures(&scene_tile, &path, &mut mode)
-                .with_context(|| format!("write tile {}", path.display()))?;
+impl SpillStore {
+    fn new(dir: PathBuf, limit_bytes: usize, with_tangents: bool) -> Result<Self> {
+        if dir.exists() {
+            fs::remove_dir_all(&dir)
+                .with_context(|| format!("clear spill dir {}", dir.display()))?;
         }
+        fs::create_dir_all(&dir).with_context(|| format!("create spill dir {}", dir.display()))?;
+        Ok(Self {
+            dir,
+            tiles: HashMap::new(),
+            buffered_bytes: 0,
+            limit_bytes,
+            corner_floats: SPILL_CORNER_FLOATS + usize::from(with_tangents) * SPILL_TANGENT_FLOATS,
+        })
     }
 
-    let root_transform = geo.transform_matrix();
-    let root_error = options.tile_size * 0.5;
-    let force_refine_error = root_error * 1_000_000.0;
-    let heading_rad = options.heading.to_radians();
-    let scale = options.scale;
-    // 本地坐标按 Y 为上轴。
-    let up_axis = 1usize;
-    let root_box = rotate_box_y_up_to_z_up(grid_extent_box(
-        min_tile_x,
-        max_tile_x,
-        min_tile_z,
-        max_tile_z,
-        leaf_size,
-        global_min_local[up_axis],
-        global_max_local[up_axis],
-        heading_rad,
-        scale,
-    ));
+    fn record_bytes(&self) -> usize {
+        8 + self.corner_floats * 3 * 4
+    }
 
-    let mut root_children: Vec<TileNode> = buckets
-        .into_iter()
-        .map(|((x, z), bucket)| {
-            let mut min_local = bucket.min_local;
-            let mut max_local = bucket.max_local;
-            min_local[up_axis] = global_min_local[up_axis];
-            max_local[up_axis] = global_max_local[up_axis];
-            TileNode {
-                level: max_level,
-                x,
-                z,
-                min_local,
-                max_local,
-                has_content: true,
-                children: Vec::new(),
+    fn tile_path(&self, x: i32, z: i32) -> PathBuf {
+        self.dir.join(format!("X{x}_Z{z}.bin"))
+    }
+
+    fn push(
+        &mut self,
+        x: i32,
+        z: i32,
+        material_index: usize,
+        attributes: u32,
+        tri: [&Vertex; 3],
+    ) -> Result<()> {
+        let tile = self.tiles.entry((x, z)).or_insert_with(|| SpillTile {
+            buffer: Vec::new(),
+            spilled: false,
+            min_local: [f64::INFINITY; 3],
+            max_local: [f64::NEG_INFINITY; 3],
+        });
+        let with_tangents = self.corner_floats > SPILL_CORNER_FLOATS;
+        let buffer = &mut tile.buffer;
+        buffer.extend_from_slice(&(material_index as u32).to_le_bytes());
+        buffer.extend_from_slice(&attributes.to_le_bytes());
+        for vertex in tri {
+            for axis in 0..3 {
+                tile.min_local[axis] = tile.min_local[axis].min(vertex.pos_local[axis]);
+                tile.max_local[axis] = tile.max_local[axis].max(vertex.pos_local[axis]);
             }
-        })
-        .collect();
-    root_children.sort_by_key(|node| (node.z, node.x));
+            let position = vertex.pos_local.map(|value| value as f32);
+            for value in position
+                .iter()
+                .chain(&vertex.normal)
+                .chain(&vertex.uv)
+                .chain(&vertex.color)
+            {
+                buffer.extend_from_slice(&value.to_le_bytes());
+            }
+            if with_tangents {
+                for value in &vertex.tangent {
+                    buffer.extend_from_slice(&value.to_le_bytes());
+                }
+            }
+        }
+        self.buffered_bytes += self.record_bytes();
+        if self.buffered_bytes > self.limit_bytes {
+            self.flush()?;
+        }
+        Ok(())
+    }
 
-    let tileset = json!({
-        "asset": {
-            "version": "1.1",
-            "generator": "ufbx_rust+flat"
-        },
-        "geometricError": force_refine_error,
-        "root": {
-            "transform": root_transform,
-            "boundingVolume": { "box": root_box },
-            "geometricError": force_refine_error,
-            "refine": "REPLACE",
-            "children": root_children
-                .into_iter()
-                .map(|node| {
-                    tile_node_to_json(
-                        node,
-                        options.tile_size,
-                        heading_rad,
-                        scale,
-                        root_error,
-                        force_refine_error,
-                    )
-                })
-                .collect::<Vec<_>>()
+    // 追加写出所有非空缓冲并释放其内存。
+    fn flush(&mut self) -> Result<()> {
+        let _span = stats::span("spill_flush");
+        let dir = self.dir.clone();
+        for (&(x, z), tile) in &mut self.tiles {
+            if tile.buffer.is_empty() {
+                continue;
+            }
+            let path = dir.join(format!("X{x}_Z{z}.bin"));
+            let mut file = fs::OpenOptions::new()
+                .create(true)
+                .append(true)
+                .open(&path)
+                .with_context(|| format!("open spill file {}", path.display()))?;
+            file.write_all(&tile.buffer)
+                .with_context(|| format!("write spill file {}", path.display()))?;
+            stats::add("spill.bytes_written", tile.buffer.len() as u64);
+            tile.buffer = Vec::new();
+            tile.spilled = true;
         }
-    });
+        self.buffered_bytes = 0;
+        Ok(())
+    }
 
-    let tileset_path = output_dir.join("tileset.json");
-    let file = fs::File::create(&tileset_path)
-        .with_context(|| format!("write tileset {}", tileset_path.display()))?;
-    serde_json::to_writer_pretty(file, &tileset)?;
+    fn read(&self, x: i32, z: i32) -> Result<Vec<u8>> {
+        let Some(tile) = self.tiles.get(&(x, z)) else {
+            return Ok(Vec::new());
+        };
+        let mut bytes = if tile.spilled {
+            let _span = stats::span("spill_read");
+            let path = self.tile_path(x, z);
+            fs::read(&path).with_context(|| format!("read spill file {}", path.display()))?
+        } else {
+            Vec::new()
+        };
+        bytes.extend_from_slice(&tile.buffer);
+        Ok(bytes)
+    }
+}
 
-    Ok(())
+impl Drop for SpillStore {
+    fn drop(&mut self) {
+        let _ = fs::remove_dir_all(&self.dir);
+    }
+}
+
+struct StreamContext<'a> {
+    lod: &'a LodContext<'a>,
+    spill: &'a SpillStore,
+    occupied: &'a [HashSet<(i32, i32)>],
+    part_names: &'a [Option<String>],
+    max_level: u32,
+}
+
+impl StreamContext<'_> {
+    // 深度优先构建 (level, x, z) 子树；子节点网格在父节点简化后即释放。
+    fn build_subtree(&self, level: u32, x: i32, z: i32) -> Result<LodNode> {
+        if level == self.max_level {
+            let tile = &self.spill.tiles[&(x, z)];
+            let parts = self.leaf_parts(x, z)?;
+            let cell = TileCell::quad(level, x, z);
+            let (min_local, max_local) = (tile.min_local, tile.max_local);
+            return build_leaf_node(self.lod, cell, min_local, max_local, parts, Vec::new());
+        }
+        let mut children = Vec::with_capacity(4);
+        for (dx, dz) in [(0, 0), (1, 0), (0, 1), (1, 1)] {
+            let (cx, cz) = (x * 2 + dx, z * 2 + dz);
+            if self.occupied[level as usize + 1].contains(&(cx, cz)) {
+                children.push(self.build_subtree(level + 1, cx, cz)?);
+            }
+        }
+        build_lod_node(self.lod, level, x, z, children)
+    }
+
+    // 读回叶子 tile 的落盘记录，按材质分组焊接成网格（材质升序）。
+    fn leaf_parts(&self, x: i32, z: i32) -> Result<Vec<MeshPart>> {
+        let bytes = self.spill.read(x, z)?;
+        let corner_floats = self.spill.corner_floats;
+        let mut records: Vec<(u32, &[u8])> = bytes
+            .chunks_exact(self.spill.record_bytes())
+            .map(|record| (read_u32_le(&record[0..4]), record))
+            .collect();
+        records.sort_by_key(|(material_index, _)| *material_index);
+
+        let mut parts = Vec::new();
+        for group in records.chunk_by(|a, b| a.0 == b.0) {
+            let material_index = group[0].0 as usize;
+            let attributes = group[1..]
+                .iter()
+                .fold(read_u32_le(&group[0].1[4..8]), |acc, (_, record)| {
+                    combine_attributes(acc, read_u32_le(&record[4..8]))
+                });
+            let mut builder = PartBuilder::with_capacity(
+                self.part_names.get(material_index).cloned().flatten(),
+                material_index,
+                group.len() * 3,
+            );
+            let mut floats = vec![0.0f32; corner_floats * 3];
+            for (_, record) in group {
+                for (value, chunk) in floats.iter_mut().zip(record[8..].chunks_exact(4)) {
+                    *value = f32::from_le_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]);
+                }
+                for corner in floats.chunks_exact(corner_floats) {
+                    builder.push_vertex(
+                        &corner[0..3],
+                        &corner[3..6],
+                        &corner[6..8],
+                        &corner[8..12],
+                        corner.get(12..16).unwrap_or(&[0.0; 4]),
+                        attributes,
+                    );
+                }
+            }
+            parts.push(builder.into_mesh_part());
+        }
+        Ok(parts)
+    }
+}
+
+fn read_u32_le(bytes: &[u8]) -> u32 {
+    u32::from_le_bytes([bytes[0], bytes[1], bytes[2], bytes[3]])
 }
 
 fn compute_max_level(tile_size: f64, min_tile_size: f64) -> u32 {
@@ -449,58 +2383,52 @@ fn compute_max_level(tile_size: f64, min_tile_size: f64) -> u32 {
     level
 }
 
-fn tile_filename(level: u32, x: i32, z: i32) -> String {
-    format!("L{level}_X{x}_Z{z}.glb")
+fn tile_filename(level: u32, x: i32, z: i32, y: Option<i32>) -> String {
+    match y {
+        Some(y) => format!("L{level}_X{x}_Z{z}_Y{y}.glb"),
+        None => format!("L{level}_X{x}_Z{z}.glb"),
+    }
 }
 
-fn build_tile_scene(
-    bucket: &TileBucket,
-    materials: &[Material],
-    right_axis: AxisDir,
-    up_axis: AxisDir,
-) -> SceneData {
-    let mut used_indices: Vec<usize> = bucket.parts.keys().copied().collect();
-    used_indices.sort_unstable();
-
-    let mut remap = HashMap::new();
-    let mut tile_materials = Vec::new();
-
-    for (new_index, old_index) in used_indices.iter().enumerate() {
-        remap.insert(*old_index, new_index);
-        tile_materials.push(materials[*old_index].clone());
-    }
+// 隐式分块坐标：所在根 cell (rx, rz) 与相对该根 cell 的 (x, y)，y 对应本地 Z 方向。
+fn implicit_coords(level: u32, x: i32, z: i32) -> (i32, i32, u32, u32) {
+    let (rx, rz) = (x >> level, z >> level);
+    (rx, rz, (x - (rx << level)) as u32, (z - (rz << level)) as u32)
+}
 
-    let mut tile_parts = Vec::new();
-    for builder in bucket.parts.values() {
-        let mapped_index = remap.get(&builder.material_index).copied().unwrap_or(0);
-        tile_parts.push(MeshPart {
-            name: builder.name.clone(),
-            material_index: mapped_index,
-            positions: builder.positions.clone(),
-            normals: builder.normals.clone(),
-            uvs: builder.uvs.clone(),
-            colors: builder.colors.clone(),
-        });
-    }
+fn implicit_tile_filename(level: u32, x: i32, z: i32) -> String {
+    let (rx, rz, x, y) = implicit_coords(level, x, z);
+    format!("R{rx}_{rz}_L{level}_X{x}_Y{y}.glb")
+}
 
-    SceneData {
-        materials: tile_materials,
-        parts: tile_parts,
-        right_axis,
-        up_axis,
+// 把 tile 的各分箱焊接成网格；分箱已按材质升序排列，每种材质一个 part。
+fn tile_mesh_parts(bins: &TileBins, tile: &TileBin, scene: &SceneData) -> Vec<MeshPart> {
+    let runs = bins.tile_runs(tile);
+    let mut parts = Vec::with_capacity(runs.len());
+    for run in runs {
+        let mut builder = PartBuilder::with_capacity(
+            scene.parts[run.part_index].name.clone(),
+            run.material_index,
+            run.count * 3,
+        );
+        for corner in run.offset * 3..(run.offset + run.count) * 3 {
+            builder.push_corner(bins, corner, run);
+        }
+        parts.push(builder.into_mesh_part());
     }
+    parts
 }
 
-fn tile_index_bounds(buckets: &HashMap<(i32, i32), TileBucket>) -> (i32, i32, i32, i32) {
+fn tile_index_bounds(tiles: impl Iterator<Item = (i32, i32)>) -> (i32, i32, i32, i32) {
     let mut min_x = i32::MAX;
     let mut max_x = i32::MIN;
     let mut min_z = i32::MAX;
     let mut max_z = i32::MIN;
-    for (x, z) in buckets.keys() {
-        min_x = min_x.min(*x);
-        max_x = max_x.max(*x);
-        min_z = min_z.min(*z);
-        max_z = max_z.max(*z);
+    for (x, z) in tiles {
+        min_x = min_x.min(x);
+        max_x = max_x.max(x);
+        min_z = min_z.min(z);
+        max_z = max_z.max(z);
     }
     (min_x, max_x, min_z, max_z)
 }
@@ -568,8 +2496,8 @@ fn grid_extent_box(
     max_y: f64,
     heading_rad: f64,
     scale: f64,
+    pad_ratio: f64,
 ) -> [f64; 12] {
-    let pad_ratio = 0.005;
     let pad_enu = leaf_size * pad_ratio;
 
     let min_x_enu = (min_tile_x as f64) * leaf_size;
@@ -594,8 +2522,9 @@ fn grid_extent_box(
     if max_y < min_y {
         std::mem::swap(&mut min_y, &mut max_y);
     }
+    // 高度方向总是留出余量，隐式分块不在水平方向加边时包围盒也不会退化。
     let mut pad_y = (max_y - min_y) * 0.02;
-    let pad_local = pad_enu * inv_scale_abs;
+    let pad_local = leaf_size * 0.005 * inv_scale_abs;
     if pad_y < pad_local {
         pad_y = pad_local;
     }
@@ -629,16 +2558,8 @@ fn tile_node_to_json(
     tile_size: f64,
     _heading_rad: f64,
     _scale: f64,
-    base_error: f64,
-    force_refine_error: f64,
 ) -> serde_json::Value {
-    let geometric_error = if node.children.is_empty() {
-        0.0
-    } else if node.has_content {
-        base_error / 2_f64.powi(node.level as i32)
-    } else {
-        force_refine_error
-    };
+    let geometric_error = node.geometric_error;
 
     // Use actual geometry bounds instead of grid cell bounds
     // Add small padding to avoid zero volume
@@ -659,7 +2580,7 @@ fn tile_node_to_json(
 
     if node.has_content {
         json_node["content"] = json!({
-            "uri": format!("tiles/{}", tile_filename(node.level, node.x, node.z))
+            "uri": format!("tiles/{}", tile_filename(node.level, node.x, node.z, node.y))
         });
     }
 
@@ -667,16 +2588,7 @@ fn tile_node_to_json(
         json_node["children"] = serde_json::Value::Array(
             node.children
                 .into_iter()
-                .map(|child| {
-                    tile_node_to_json(
-                        child,
-                        tile_size,
-                        _heading_rad,
-                        _scale,
-                        base_error,
-                        force_refine_error,
-                    )
-                })
+                .map(|child| tile_node_to_json(child, tile_size, _heading_rad, _scale))
                 .collect(),
         );
     }
@@ -684,124 +2596,148 @@ fn tile_node_to_json(
     json_node
 }
 
-fn clip_triangle_to_tile(
-    vertices: &[Vertex; 3],
-    x0: f64,
-    x1: f64,
-    z0: f64,
-    z1: f64,
-    normalize_normals: bool,
-) -> Vec<Vertex> {
-    let mut poly = vec![vertices[0].clone(), vertices[1].clone(), vertices[2].clone()];
-    poly = clip_polygon(&poly, 0, x0, true, normalize_normals);
-    if poly.is_empty() {
-        return poly;
+// 三角形经至多 6 个轴对齐平面（自适应细分时含 Y 方向）裁剪后至多 9 个顶点。
+const CLIP_CAPACITY: usize = 9;
+
+// 定长栈上多边形缓冲，裁剪过程中在两块缓冲间来回写，不做堆分配。
+struct ClipPolygon {
+    len: usize,
+    vertices: [Vertex; CLIP_CAPACITY],
+}
+
+impl ClipPolygon {
+    fn from_triangle(vertices: &[Vertex; 3]) -> Self {
+        let mut polygon = ClipPolygon {
+            len: 3,
+            vertices: [vertices[0]; CLIP_CAPACITY],
+        };
+        polygon.vertices[1] = vertices[1];
+        polygon.vertices[2] = vertices[2];
+        polygon
+    }
+
+    fn vertices(&self) -> &[Vertex] {
+        &self.vertices[..self.len]
     }
-    poly = clip_polygon(&poly, 0, x1, false, normalize_normals);
-    if poly.is_empty() {
-        return poly;
+
+    fn push(&mut self, vertex: Vertex) {
+        self.vertices[self.len] = vertex;
+        self.len += 1;
     }
-    poly = clip_polygon(&poly, 2, z0, true, normalize_normals);
-    if poly.is_empty() {
-        return poly;
+}
+
+// planes: (轴, 平面坐标, 是否保留大于一侧, 是否需要裁剪)。
+fn clip_triangle_to_tile(
+    vertices: &[Vertex; 3],
+    planes: &[(usize, f64, bool, bool)],
+    attributes: u32,
+    enu: &LocalToEnu,
+) -> ClipPolygon {
+    let mut poly = ClipPolygon::from_triangle(vertices);
+    let mut scratch = ClipPolygon::from_triangle(vertices);
+    for &(axis, value, keep_greater, active) in planes {
+        if !active {
+            continue;
+        }
+        clip_polygon(&poly, &mut scratch, (axis, value, keep_greater), attributes, enu);
+        std::mem::swap(&mut poly, &mut scratch);
+        if poly.len == 0 {
+            break;
+        }
     }
-    clip_polygon(&poly, 2, z1, false, normalize_normals)
+    poly
 }
 
+// plane: (ENU 轴, 平面坐标, 是否保留大于一侧)。
 fn clip_polygon(
-    vertices: &[Vertex],
-    axis: usize,
-    value: f64,
-    keep_greater: bool,
-    normalize_normals: bool,
-) -> Vec<Vertex> {
+    input: &ClipPolygon,
+    output: &mut ClipPolygon,
+    (axis, value, keep_greater): (usize, f64, bool),
+    attributes: u32,
+    enu: &LocalToEnu,
+) {
+    output.len = 0;
+    let vertices = input.vertices();
     if vertices.is_empty() {
-        return Vec::new();
+        return;
+    }
+    // 先一次算出所有顶点到平面的有符号距离（内侧为非负）。
+    let eps = 1e-9;
+    let mut distance = [0.0f64; CLIP_CAPACITY];
+    for (d, vertex) in distance.iter_mut().zip(vertices) {
+        let offset = enu.axis(&vertex.pos_local, axis) - value;
+        *d = if keep_greater { offset } else { -offset } + eps;
     }
-    let mut output = Vec::new();
-    let mut prev = vertices.last().unwrap();
-    let mut prev_inside = inside_plane(prev, axis, value, keep_greater);
-    for curr in vertices {
-        let curr_inside = inside_plane(curr, axis, value, keep_greater);
+
+    let mut prev = vertices.len() - 1;
+    for curr in 0..vertices.len() {
+        let curr_inside = distance[curr] >= 0.0;
+        let prev_inside = distance[prev] >= 0.0;
         if curr_inside {
             if !prev_inside {
-                output.push(intersect_plane(prev, curr, axis, value, normalize_normals));
+                let (a, b) = (&vertices[prev], &vertices[curr]);
+                output.push(intersect_plane(a, b, (axis, value), attributes, enu));
             }
-            output.push(curr.clone());
+            output.push(vertices[curr]);
         } else if prev_inside {
-            output.push(intersect_plane(prev, curr, axis, value, normalize_normals));
+            let (a, b) = (&vertices[prev], &vertices[curr]);
+            output.push(intersect_plane(a, b, (axis, value), attributes, enu));
         }
         prev = curr;
-        prev_inside = curr_inside;
-    }
-    output
-}
-
-fn inside_plane(vertex: &Vertex, axis: usize, value: f64, keep_greater: bool) -> bool {
-    let eps = 1e-9;
-    if keep_greater {
-        vertex.pos_enu[axis] >= value - eps
-    } else {
-        vertex.pos_enu[axis] <= value + eps
     }
 }
 
 fn intersect_plane(
     a: &Vertex,
     b: &Vertex,
-    axis: usize,
-    value: f64,
-    normalize_normals: bool,
+    (axis, value): (usize, f64),
+    attributes: u32,
+    enu: &LocalToEnu,
 ) -> Vertex {
-    let denom = b.pos_enu[axis] - a.pos_enu[axis];
-    let mut t = if denom.abs() < 1e-12 {
+    let a_value = enu.axis(&a.pos_local, axis);
+    let denom = enu.axis(&b.pos_local, axis) - a_value;
+    let t = if denom.abs() < 1e-12 {
         0.0
     } else {
-        (value - a.pos_enu[axis]) / denom
+        (value - a_value) / denom
     };
-    if t < 0.0 {
-        t = 0.0;
-    } else if t > 1.0 {
-        t = 1.0;
-    }
-    interpolate_vertex(a, b, t, normalize_normals)
+    interpolate_vertex(a, b, t.clamp(0.0, 1.0), attributes)
 }
 
-fn interpolate_vertex(a: &Vertex, b: &Vertex, t: f64, normalize_normals: bool) -> Vertex {
+// 各属性按定长数组整体插值，便于编译器向量化。切线的 xyz 重新归一化，手性取较近端点的。
+fn interpolate_vertex(a: &Vertex, b: &Vertex, t: f64, attributes: u32) -> Vertex {
     let tf = t as f32;
-    let mut normal = [
-        lerp_f32(a.normal[0], b.normal[0], tf),
-        lerp_f32(a.normal[1], b.normal[1], tf),
-        lerp_f32(a.normal[2], b.normal[2], tf),
-    ];
-    if normalize_normals {
+    let mut normal = lerp_array_f32(&a.normal, &b.normal, tf);
+    if attributes & ATTR_NORMALS != 0 {
         normal = normalize3(normal);
     }
+    let mut tangent = a.tangent;
+    if attributes & ATTR_TANGENTS != 0 {
+        let xyz = normalize3(lerp_array_f32(
+            &[a.tangent[0], a.tangent[1], a.tangent[2]],
+            &[b.tangent[0], b.tangent[1], b.tangent[2]],
+            tf,
+        ));
+        let w = if tf < 0.5 { a.tangent[3] } else { b.tangent[3] };
+        tangent = [xyz[0], xyz[1], xyz[2], w];
+    }
     Vertex {
-        pos_local: [
-            lerp_f64(a.pos_local[0], b.pos_local[0], t),
-            lerp_f64(a.pos_local[1], b.pos_local[1], t),
-            lerp_f64(a.pos_local[2], b.pos_local[2], t),
-        ],
-        pos_enu: [
-            lerp_f64(a.pos_enu[0], b.pos_enu[0], t),
-            lerp_f64(a.pos_enu[1], b.pos_enu[1], t),
-            lerp_f64(a.pos_enu[2], b.pos_enu[2], t),
-        ],
+        pos_local: lerp_array_f64(&a.pos_local, &b.pos_local, t),
         normal,
-        uv: [
-            lerp_f32(a.uv[0], b.uv[0], tf),
-            lerp_f32(a.uv[1], b.uv[1], tf),
-        ],
-        color: [
-            lerp_f32(a.color[0], b.color[0], tf),
-            lerp_f32(a.color[1], b.color[1], tf),
-            lerp_f32(a.color[2], b.color[2], tf),
-            lerp_f32(a.color[3], b.color[3], tf),
-        ],
+        uv: lerp_array_f32(&a.uv, &b.uv, tf),
+        color: lerp_array_f32(&a.color, &b.color, tf),
+        tangent,
     }
 }
 
+fn lerp_array_f64<const N: usize>(a: &[f64; N], b: &[f64; N], t: f64) -> [f64; N] {
+    std::array::from_fn(|i| lerp_f64(a[i], b[i], t))
+}
+
+fn lerp_array_f32<const N: usize>(a: &[f32; N], b: &[f32; N], t: f32) -> [f32; N] {
+    std::array::from_fn(|i| lerp_f32(a[i], b[i], t))
+}
+
 fn lerp_f64(a: f64, b: f64, t: f64) -> f64 {
     a + (b - a) * t
 }
@@ -819,16 +2755,17 @@ fn normalize3(v: [f32; 3]) -> [f32; 3] {
     [v[0] * inv_len, v[1] * inv_len, v[2] * inv_len]
 }
 
-fn is_degenerate_triangle(a: &Vertex, b: &Vertex, c: &Vertex) -> bool {
+// 面积在模型坐标中计算，再按缩放换算为 ENU 面积（heading 旋转不改变面积）。
+fn is_degenerate_triangle(a: &Vertex, b: &Vertex, c: &Vertex, enu: &LocalToEnu) -> bool {
     let ab = [
-        b.pos_enu[0] - a.pos_enu[0],
-        b.pos_enu[1] - a.pos_enu[1],
-        b.pos_enu[2] - a.pos_enu[2],
+        b.pos_local[0] - a.pos_local[0],
+        b.pos_local[1] - a.pos_local[1],
+        b.pos_local[2] - a.pos_local[2],
     ];
     let ac = [
-        c.pos_enu[0] - a.pos_enu[0],
-        c.pos_enu[1] - a.pos_enu[1],
-        c.pos_enu[2] - a.pos_enu[2],
+        c.pos_local[0] - a.pos_local[0],
+        c.pos_local[1] - a.pos_local[1],
+        c.pos_local[2] - a.pos_local[2],
     ];
     let cross = [
         ab[1] * ac[2] - ab[2] * ac[1],
@@ -836,5 +2773,5 @@ fn is_degenerate_triangle(a: &Vertex, b: &Vertex, c: &Vertex) -> bool {
         ab[0] * ac[1] - ab[1] * ac[0],
     ];
     let area_sq = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
-    area_sq < 1e-20
+    area_sq * enu.area_sq_scale() < 1e-20
 }
@@ -1,16 +1,129 @@
+use crate::parallel::parallel_map_with;
+use crate::stats;
+use crate::tangents::generate_tangents;
 use crate::ufbx_sys::{
-    ufbx_export_scene_from_file, ufbx_free_export_scene, ufbx_free_string, UfbxExportScene,
-    UfbxMaterialInfo, UfbxMeshPartInfo, UfbxTextureRef,
+    ufbx_export_instanced_parts, ufbx_export_node_parts, ufbx_export_scene_node_count,
+    ufbx_export_scene_open, ufbx_export_scratch_create, ufbx_export_scratch_free,
+    ufbx_free_export_scene, ufbx_free_mesh_parts, ufbx_free_string, UfbxExportOptions,
+    UfbxExportScene, UfbxExportScratch, UfbxMaterialInfo, UfbxMeshPartInfo, UfbxNodeParts,
+    UfbxTextureRef,
 };
 use anyhow::{bail, Result};
 use std::ffi::{CStr, CString};
+use std::fmt;
+use std::ops::Deref;
 use std::os::raw::c_char;
 use std::path::{Path, PathBuf};
 use std::slice;
+use std::sync::Arc;
 
+// C 端分配的所有者；最后一个引用释放时调用对应的 free 函数。
+enum ForeignAlloc {
+    Scene(*mut UfbxExportScene),
+    Parts(*mut UfbxNodeParts),
+}
+
+// 导出结果在 C 端构建完成后只读，可安全地跨线程共享。
+unsafe impl Send for ForeignAlloc {}
+unsafe impl Sync for ForeignAlloc {}
+
+impl Drop for ForeignAlloc {
+    fn drop(&mut self) {
+        unsafe {
+            match *self {
+                ForeignAlloc::Scene(raw) => ufbx_free_export_scene(raw),
+                ForeignAlloc::Parts(raw) => ufbx_free_mesh_parts(raw),
+            }
+        }
+    }
+}
+
+// 顶点属性/纹理字节缓冲：要么直接借用 C 端分配（持有其所有者，不复制），
+// 要么是 Rust 自有的 Vec；需要修改时按写时复制转为自有。
+pub struct Buffer<T: Copy + 'static>(BufferRepr<T>);
+
+enum BufferRepr<T: Copy + 'static> {
+    Owned(Vec<T>),
+    Foreign {
+        ptr: *const T,
+        len: usize,
+        owner: Arc<ForeignAlloc>,
+    },
+}
+
+unsafe impl<T: Copy + Send + 'static> Send for Buffer<T> {}
+unsafe impl<T: Copy + Sync + 'static> Sync for Buffer<T> {}
+
+impl<T: Copy + 'static> Buffer<T> {
+    // ptr 为空或 len 为 0 时返回空缓冲。
+    fn foreign(ptr: *const T, len: usize, owner: &Arc<ForeignAlloc>) -> Self {
+        if ptr.is_null() || len == 0 {
+            return Self::default();
+        }
+        Buffer(BufferRepr::Foreign {
+            ptr,
+            len,
+            owner: Arc::clone(owner),
+        })
+    }
+
+    pub fn to_mut(&mut self) -> &mut Vec<T> {
+        if let BufferRepr::Foreign { .. } = self.0 {
+            self.0 = BufferRepr::Owned(self.to_vec());
+        }
+        match &mut self.0 {
+            BufferRepr::Owned(data) => data,
+            BufferRepr::Foreign { .. } => unreachable!(),
+        }
+    }
+}
+
+impl<T: Copy + 'static> Deref for Buffer<T> {
+    type Target = [T];
+
+    fn deref(&self) -> &[T] {
+        match &self.0 {
+            BufferRepr::Owned(data) => data,
+            BufferRepr::Foreign { ptr, len, .. } => unsafe { slice::from_raw_parts(*ptr, *len) },
+        }
+    }
+}
+
+impl<T: Copy + 'static> Default for Buffer<T> {
+    fn default() -> Self {
+        Buffer(BufferRepr::Owned(Vec::new()))
+    }
+}
+
+impl<T: Copy + 'static> From<Vec<T>> for Buffer<T> {
+    fn from(data: Vec<T>) -> Self {
+        Buffer(BufferRepr::Owned(data))
+    }
+}
+
+impl<T: Copy + 'static> Clone for Buffer<T> {
+    fn clone(&self) -> Self {
+        match &self.0 {
+            BufferRepr::Owned(data) => Buffer(BufferRepr::Owned(data.clone())),
+            BufferRepr::Foreign { ptr, len, owner } => Buffer(BufferRepr::Foreign {
+                ptr: *ptr,
+                len: *len,
+                owner: Arc::clone(owner),
+            }),
+        }
+    }
+}
+
+impl<T: Copy + fmt::Debug + 'static> fmt::Debug for Buffer<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_list().entries(self.iter()).finish()
+    }
+}
+
+// 内嵌纹理字节直接指向 ufbx 场景内的数据，克隆材质时只增加引用计数，且指针可作为纹理身份。
 #[derive(Clone, Debug)]
 pub enum TextureSource {
-    Embedded { bytes: Vec<u8>, name: Option<String> },
+    Embedded { bytes: Buffer<u8>, name: Option<String> },
     File(PathBuf),
 }
 
@@ -22,6 +135,8 @@ pub struct Material {
     pub metallic: f32,
     pub roughness: f32,
     pub double_sided: bool,
+    // 强制按 BLEND 输出：合并后的材质把基础色 alpha 乘进了顶点色，系数本身已是 1。
+    pub blend: bool,
     pub base_color_texture: Option<TextureSource>,
     pub normal_texture: Option<TextureSource>,
     pub emissive_texture: Option<TextureSource>,
@@ -31,16 +146,94 @@ pub struct Material {
 pub struct MeshPart {
     pub name: Option<String>,
     pub material_index: usize,
-    pub positions: Vec<f32>,
-    pub normals: Vec<f32>,
-    pub uvs: Vec<f32>,
-    pub colors: Vec<f32>,
+    pub positions: Buffer<f32>,
+    pub normals: Buffer<f32>,
+    pub uvs: Buffer<f32>,
+    pub colors: Buffer<f32>,
+    // 切线 (xyz, 手性 w)，只有带法线贴图的材质才有；为空表示不输出 TANGENT。
+    pub tangents: Buffer<f32>,
+    // 三角形索引；为空时按顶点顺序每 3 个构成一个三角形。
+    pub indices: Buffer<u32>,
+}
+
+impl MeshPart {
+    pub fn vertex_count(&self) -> usize {
+        self.positions.len() / 3
+    }
+
+    pub fn triangle_count(&self) -> usize {
+        if self.indices.is_empty() {
+            self.vertex_count() / 3
+        } else {
+            self.indices.len() / 3
+        }
+    }
+
+    pub fn triangle(&self, tri: usize) -> [usize; 3] {
+        if self.indices.is_empty() {
+            [tri * 3, tri * 3 + 1, tri * 3 + 2]
+        } else {
+            [
+                self.indices[tri * 3] as usize,
+                self.indices[tri * 3 + 1] as usize,
+                self.indices[tri * 3 + 2] as usize,
+            ]
+        }
+    }
+}
+
+// 实例变换：平移、旋转四元数 (x, y, z, w) 与缩放，依次作用于原型网格坐标。
+#[derive(Clone, Copy, Debug)]
+pub struct InstanceTransform {
+    pub translation: [f64; 3],
+    pub rotation: [f64; 4],
+    pub scale: [f64; 3],
+}
+
+impl InstanceTransform {
+    pub fn transform_point(&self, p: [f64; 3]) -> [f64; 3] {
+        let v = [p[0] * self.scale[0], p[1] * self.scale[1], p[2] * self.scale[2]];
+        let r = self.rotate(v);
+        [
+            r[0] + self.translation[0],
+            r[1] + self.translation[1],
+            r[2] + self.translation[2],
+        ]
+    }
+
+    // v' = v + 2w (q × v) + 2 q × (q × v)。
+    pub fn rotate(&self, v: [f64; 3]) -> [f64; 3] {
+        let [x, y, z, w] = self.rotation;
+        let cross = |a: [f64; 3], b: [f64; 3]| {
+            [
+                a[1] * b[2] - a[2] * b[1],
+                a[2] * b[0] - a[0] * b[2],
+                a[0] * b[1] - a[1] * b[0],
+            ]
+        };
+        let t = cross([x, y, z], v).map(|value| value * 2.0);
+        let u = cross([x, y, z], t);
+        [
+            v[0] + w * t[0] + u[0],
+            v[1] + w * t[1] + u[1],
+            v[2] + w * t[2] + u[2],
+        ]
+    }
+}
+
+// 多处复用的网格：parts 位于网格自身坐标，每个实例按自己的变换摆放。
+#[derive(Clone, Debug)]
+pub struct InstancedMesh {
+    pub parts: Vec<MeshPart>,
+    pub instances: Vec<InstanceTransform>,
 }
 
 #[derive(Clone, Debug)]
 pub struct SceneData {
     pub materials: Vec<Material>,
     pub parts: Vec<MeshPart>,
+    // 只在开启实例化时非空；其中的节点不再出现在 parts 里。
+    pub instanced: Vec<InstancedMesh>,
     pub right_axis: AxisDir,
     pub up_axis: AxisDir,
 }
@@ -72,13 +265,22 @@ impl AxisDir {
 }
 
 pub fn flip_v(scene: &mut SceneData) {
-    for part in &mut scene.parts {
-        for uv in part.uvs.chunks_mut(2) {
-            if uv.len() == 2 {
-                uv[1] = 1.0 - uv[1];
-            }
+    let instanced = scene.instanced.iter_mut().flat_map(|mesh| &mut mesh.parts);
+    for part in scene.parts.iter_mut().chain(instanced) {
+        flip_part_v(part);
+    }
+}
+
+// V 翻转后副切线反向，切线手性随之取反。
+pub fn flip_part_v(part: &mut MeshPart) {
+    for uv in part.uvs.to_mut().chunks_mut(2) {
+        if uv.len() == 2 {
+            uv[1] = 1.0 - uv[1];
         }
     }
+    for tangent in part.tangents.to_mut().chunks_exact_mut(4) {
+        tangent[3] = -tangent[3];
+    }
 }
 
 fn read_optional_c_string(ptr: *const c_char) -> Option<String> {
@@ -89,12 +291,15 @@ fn read_optional_c_string(ptr: *const c_char) -> Option<String> {
     Some(value.to_string_lossy().into_owned())
 }
 
-fn texture_from_ref(tex: &UfbxTextureRef, base_dir: &Path) -> Option<TextureSource> {
+fn texture_from_ref(
+    tex: &UfbxTextureRef,
+    base_dir: &Path,
+    owner: &Arc<ForeignAlloc>,
+) -> Option<TextureSource> {
     if !tex.content.is_null() && tex.content_size > 0 {
-        let bytes = unsafe { slice::from_raw_parts(tex.content, tex.content_size) };
         let name = read_optional_c_string(tex.path);
         return Some(TextureSource::Embedded {
-            bytes: bytes.to_vec(),
+            bytes: Buffer::foreign(tex.content, tex.content_size, owner),
             name,
         });
     }
@@ -112,7 +317,7 @@ fn texture_from_ref(tex: &UfbxTextureRef, base_dir: &Path) -> Option<TextureSour
     Some(TextureSource::File(resolved))
 }
 
-fn material_from_raw(raw: &UfbxMaterialInfo, base_dir: &Path) -> Material {
+fn material_from_raw(raw: &UfbxMaterialInfo, base_dir: &Path, owner: &Arc<ForeignAlloc>) -> Material {
     Material {
         name: read_optional_c_string(raw.name),
         base_color: raw.base_color,
@@ -120,59 +325,95 @@ fn material_from_raw(raw: &UfbxMaterialInfo, base_dir: &Path) -> Material {
         metallic: raw.metallic,
         roughness: raw.roughness,
         double_sided: raw.double_sided,
-        base_color_texture: texture_from_ref(&raw.base_color_texture, base_dir),
-        normal_texture: texture_from_ref(&raw.normal_texture, base_dir),
-        emissive_texture: texture_from_ref(&raw.emissive_texture, base_dir),
+        blend: false,
+        base_color_texture: texture_from_ref(&raw.base_color_texture, base_dir, owner),
+        normal_texture: texture_from_ref(&raw.normal_texture, base_dir, owner),
+        emissive_texture: texture_from_ref(&raw.emissive_texture, base_dir, owner),
     }
 }
 
-fn mesh_part_from_raw(raw: &UfbxMeshPartInfo) -> MeshPart {
+// 属性数组不复制，直接借用 C 端缓冲，由 owner 保证其生命周期。
+fn mesh_part_from_raw(raw: &UfbxMeshPartInfo, owner: &Arc<ForeignAlloc>) -> MeshPart {
     let vertex_count = raw.vertex_count as usize;
-    let positions_len = vertex_count * 3;
-    let normals_len = vertex_count * 3;
-    let uvs_len = vertex_count * 2;
-    let colors_len = vertex_count * 4;
-
-    let positions = if raw.positions.is_null() || positions_len == 0 {
-        Vec::new()
-    } else {
-        unsafe { slice::from_raw_parts(raw.positions, positions_len) }.to_vec()
-    };
-
-    let normals = if raw.normals.is_null() || normals_len == 0 {
-        Vec::new()
-    } else {
-        unsafe { slice::from_raw_parts(raw.normals, normals_len) }.to_vec()
-    };
-
-    let uvs = if raw.uvs.is_null() || uvs_len == 0 {
-        Vec::new()
-    } else {
-        unsafe { slice::from_raw_parts(raw.uvs, uvs_len) }.to_vec()
-    };
-
-    let colors = if raw.colors.is_null() || colors_len == 0 {
-        Vec::new()
-    } else {
-        unsafe { slice::from_raw_parts(raw.colors, colors_len) }.to_vec()
-    };
-
     MeshPart {
         name: read_optional_c_string(raw.name),
         material_index: raw.material_index as usize,
-        positions,
-        normals,
-        uvs,
-        colors,
+        positions: Buffer::foreign(raw.positions, vertex_count * 3, owner),
+        normals: Buffer::foreign(raw.normals, vertex_count * 3, owner),
+        uvs: Buffer::foreign(raw.uvs, vertex_count * 2, owner),
+        colors: Buffer::foreign(raw.colors, vertex_count * 4, owner),
+        tangents: Buffer::default(),
+        indices: Buffer::foreign(raw.indices, raw.index_count as usize, owner),
     }
 }
 
-pub fn load_scene(path: &Path) -> Result<SceneData> {
-    let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
+// 加载选项。节点筛选：名称与显示层按 glob（`*`、`?`）匹配节点自身或任一祖先，
+// bounds 为 FBX 世界坐标（米，Y 轴向上）中的 AABB，与网格 AABB 相交即保留。
+// 各项为空表示不限制，同时设置时须全部满足；只被筛掉的节点引用的材质不加载纹理。
+// instancing：共享同一网格与材质的多个节点只导出一份原型几何加实例变换（SceneData::instanced）。
+#[derive(Clone, Debug, Default)]
+pub struct LoadOptions {
+    pub nodes: Vec<String>,
+    pub layers: Vec<String>,
+    pub bounds: Option<([f64; 3], [f64; 3])>,
+    pub instancing: bool,
+}
+
+impl LoadOptions {
+    // bounds 为空或 minx,miny,minz,maxx,maxy,maxz 六个数。
+    pub fn new(nodes: Vec<String>, layers: Vec<String>, bounds: &[f64]) -> Result<Self> {
+        let bounds = match *bounds {
+            [] => None,
+            [min_x, min_y, min_z, max_x, max_y, max_z] => {
+                if min_x > max_x || min_y > max_y || min_z > max_z {
+                    bail!("--bounds min must not exceed max");
+                }
+                Some(([min_x, min_y, min_z], [max_x, max_y, max_z]))
+            }
+            _ => bail!("--bounds expects minx,miny,minz,maxx,maxy,maxz"),
+        };
+        Ok(Self {
+            nodes,
+            layers,
+            bounds,
+            instancing: false,
+        })
+    }
+
+    pub fn has_filter(&self) -> bool {
+        !self.nodes.is_empty() || !self.layers.is_empty() || self.bounds.is_some()
+    }
+}
+
+fn c_strings(patterns: &[String]) -> Result<Vec<CString>> {
+    Ok(patterns
+        .iter()
+        .map(|pattern| CString::new(pattern.as_str()))
+        .collect::<Result<Vec<_>, _>>()?)
+}
+
+fn open_raw_scene(path: &Path, options: &LoadOptions) -> Result<*mut UfbxExportScene> {
+    let _span = stats::span("ufbx_open");
     let c_path = CString::new(path.to_string_lossy().as_bytes())?;
+    let nodes = c_strings(&options.nodes)?;
+    let layers = c_strings(&options.layers)?;
+    let node_ptrs = nodes.iter().map(|s| s.as_ptr()).collect::<Vec<_>>();
+    let layer_ptrs = layers.iter().map(|s| s.as_ptr()).collect::<Vec<_>>();
+    let (bounds_min, bounds_max) = options.bounds.unwrap_or_default();
+    let raw_options = UfbxExportOptions {
+        node_patterns: node_ptrs.as_ptr(),
+        node_pattern_count: node_ptrs.len(),
+        layer_patterns: layer_ptrs.as_ptr(),
+        layer_pattern_count: layer_ptrs.len(),
+        has_bounds: options.bounds.is_some(),
+        bounds_min,
+        bounds_max,
+        instancing: options.instancing,
+    };
 
     let mut error_ptr = std::ptr::null_mut();
-    let raw_scene = unsafe { ufbx_export_scene_from_file(c_path.as_ptr(), &mut error_ptr) };
+    let raw_scene =
+        unsafe { ufbx_export_scene_open(c_path.as_ptr(), &raw_options, &mut error_ptr) };
 
     if raw_scene.is_null() {
         let message = if !error_ptr.is_null() {
@@ -186,35 +427,209 @@ pub fn load_scene(path: &Path) -> Result<SceneData> {
         };
         bail!("ufbx load failed: {message}");
     }
+    Ok(raw_scene)
+}
+
+// C 端数组为空指针或空时为空切片。
+unsafe fn slice_or_empty<'a, T>(ptr: *const T, len: usize) -> &'a [T] {
+    if ptr.is_null() || len == 0 {
+        &[]
+    } else {
+        unsafe { slice::from_raw_parts(ptr, len) }
+    }
+}
+
+fn materials_from_export(
+    export: &UfbxExportScene,
+    base_dir: &Path,
+    owner: &Arc<ForeignAlloc>,
+) -> Vec<Material> {
+    unsafe { slice::from_raw_parts(export.materials, export.material_count) }
+        .iter()
+        .map(|raw| material_from_raw(raw, base_dir, owner))
+        .collect::<Vec<_>>()
+}
+
+// C 端每线程临时缓冲（三角化索引等），在同一线程导出的所有节点间复用。
+struct ExportScratch(*mut UfbxExportScratch);
+
+impl ExportScratch {
+    fn new() -> Self {
+        Self(unsafe { ufbx_export_scratch_create() })
+    }
+}
+
+impl Drop for ExportScratch {
+    fn drop(&mut self) {
+        unsafe {
+            ufbx_export_scratch_free(self.0);
+        }
+    }
+}
+
+type ExportPartsFn =
+    unsafe extern "C" fn(*const UfbxExportScene, usize, *mut UfbxExportScratch) -> *mut UfbxNodeParts;
+
+// 导出单个节点（或一组实例的原型）的几何；返回的网格借用该次导出自己的 C 端缓冲。
+// 没有网格、未选中或已改为实例导出的节点返回空列表。
+fn export_node_parts(
+    scene: &ForeignAlloc,
+    index: usize,
+    scratch: &mut ExportScratch,
+    export: ExportPartsFn,
+) -> Vec<MeshPart> {
+    let ForeignAlloc::Scene(raw) = *scene else {
+        return Vec::new();
+    };
+    let raw_list = unsafe { export(raw, index, scratch.0) };
+    if raw_list.is_null() {
+        return Vec::new();
+    }
+    let owner = Arc::new(ForeignAlloc::Parts(raw_list));
+    let list = unsafe { &*raw_list };
+    unsafe { slice::from_raw_parts(list.parts, list.part_count) }
+        .iter()
+        .map(|raw| mesh_part_from_raw(raw, &owner))
+        .collect::<Vec<_>>()
+}
+
+fn parts_triangle_count(parts: &[MeshPart]) -> usize {
+    parts.iter().map(MeshPart::triangle_count).sum()
+}
+
+// 只解析 FBX 并建立导出场景，不三角化任何节点，返回节点数；基准据此单独测量 ufbx 加载。
+pub fn parse_scene(path: &Path, options: &LoadOptions) -> Result<usize> {
+    let raw_scene = open_raw_scene(path, options)?;
+    let owner = ForeignAlloc::Scene(raw_scene);
+    let node_count = unsafe { ufbx_export_scene_node_count(raw_scene) };
+    drop(owner);
+    Ok(node_count)
+}
+
+// 各节点的三角化、变换与焊接互不依赖，在 jobs 个线程上并行导出（0 表示全部核心），结果保持节点顺序。
+// 返回的 SceneData 借用 C 端导出结果；最后一个引用它的缓冲释放时才调用对应的 free 函数。
+pub fn load_scene(path: &Path, jobs: usize, options: &LoadOptions) -> Result<SceneData> {
+    let _span = stats::span("load_scene");
+    let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
+    let raw_scene = open_raw_scene(path, options)?;
+    let owner = Arc::new(ForeignAlloc::Scene(raw_scene));
 
     let export = unsafe { &*raw_scene };
     let right_axis = AxisDir::from_ufbx(export.right_axis);
     let up_axis = AxisDir::from_ufbx(export.up_axis);
-    let materials = unsafe { slice::from_raw_parts(export.materials, export.material_count) }
-        .iter()
-        .map(|raw| material_from_raw(raw, base_dir))
-        .collect::<Vec<_>>();
+    let materials = materials_from_export(export, base_dir, &owner);
+
+    let node_count = unsafe { ufbx_export_scene_node_count(raw_scene) };
+    let node_parts = parallel_map_with(
+        jobs,
+        (0..node_count).collect(),
+        ExportScratch::new,
+        |scratch, node_index| {
+            let _span = stats::span("export_node");
+            let mut parts = export_node_parts(&owner, node_index, scratch, ufbx_export_node_parts);
+            generate_tangents(&mut parts, &materials);
+            Ok(parts)
+        },
+    )?;
+    let parts = node_parts.into_iter().flatten().collect::<Vec<_>>();
 
-    let parts = unsafe { slice::from_raw_parts(export.parts, export.part_count) }
+    // 实例变换先复制出来，原型几何与普通节点一样并行导出。
+    let groups = unsafe { slice_or_empty(export.instanced_meshes, export.instanced_mesh_count) }
         .iter()
-        .map(mesh_part_from_raw)
+        .map(|group| {
+            unsafe { slice_or_empty(group.transforms, group.instance_count) }
+                .iter()
+                .map(|raw| InstanceTransform {
+                    translation: raw.translation,
+                    rotation: raw.rotation,
+                    scale: raw.scale,
+                })
+                .collect::<Vec<_>>()
+        })
+        .enumerate()
         .collect::<Vec<_>>();
+    let instanced = parallel_map_with(
+        jobs,
+        groups,
+        ExportScratch::new,
+        |scratch, (index, instances)| {
+            let _span = stats::span("export_node");
+            let mut parts = export_node_parts(&owner, index, scratch, ufbx_export_instanced_parts);
+            generate_tangents(&mut parts, &materials);
+            Ok(InstancedMesh { parts, instances })
+        },
+    )?;
 
-    unsafe {
-        ufbx_free_export_scene(raw_scene);
+    stats::add("scene.nodes", node_count as u64);
+    stats::add("scene.parts", parts.len() as u64);
+    stats::add("scene.triangles", parts_triangle_count(&parts) as u64);
+    for mesh in &instanced {
+        stats::add("scene.instances", mesh.instances.len() as u64);
+        stats::add("scene.instanced_triangles", parts_triangle_count(&mesh.parts) as u64);
     }
 
-    if parts.is_empty() {
+    if parts.is_empty() && instanced.is_empty() {
+        if options.has_filter() {
+            bail!("no mesh node matches the --node/--layer/--bounds filter");
+        }
         bail!("no mesh data found in FBX");
     }
 
     Ok(SceneData {
         materials,
         parts,
+        instanced,
         right_axis,
         up_axis,
     })
 }
 
+// 流式场景：材质常驻，几何按节点逐个导出；节点网格借用各自的 C 端缓冲，用完即释放，
+// 峰值内存只取决于同时存活的节点。
+pub struct SceneStream {
+    owner: Arc<ForeignAlloc>,
+    scratch: ExportScratch,
+    pub materials: Vec<Material>,
+    pub right_axis: AxisDir,
+    pub up_axis: AxisDir,
+    node_count: usize,
+}
+
+impl SceneStream {
+    pub fn open(path: &Path, options: &LoadOptions) -> Result<Self> {
+        // 实例原型需要与实例一起在分箱前就位，逐节点流式导出做不到。
+        if options.instancing {
+            bail!("instancing is not supported in out-of-core mode");
+        }
+        let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
+        let raw = open_raw_scene(path, options)?;
+        let owner = Arc::new(ForeignAlloc::Scene(raw));
+        let export = unsafe { &*raw };
+        Ok(Self {
+            materials: materials_from_export(export, base_dir, &owner),
+            right_axis: AxisDir::from_ufbx(export.right_axis),
+            up_axis: AxisDir::from_ufbx(export.up_axis),
+            node_count: unsafe { ufbx_export_scene_node_count(raw) },
+            scratch: ExportScratch::new(),
+            owner,
+        })
+    }
+
+    pub fn node_count(&self) -> usize {
+        self.node_count
+    }
+
+    // 没有网格的节点返回空列表。
+    pub fn node_parts(&mut self, node_index: usize) -> Vec<MeshPart> {
+        let _span = stats::span("export_node");
+        let mut parts =
+            export_node_parts(&self.owner, node_index, &mut self.scratch, ufbx_export_node_parts);
+        generate_tangents(&mut parts, &self.materials);
+        stats::add("scene.parts", parts.len() as u64);
+        stats::add("scene.triangles", parts_triangle_count(&parts) as u64);
+        parts
+    }
+}
+
 #[allow(dead_code)]
 fn _ensure_linked(_scene: &UfbxExportScene) {}
@@ -3,7 +3,7 @@ use std::os::raw::{c_char, c_void};
 #[repr(C)]
 pub struct UfbxTextureRef {
     pub path: *mut c_char,
-    pub content: *mut u8,
+    pub content: *const u8,
     pub content_size: usize,
 }
 
@@ -25,31 +25,89 @@ pub struct UfbxMeshPartInfo {
     pub name: *mut c_char,
     pub material_index: u32,
     pub vertex_count: u32,
+    pub index_count: u32,
     pub positions: *mut f32,
     pub normals: *mut f32,
     pub uvs: *mut f32,
     pub colors: *mut f32,
+    pub indices: *mut u32,
     pub has_normals: bool,
     pub has_uvs: bool,
     pub has_colors: bool,
 }
 
+// 一个节点的导出结果，parts 与其数组/字符串同在一块 C 端内存中。
+#[repr(C)]
+pub struct UfbxNodeParts {
+    pub parts: *mut UfbxMeshPartInfo,
+    pub part_count: usize,
+}
+
+// 实例变换：平移、旋转四元数 (x, y, z, w) 与缩放。
+#[repr(C)]
+pub struct UfbxInstanceTransform {
+    pub translation: [f64; 3],
+    pub rotation: [f64; 4],
+    pub scale: [f64; 3],
+}
+
+#[repr(C)]
+pub struct UfbxMeshInstances {
+    pub node_index: usize,
+    pub transforms: *mut UfbxInstanceTransform,
+    pub instance_count: usize,
+}
+
 #[repr(C)]
 pub struct UfbxExportScene {
     pub materials: *mut UfbxMaterialInfo,
     pub material_count: usize,
-    pub parts: *mut UfbxMeshPartInfo,
-    pub part_count: usize,
+    pub instanced_meshes: *mut UfbxMeshInstances,
+    pub instanced_mesh_count: usize,
     pub right_axis: i32,
     pub up_axis: i32,
     pub scene: *mut c_void,
 }
 
+// 加载选项（节点筛选与实例化），对应 ufbx_wrapper.h 中的 ufbx_export_options。
+#[repr(C)]
+pub struct UfbxExportOptions {
+    pub node_patterns: *const *const c_char,
+    pub node_pattern_count: usize,
+    pub layer_patterns: *const *const c_char,
+    pub layer_pattern_count: usize,
+    pub has_bounds: bool,
+    pub bounds_min: [f64; 3],
+    pub bounds_max: [f64; 3],
+    pub instancing: bool,
+}
+
+// 不透明的每线程临时缓冲。
+#[repr(C)]
+pub struct UfbxExportScratch {
+    _private: [u8; 0],
+}
+
 unsafe extern "C" {
-    pub fn ufbx_export_scene_from_file(
+    pub fn ufbx_export_scene_open(
         path: *const c_char,
+        options: *const UfbxExportOptions,
         error_msg: *mut *mut c_char,
     ) -> *mut UfbxExportScene;
+    pub fn ufbx_export_scene_node_count(scene: *const UfbxExportScene) -> usize;
+    pub fn ufbx_export_scratch_create() -> *mut UfbxExportScratch;
+    pub fn ufbx_export_scratch_free(scratch: *mut UfbxExportScratch);
+    pub fn ufbx_export_node_parts(
+        scene: *const UfbxExportScene,
+        node_index: usize,
+        scratch: *mut UfbxExportScratch,
+    ) -> *mut UfbxNodeParts;
+    pub fn ufbx_export_instanced_parts(
+        scene: *const UfbxExportScene,
+        instanced_index: usize,
+        scratch: *mut UfbxExportScratch,
+    ) -> *mut UfbxNodeParts;
+    pub fn ufbx_free_mesh_parts(list: *mut UfbxNodeParts);
     pub fn ufbx_free_export_scene(scene: *mut UfbxExportScene);
     pub fn ufbx_free_string(str: *mut c_char);
 }
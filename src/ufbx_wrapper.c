@@ -20,21 +20,160 @@ static char *copy_string_len(const char *data, size_t len)
     return out;
 }
 
-static char *copy_ufbx_string(ufbx_string str)
+// 块链表式 bump 分配器：分配只移动块内游标，不单独释放，所有块在 export_arena_free 时一次性释放。
+// 导出场景（材质与字符串）、每次 ufbx_export_node_parts 的结果以及 ufbx 场景本身各用一个 arena。
+#define EXPORT_ARENA_ALIGN 16
+#define EXPORT_SCENE_BLOCK_SIZE ((size_t)64 << 10)
+
+typedef struct export_arena_block {
+    struct export_arena_block *next;
+    size_t size;
+    size_t used;
+} export_arena_block;
+
+typedef struct export_arena {
+    export_arena_block *blocks;
+    size_t block_size;
+} export_arena;
+
+static size_t arena_size(size_t size)
 {
-    return copy_string_len(str.data, str.length);
+    return (size + EXPORT_ARENA_ALIGN - 1) & ~(size_t)(EXPORT_ARENA_ALIGN - 1);
 }
 
-static void free_texture_ref(ufbx_texture_ref *tex)
+#define EXPORT_ARENA_HEADER_SIZE arena_size(sizeof(export_arena_block))
+
+static void arena_init(export_arena *arena, size_t block_size)
 {
-    if (!tex) {
-        return;
+    arena->blocks = NULL;
+    arena->block_size = block_size;
+}
+
+static void *arena_alloc(export_arena *arena, size_t size)
+{
+    size = arena_size(size > 0 ? size : 1);
+    export_arena_block *head = arena->blocks;
+    if (head && head->size - head->used >= size) {
+        void *out = (char *)head + EXPORT_ARENA_HEADER_SIZE + head->used;
+        head->used += size;
+        return out;
+    }
+
+    // 超过半块的请求单独成块并挂在当前块之后，当前块的剩余空间留给后续小分配。
+    bool dedicated = head && size > arena->block_size / 2;
+    size_t block_size = (dedicated || size > arena->block_size) ? size : arena->block_size;
+    export_arena_block *block = (export_arena_block *)malloc(EXPORT_ARENA_HEADER_SIZE + block_size);
+    if (!block) {
+        return NULL;
+    }
+    block->size = block_size;
+    block->used = size;
+    if (dedicated) {
+        block->next = head->next;
+        head->next = block;
+    } else {
+        block->next = head;
+        arena->blocks = block;
+    }
+    return (char *)block + EXPORT_ARENA_HEADER_SIZE;
+}
+
+static void arena_free(export_arena *arena)
+{
+    export_arena_block *block = arena->blocks;
+    while (block) {
+        export_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
+
+static void *arena_copy(export_arena *arena, const void *data, size_t size)
+{
+    if (!data || size == 0) {
+        return NULL;
+    }
+    void *out = arena_alloc(arena, size);
+    if (out) {
+        memcpy(out, data, size);
+    }
+    return out;
+}
+
+static size_t arena_string_size(ufbx_string str)
+{
+    return (str.data && str.length > 0) ? arena_size(str.length + 1) : 0;
+}
+
+static char *arena_copy_string(export_arena *arena, ufbx_string str)
+{
+    if (!str.data || str.length == 0) {
+        return NULL;
+    }
+    char *out = (char *)arena_alloc(arena, str.length + 1);
+    if (out) {
+        memcpy(out, str.data, str.length);
+        out[str.length] = '\0';
+    }
+    return out;
+}
+
+// 交给 ufbx 的结果分配器：ufbx 自身已把小对象批量放进 4KB 起倍增的 chunk，这些 chunk 再从
+// arena 的大块中切出，free 为空操作，整个场景在 ufbx_free_scene 时随 arena 一次释放；
+// 不小于 huge 阈值的单独分配（按 ufbx 传入的大小判断）仍直接走 malloc/free。
+#define UFBX_ARENA_BLOCK_SIZE ((size_t)4 << 20)
+#define UFBX_ARENA_DIRECT_SIZE ((size_t)1 << 20)
+
+static void *ufbx_arena_alloc(void *user, size_t size)
+{
+    if (size >= UFBX_ARENA_DIRECT_SIZE) {
+        return malloc(size);
     }
-    free(tex->path);
-    free(tex->content);
-    tex->path = NULL;
-    tex->content = NULL;
-    tex->content_size = 0;
+    return arena_alloc((export_arena *)user, size);
+}
+
+static void ufbx_arena_free(void *user, void *ptr, size_t size)
+{
+    (void)user;
+    if (size >= UFBX_ARENA_DIRECT_SIZE) {
+        free(ptr);
+    }
+}
+
+static void *ufbx_arena_realloc(void *user, void *old_ptr, size_t old_size, size_t new_size)
+{
+    if (old_size >= UFBX_ARENA_DIRECT_SIZE && new_size >= UFBX_ARENA_DIRECT_SIZE) {
+        return realloc(old_ptr, new_size);
+    }
+    void *out = ufbx_arena_alloc(user, new_size);
+    if (out && old_ptr) {
+        memcpy(out, old_ptr, old_size < new_size ? old_size : new_size);
+        ufbx_arena_free(user, old_ptr, old_size);
+    }
+    return out;
+}
+
+static void ufbx_arena_destroy(void *user)
+{
+    export_arena *arena = (export_arena *)user;
+    arena_free(arena);
+    free(arena);
+}
+
+static bool init_ufbx_arena_allocator(ufbx_allocator *allocator)
+{
+    export_arena *arena = (export_arena *)malloc(sizeof(export_arena));
+    if (!arena) {
+        return false;
+    }
+    arena_init(arena, UFBX_ARENA_BLOCK_SIZE);
+    allocator->alloc_fn = ufbx_arena_alloc;
+    allocator->realloc_fn = ufbx_arena_realloc;
+    allocator->free_fn = ufbx_arena_free;
+    allocator->free_allocator_fn = ufbx_arena_destroy;
+    allocator->user = arena;
+    return true;
 }
 
 static ufbx_texture *resolve_texture(ufbx_texture *tex)
@@ -55,7 +194,7 @@ static ufbx_texture *resolve_texture(ufbx_texture *tex)
     return tex;
 }
 
-static void fill_texture_ref(ufbx_texture *tex, ufbx_texture_ref *out)
+static void fill_texture_ref(export_arena *arena, ufbx_texture *tex, ufbx_texture_ref *out)
 {
     memset(out, 0, sizeof(*out));
     if (!tex) {
@@ -67,20 +206,18 @@ static void fill_texture_ref(ufbx_texture *tex, ufbx_texture_ref *out)
         return;
     }
 
+    // 内嵌内容直接指向 ufbx 场景内的数据，不复制；随 ufbx_free_export_scene 一起释放。
     if (tex->content.data && tex->content.size > 0) {
-        out->content = (unsigned char *)malloc(tex->content.size);
-        if (out->content) {
-            memcpy(out->content, tex->content.data, tex->content.size);
-            out->content_size = tex->content.size;
-        }
+        out->content = (const unsigned char *)tex->content.data;
+        out->content_size = tex->content.size;
     }
 
     if (tex->filename.length > 0) {
-        out->path = copy_ufbx_string(tex->filename);
+        out->path = arena_copy_string(arena, tex->filename);
     } else if (tex->relative_filename.length > 0) {
-        out->path = copy_ufbx_string(tex->relative_filename);
+        out->path = arena_copy_string(arena, tex->relative_filename);
     } else if (tex->absolute_filename.length > 0) {
-        out->path = copy_ufbx_string(tex->absolute_filename);
+        out->path = arena_copy_string(arena, tex->absolute_filename);
     }
 }
 
@@ -111,7 +248,9 @@ static ufbx_vec3 get_vec3(const ufbx_material_map *map, ufbx_vec3 def)
     return def;
 }
 
-static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out)
+// with_textures 为 false 时不引用任何纹理（被筛选掉的节点才用到的材质），其纹理不会被解码或复制。
+static void fill_material_info(export_arena *arena, const ufbx_material *mat, bool with_textures,
+                               ufbx_material_info *out)
 {
     memset(out, 0, sizeof(*out));
     if (!mat) {
@@ -123,12 +262,12 @@ static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out
         return;
     }
 
-    out->name = copy_ufbx_string(mat->name);
+    out->name = arena_copy_string(arena, mat->name);
 
     bool use_pbr = mat->features.pbr.enabled || mat->pbr.base_color.has_value || mat->pbr.base_factor.has_value ||
                    (mat->pbr.base_color.texture != NULL);
 
-    ufbx_vec3 base_color = {1.0, 1.0, 1.0};
+    ufbx_vec3 base_color = { .x = 1.0, .y = 1.0, .z = 1.0 };
     float base_factor = 1.0f;
 
     if (use_pbr) {
@@ -166,7 +305,7 @@ static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out
     out->metallic = clamp01(metallic);
     out->roughness = clamp01(roughness);
 
-    ufbx_vec3 emissive = {0.0, 0.0, 0.0};
+    ufbx_vec3 emissive = { .x = 0.0, .y = 0.0, .z = 0.0 };
     float emissive_factor = 1.0f;
     if (mat->pbr.emission_color.has_value || mat->pbr.emission_factor.has_value) {
         emissive = get_vec3(&mat->pbr.emission_color, emissive);
@@ -181,6 +320,9 @@ static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out
     out->emissive[2] = (float)emissive.z * emissive_factor;
 
     out->double_sided = mat->features.double_sided.enabled ? true : false;
+    if (!with_textures) {
+        return;
+    }
 
     ufbx_texture *base_tex = NULL;
     if (mat->pbr.base_color.texture) {
@@ -188,7 +330,7 @@ static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out
     } else if (mat->fbx.diffuse_color.texture) {
         base_tex = mat->fbx.diffuse_color.texture;
     }
-    fill_texture_ref(base_tex, &out->base_color_texture);
+    fill_texture_ref(arena, base_tex, &out->base_color_texture);
 
     ufbx_texture *normal_tex = NULL;
     if (mat->pbr.normal_map.texture) {
@@ -198,7 +340,7 @@ static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out
     } else if (mat->fbx.bump.texture) {
         normal_tex = mat->fbx.bump.texture;
     }
-    fill_texture_ref(normal_tex, &out->normal_texture);
+    fill_texture_ref(arena, normal_tex, &out->normal_texture);
 
     ufbx_texture *emissive_tex = NULL;
     if (mat->pbr.emission_color.texture) {
@@ -206,7 +348,7 @@ static void fill_material_info(const ufbx_material *mat, ufbx_material_info *out
     } else if (mat->fbx.emission_color.texture) {
         emissive_tex = mat->fbx.emission_color.texture;
     }
-    fill_texture_ref(emissive_tex, &out->emissive_texture);
+    fill_texture_ref(arena, emissive_tex, &out->emissive_texture);
 }
 
 static ufbx_vec3 normalize_vec3(ufbx_vec3 v)
@@ -264,20 +406,134 @@ static size_t count_material_parts(const ufbx_mesh *mesh)
     return 1;
 }
 
-static size_t count_total_parts(const ufbx_scene *scene)
+// 每线程临时缓冲的一段：按字节容量增长，内容不保留（每次使用前重新填充）。
+typedef struct scratch_buffer {
+    void *data;
+    size_t capacity;
+} scratch_buffer;
+
+// 单个 part 的未焊接角点流；焊接在这里原地完成，提交时按焊接后的实际大小复制进结果 arena。
+typedef struct part_scratch {
+    ufbx_mesh_part_info info;
+    scratch_buffer positions;
+    scratch_buffer normals;
+    scratch_buffer uvs;
+    scratch_buffer colors;
+    scratch_buffer indices;
+} part_scratch;
+
+// 每个导出线程独享的临时缓冲，跨 part/节点复用：三角化、面索引与未焊接的属性流都不再逐 part malloc。
+struct ufbx_export_scratch {
+    scratch_buffer tri_indices;
+    scratch_buffer face_indices;
+    part_scratch *parts;
+    size_t part_capacity;
+};
+
+static void *reserve_scratch(scratch_buffer *buffer, size_t size)
 {
-    size_t total = 0;
-    for (size_t i = 0; i < scene->nodes.count; i++) {
-        const ufbx_node *node = scene->nodes.data[i];
-        if (node->mesh) {
-            total += count_material_parts(node->mesh);
+    if (size > buffer->capacity) {
+        free(buffer->data);
+        buffer->data = malloc(size);
+        buffer->capacity = buffer->data ? size : 0;
+    }
+    return buffer->data;
+}
+
+static part_scratch *reserve_part_scratch(ufbx_export_scratch *scratch, size_t count)
+{
+    if (count > scratch->part_capacity) {
+        part_scratch *grown = (part_scratch *)realloc(scratch->parts, sizeof(part_scratch) * count);
+        if (!grown) {
+            return NULL;
+        }
+        memset(grown + scratch->part_capacity, 0, sizeof(part_scratch) * (count - scratch->part_capacity));
+        scratch->parts = grown;
+        scratch->part_capacity = count;
+    }
+    return scratch->parts;
+}
+
+static void free_scratch_buffers(ufbx_export_scratch *scratch)
+{
+    free(scratch->tri_indices.data);
+    free(scratch->face_indices.data);
+    for (size_t i = 0; i < scratch->part_capacity; i++) {
+        part_scratch *part = &scratch->parts[i];
+        free(part->positions.data);
+        free(part->normals.data);
+        free(part->uvs.data);
+        free(part->colors.data);
+        free(part->indices.data);
+    }
+    free(scratch->parts);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+ufbx_export_scratch *ufbx_export_scratch_create(void)
+{
+    return (ufbx_export_scratch *)calloc(1, sizeof(ufbx_export_scratch));
+}
+
+void ufbx_export_scratch_free(ufbx_export_scratch *scratch)
+{
+    if (!scratch) {
+        return;
+    }
+    free_scratch_buffers(scratch);
+    free(scratch);
+}
+
+static void clear_part_geometry(ufbx_mesh_part_info *part)
+{
+    part->positions = NULL;
+    part->normals = NULL;
+    part->uvs = NULL;
+    part->colors = NULL;
+    part->indices = NULL;
+    part->vertex_count = 0;
+    part->index_count = 0;
+}
+
+// 按 (position, normal, uv, color) 合并重复顶点，原地压缩属性数组并输出索引。
+static void weld_part_vertices(ufbx_mesh_part_info *part)
+{
+    size_t index_count = part->vertex_count;
+    ufbx_vertex_stream streams[4] = {
+        { part->positions, index_count, sizeof(float) * 3 },
+        { part->normals, index_count, sizeof(float) * 3 },
+    };
+    size_t stream_count = 2;
+    if (part->uvs) {
+        ufbx_vertex_stream uv_stream = { part->uvs, index_count, sizeof(float) * 2 };
+        streams[stream_count++] = uv_stream;
+    }
+    if (part->colors) {
+        ufbx_vertex_stream color_stream = { part->colors, index_count, sizeof(float) * 4 };
+        streams[stream_count++] = color_stream;
+    }
+
+    ufbx_error error;
+    memset(&error, 0, sizeof(error));
+    size_t vertex_count =
+        ufbx_generate_indices(streams, stream_count, part->indices, index_count, NULL, &error);
+    if (error.type != UFBX_ERROR_NONE || vertex_count == 0) {
+        for (size_t i = 0; i < index_count; i++) {
+            part->indices[i] = (uint32_t)i;
         }
+        part->index_count = (uint32_t)index_count;
+        return;
     }
-    return total;
+
+    part->vertex_count = (uint32_t)vertex_count;
+    part->index_count = (uint32_t)index_count;
 }
 
-static void fill_part_from_faces(const ufbx_node *node, const ufbx_mesh *mesh, const ufbx_material *material,
-                                 const uint32_t *face_indices, size_t face_count, ufbx_mesh_part_info *part)
+// 三角化并焊接到 streams 的临时缓冲中；part 的属性指针指向临时缓冲，之后由 commit_part 复制出去。
+// 顶点按 to_world 变换：普通节点为其 geometry_to_world，实例原型为单位矩阵。
+static void fill_part_from_faces(const ufbx_matrix *to_world, const ufbx_mesh *mesh,
+                                 const ufbx_material *material, const uint32_t *face_indices, size_t face_count,
+                                 ufbx_export_scratch *scratch, part_scratch *streams, ufbx_mesh_part_info *part)
 {
     part->has_normals = mesh->vertex_normal.exists ? true : false;
     part->has_colors = mesh->vertex_color.exists ? true : false;
@@ -311,42 +567,34 @@ static void fill_part_from_faces(const ufbx_node *node, const ufbx_mesh *mesh, c
         return;
     }
 
-        part->positions = (float *)malloc(sizeof(float) * part->vertex_count * 3);
-    part->normals = (float *)malloc(sizeof(float) * part->vertex_count * 3);
-    part->uvs = (float *)malloc(sizeof(float) * part->vertex_count * 2);
-    part->colors = (float *)malloc(sizeof(float) * part->vertex_count * 4);
-
-    if (!part->positions || !part->normals || !part->uvs || !part->colors) {
-        free(part->positions);
-        free(part->normals);
-        free(part->uvs);
-        free(part->colors);
-        part->positions = NULL;
-        part->normals = NULL;
-        part->uvs = NULL;
-        part->colors = NULL;
-        part->vertex_count = 0;
+    size_t corner_count = part->vertex_count;
+    part->positions = (float *)reserve_scratch(&streams->positions, sizeof(float) * corner_count * 3);
+    part->normals = (float *)reserve_scratch(&streams->normals, sizeof(float) * corner_count * 3);
+    // 网格没有的 UV / 顶点色不填充，输出端据此省略对应属性。
+    if (part->has_uvs) {
+        part->uvs = (float *)reserve_scratch(&streams->uvs, sizeof(float) * corner_count * 2);
+    }
+    if (part->has_colors) {
+        part->colors = (float *)reserve_scratch(&streams->colors, sizeof(float) * corner_count * 4);
+    }
+    part->indices = (uint32_t *)reserve_scratch(&streams->indices, sizeof(uint32_t) * corner_count);
+
+    if (!part->positions || !part->normals || (part->has_uvs && !part->uvs) ||
+        (part->has_colors && !part->colors) || !part->indices) {
+        clear_part_geometry(part);
         return;
     }
-    ufbx_matrix normal_m = ufbx_matrix_for_normals(&node->geometry_to_world);
-    double det = ufbx_matrix_determinant(&node->geometry_to_world);
+    ufbx_matrix normal_m = ufbx_matrix_for_normals(to_world);
+    double det = ufbx_matrix_determinant(to_world);
     bool flip_winding = det < 0.0;
 
     size_t max_tri_indices = mesh->max_face_triangles * 3;
     uint32_t *tri_indices = NULL;
     if (max_tri_indices > 0) {
-        tri_indices = (uint32_t *)malloc(sizeof(uint32_t) * max_tri_indices);
+        tri_indices = (uint32_t *)reserve_scratch(&scratch->tri_indices, sizeof(uint32_t) * max_tri_indices);
     }
     if (!tri_indices) {
-        free(part->positions);
-        free(part->normals);
-        free(part->uvs);
-        free(part->colors);
-        part->positions = NULL;
-        part->normals = NULL;
-        part->uvs = NULL;
-        part->colors = NULL;
-        part->vertex_count = 0;
+        clear_part_geometry(part);
         return;
     }
 
@@ -359,7 +607,7 @@ static void fill_part_from_faces(const ufbx_node *node, const ufbx_mesh *mesh, c
         }
 
         uint32_t tri_count_face = ufbx_triangulate_face(tri_indices, max_tri_indices, mesh, face);
-        ufbx_vec3 face_normal = {0.0, 1.0, 0.0};
+        ufbx_vec3 face_normal = { .x = 0.0, .y = 1.0, .z = 0.0 };
         if (!mesh->vertex_normal.exists) {
             face_normal = ufbx_get_weighted_face_normal(&mesh->vertex_position, face);
             face_normal = normalize_vec3(face_normal);
@@ -382,7 +630,7 @@ static void fill_part_from_faces(const ufbx_node *node, const ufbx_mesh *mesh, c
                 uint32_t ix = tri_ix[v];
                 uint32_t pos_ix = mesh->vertex_position.indices.data[ix];
                 ufbx_vec3 pos = mesh->vertex_position.values.data[pos_ix];
-                pos = ufbx_transform_position(&node->geometry_to_world, pos);
+                pos = ufbx_transform_position(to_world, pos);
 
                 part->positions[out_index * 3 + 0] = (float)pos.x;
                 part->positions[out_index * 3 + 1] = (float)pos.y;
@@ -400,53 +648,156 @@ static void fill_part_from_faces(const ufbx_node *node, const ufbx_mesh *mesh, c
                 part->normals[out_index * 3 + 1] = (float)normal.y;
                 part->normals[out_index * 3 + 2] = (float)normal.z;
 
-                ufbx_vec2 uv = {0.0, 0.0};
-                if (uv_attrib->exists) {
+                if (part->uvs) {
                     uint32_t uv_ix = uv_attrib->indices.data[ix];
-                    uv = uv_attrib->values.data[uv_ix];
-                }
-                if (apply_uv_transform) {
-                    ufbx_vec3 uv3 = { uv.x, uv.y, 0.0 };
-                    uv3 = ufbx_transform_position(&uv_to_texture, uv3);
-                    uv.x = uv3.x;
-                    uv.y = uv3.y;
+                    ufbx_vec2 uv = uv_attrib->values.data[uv_ix];
+                    if (apply_uv_transform) {
+                        ufbx_vec3 uv3 = { .x = uv.x, .y = uv.y, .z = 0.0 };
+                        uv3 = ufbx_transform_position(&uv_to_texture, uv3);
+                        uv.x = uv3.x;
+                        uv.y = uv3.y;
+                    }
+                    uv.y = 1.0f - uv.y;
+                    part->uvs[out_index * 2 + 0] = (float)uv.x;
+                    part->uvs[out_index * 2 + 1] = (float)uv.y;
                 }
-                uv.y = 1.0f - uv.y;
-                part->uvs[out_index * 2 + 0] = (float)uv.x;
-                part->uvs[out_index * 2 + 1] = (float)uv.y;
 
-                ufbx_vec4 color = {1.0, 1.0, 1.0, 1.0};
-                if (mesh->vertex_color.exists) {
+                if (part->colors) {
                     uint32_t c_ix = mesh->vertex_color.indices.data[ix];
-                    color = mesh->vertex_color.values.data[c_ix];
+                    ufbx_vec4 color = mesh->vertex_color.values.data[c_ix];
+                    part->colors[out_index * 4 + 0] = (float)color.x;
+                    part->colors[out_index * 4 + 1] = (float)color.y;
+                    part->colors[out_index * 4 + 2] = (float)color.z;
+                    part->colors[out_index * 4 + 3] = (float)color.w;
                 }
-                part->colors[out_index * 4 + 0] = (float)color.x;
-                part->colors[out_index * 4 + 1] = (float)color.y;
-                part->colors[out_index * 4 + 2] = (float)color.z;
-                part->colors[out_index * 4 + 3] = (float)color.w;
 
                 out_index++;
             }
         }
     }
 
-    free(tri_indices);
+    weld_part_vertices(part);
 }
 
-static uint32_t find_material_index(const ufbx_material *mat, ufbx_material **materials, size_t material_count)
+static uint32_t find_material_index(const ufbx_material *mat, const ufbx_scene *scene)
 {
-    if (!mat || material_count == 0) {
+    if (!mat) {
         return 0;
     }
-    for (size_t i = 0; i < material_count; i++) {
-        if (materials[i] == mat) {
+    for (size_t i = 0; i < scene->materials.count; i++) {
+        if (scene->materials.data[i] == mat) {
             return (uint32_t)i;
         }
     }
     return 0;
 }
 
-ufbx_export_scene *ufbx_export_scene_from_file(const char *path, char **error_msg)
+// 节点上的材质槽优先，其次是网格自身的材质列表。
+static const ufbx_material *part_material(const ufbx_node *node, uint32_t mat_index)
+{
+    if (node->materials.count > mat_index) {
+        return node->materials.data[mat_index];
+    }
+    if (node->mesh && node->mesh->materials.count > mat_index) {
+        return node->mesh->materials.data[mat_index];
+    }
+    return NULL;
+}
+
+// 把节点的各 part 三角化、焊接到 scratch 中，返回暂存的 part 数组（指向 scratch，名称未填）。
+static part_scratch *stage_node_parts(const ufbx_scene *scene, const ufbx_node *node, const ufbx_matrix *to_world,
+                                      ufbx_export_scratch *scratch)
+{
+    const ufbx_mesh *mesh = node->mesh;
+    size_t count = count_material_parts(mesh);
+    part_scratch *staged = reserve_part_scratch(scratch, count);
+    if (!staged) {
+        return NULL;
+    }
+    for (size_t p = 0; p < count; p++) {
+        memset(&staged[p].info, 0, sizeof(staged[p].info));
+    }
+
+    if (mesh->material_parts.count > 0) {
+        for (size_t p = 0; p < mesh->material_parts.count; p++) {
+            const ufbx_mesh_part *mesh_part = &mesh->material_parts.data[p];
+            ufbx_mesh_part_info *part = &staged[p].info;
+
+            const ufbx_material *mat = part_material(node, mesh_part->index);
+            part->material_index = find_material_index(mat, scene);
+
+            fill_part_from_faces(
+                to_world,
+                mesh,
+                mat,
+                mesh_part->face_indices.data,
+                mesh_part->face_indices.count,
+                scratch,
+                &staged[p],
+                part);
+        }
+    } else {
+        ufbx_mesh_part_info *part = &staged[0].info;
+        part->material_index = 0;
+
+        if (mesh->faces.count > 0) {
+            uint32_t *face_indices =
+                (uint32_t *)reserve_scratch(&scratch->face_indices, sizeof(uint32_t) * mesh->faces.count);
+            if (face_indices) {
+                for (size_t f = 0; f < mesh->faces.count; f++) {
+                    face_indices[f] = (uint32_t)f;
+                }
+                fill_part_from_faces(
+                    to_world, mesh, NULL, face_indices, mesh->faces.count, scratch, &staged[0], part);
+            }
+        }
+    }
+    return staged;
+}
+
+// 提交一个暂存 part 所需的 arena 字节数，与 commit_part 的分配一一对应。
+static size_t part_commit_size(const ufbx_mesh_part_info *part, ufbx_string name)
+{
+    size_t size = arena_string_size(name);
+    if (part->vertex_count == 0) {
+        return size;
+    }
+    size_t vertex_count = part->vertex_count;
+    size += arena_size(sizeof(float) * vertex_count * 3) * 2;
+    if (part->uvs) {
+        size += arena_size(sizeof(float) * vertex_count * 2);
+    }
+    if (part->colors) {
+        size += arena_size(sizeof(float) * vertex_count * 4);
+    }
+    size += arena_size(sizeof(uint32_t) * part->index_count);
+    return size;
+}
+
+// 按焊接后的实际顶点/索引数把暂存 part 复制进 arena。
+static void commit_part(export_arena *arena, const ufbx_mesh_part_info *staged, ufbx_string name,
+                        ufbx_mesh_part_info *out)
+{
+    *out = *staged;
+    out->name = arena_copy_string(arena, name);
+    if (staged->vertex_count == 0) {
+        clear_part_geometry(out);
+        return;
+    }
+
+    size_t vertex_count = staged->vertex_count;
+    out->positions = (float *)arena_copy(arena, staged->positions, sizeof(float) * vertex_count * 3);
+    out->normals = (float *)arena_copy(arena, staged->normals, sizeof(float) * vertex_count * 3);
+    out->uvs = (float *)arena_copy(arena, staged->uvs, sizeof(float) * vertex_count * 2);
+    out->colors = (float *)arena_copy(arena, staged->colors, sizeof(float) * vertex_count * 4);
+    out->indices = (uint32_t *)arena_copy(arena, staged->indices, sizeof(uint32_t) * staged->index_count);
+    if (!out->positions || !out->normals || (staged->uvs && !out->uvs) || (staged->colors && !out->colors) ||
+        !out->indices) {
+        clear_part_geometry(out);
+    }
+}
+
+static ufbx_scene *load_scene_file(const char *path, char **error_msg)
 {
     if (error_msg) {
         *error_msg = NULL;
@@ -461,6 +812,11 @@ ufbx_export_scene *ufbx_export_scene_from_file(const char *path, char **error_ms
     opts.target_axes.up = UFBX_COORDINATE_AXIS_POSITIVE_Y;
     opts.target_axes.front = UFBX_COORDINATE_AXIS_POSITIVE_Z;
     opts.target_unit_meters = 1.0;
+    // 动画与蒙皮权重从不导出，不加载可减少解析时间与常驻内存。
+    opts.ignore_animation = true;
+    opts.skip_skin_vertices = true;
+    // 分配失败时退回 ufbx 默认的 malloc 分配器；临时分配器有大量 realloc/free，保持默认。
+    init_ufbx_arena_allocator(&opts.result_allocator.allocator);
 
     ufbx_error error;
     memset(&error, 0, sizeof(error));
@@ -474,131 +830,467 @@ ufbx_export_scene *ufbx_export_scene_from_file(const char *path, char **error_ms
         }
         return NULL;
     }
+    return scene;
+}
 
-    size_t material_count = scene->materials.count;
-    bool has_materials = material_count > 0;
-    if (!has_materials) {
-        material_count = 1;
+// 导出场景与其 arena 一起分配；材质、字符串与整体导出的 part 都从 arena 分配，随场景一次释放。
+// node_selected 为 NULL 时导出全部节点，否则只导出通过筛选的节点；node_instanced 标记改为实例导出的节点。
+typedef struct export_scene_storage {
+    ufbx_export_scene scene;
+    export_arena arena;
+    bool *node_selected;
+    bool *node_instanced;
+} export_scene_storage;
+
+// 只支持 `*`（任意串）与 `?`（单个字符）的 glob，区分大小写。
+static bool glob_match(const char *pattern, const char *text)
+{
+    const char *star = NULL;
+    const char *resume = NULL;
+    while (*text) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        } else if (*pattern == '?' || *pattern == *text) {
+            pattern++;
+            text++;
+        } else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        pattern++;
     }
+    return *pattern == '\0';
+}
 
-    ufbx_material **material_ptrs = NULL;
-    if (has_materials) {
-        material_ptrs = (ufbx_material **)malloc(sizeof(ufbx_material *) * material_count);
-        for (size_t i = 0; i < material_count; i++) {
-            material_ptrs[i] = scene->materials.data[i];
+static bool match_any(const char *const *patterns, size_t count, ufbx_string name)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (patterns[i] && glob_match(patterns[i], name.data ? name.data : "")) {
+            return true;
         }
     }
+    return false;
+}
 
-    ufbx_export_scene *export_scene = (ufbx_export_scene *)calloc(1, sizeof(ufbx_export_scene));
-    export_scene->scene = scene;
-    export_scene->right_axis = (int32_t)UFBX_COORDINATE_AXIS_POSITIVE_X;
-    export_scene->up_axis = (int32_t)UFBX_COORDINATE_AXIS_POSITIVE_Y;
-    export_scene->materials = (ufbx_material_info *)calloc(material_count, sizeof(ufbx_material_info));
-    export_scene->material_count = material_count;
+// 名称与显示层的条件对祖先同样生效：匹配某个分组节点即选中其下所有网格。
+static bool node_or_ancestor_matches(const ufbx_node *node, const ufbx_export_options *filter)
+{
+    for (; node; node = node->parent) {
+        if (match_any(filter->node_patterns, filter->node_pattern_count, node->name)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (has_materials) {
-        for (size_t i = 0; i < material_count; i++) {
-            fill_material_info(scene->materials.data[i], &export_scene->materials[i]);
+static bool node_or_ancestor_flagged(const ufbx_node *node, const bool *flags)
+{
+    for (; node; node = node->parent) {
+        if (flags[node->typed_id]) {
+            return true;
         }
-    } else {
-        export_scene->materials[0].base_color[0] = 1.0f;
-        export_scene->materials[0].base_color[1] = 1.0f;
-        export_scene->materials[0].base_color[2] = 1.0f;
-        export_scene->materials[0].base_color[3] = 1.0f;
-        export_scene->materials[0].roughness = 1.0f;
     }
+    return false;
+}
 
-    size_t part_count = count_total_parts(scene);
-    export_scene->parts = (ufbx_mesh_part_info *)calloc(part_count, sizeof(ufbx_mesh_part_info));
-    export_scene->part_count = part_count;
+// 网格的世界坐标 AABB 与筛选框相交（只检查去重后的顶点位置，不三角化）。
+static bool mesh_intersects_bounds(const ufbx_node *node, const ufbx_export_options *filter)
+{
+    const ufbx_vec3_list *values = &node->mesh->vertex_position.values;
+    if (values->count == 0) {
+        return false;
+    }
+    double lo[3] = { INFINITY, INFINITY, INFINITY };
+    double hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (size_t i = 0; i < values->count; i++) {
+        ufbx_vec3 pos = ufbx_transform_position(&node->geometry_to_world, values->data[i]);
+        double p[3] = { pos.x, pos.y, pos.z };
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = p[axis] < lo[axis] ? p[axis] : lo[axis];
+            hi[axis] = p[axis] > hi[axis] ? p[axis] : hi[axis];
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (hi[axis] < filter->bounds_min[axis] || lo[axis] > filter->bounds_max[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按筛选条件标记要导出的网格节点，写入 *out；没有任何条件时 *out 为 NULL（全部导出）。
+// 分配失败时返回 false，不能当作没有筛选而导出整个场景。
+static bool select_nodes(export_arena *arena, const ufbx_scene *scene, const ufbx_export_options *filter,
+                         bool **out)
+{
+    *out = NULL;
+    if (!filter ||
+        (filter->node_pattern_count == 0 && filter->layer_pattern_count == 0 && !filter->has_bounds)) {
+        return true;
+    }
+    size_t node_count = scene->nodes.count;
+    bool *selected = (bool *)arena_alloc(arena, sizeof(bool) * (node_count + 1));
+    bool *in_layer = (bool *)arena_alloc(arena, sizeof(bool) * (node_count + 1));
+    if (!selected || !in_layer) {
+        return false;
+    }
+    memset(selected, 0, sizeof(bool) * node_count);
+    memset(in_layer, 0, sizeof(bool) * node_count);
+    for (size_t i = 0; i < scene->display_layers.count; i++) {
+        const ufbx_display_layer *layer = scene->display_layers.data[i];
+        if (match_any(filter->layer_patterns, filter->layer_pattern_count, layer->name)) {
+            for (size_t n = 0; n < layer->nodes.count; n++) {
+                in_layer[layer->nodes.data[n]->typed_id] = true;
+            }
+        }
+    }
 
-    size_t part_index = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        const ufbx_node *node = scene->nodes.data[i];
+        selected[i] = node->mesh &&
+                      (filter->node_pattern_count == 0 || node_or_ancestor_matches(node, filter)) &&
+                      (filter->layer_pattern_count == 0 || node_or_ancestor_flagged(node, in_layer)) &&
+                      (!filter->has_bounds || mesh_intersects_bounds(node, filter));
+    }
+    *out = selected;
+    return true;
+}
+
+// 被选中节点实际引用的材质；只有这些材质会带上纹理。
+static bool *mark_used_materials(export_arena *arena, const ufbx_scene *scene, const bool *selected)
+{
+    bool *used = (bool *)arena_alloc(arena, sizeof(bool) * (scene->materials.count + 1));
+    if (!used) {
+        return NULL;
+    }
+    memset(used, 0, sizeof(bool) * (scene->materials.count + 1));
     for (size_t i = 0; i < scene->nodes.count; i++) {
         const ufbx_node *node = scene->nodes.data[i];
-        const ufbx_mesh *mesh = node->mesh;
-        if (!mesh) {
+        if (!selected[i]) {
             continue;
         }
+        if (node->mesh->material_parts.count == 0) {
+            used[0] = true;
+        }
+        for (size_t p = 0; p < node->mesh->material_parts.count; p++) {
+            const ufbx_material *mat = part_material(node, node->mesh->material_parts.data[p].index);
+            used[find_material_index(mat, scene)] = true;
+        }
+    }
+    return used;
+}
 
-        size_t mesh_part_count = count_material_parts(mesh);
-        if (mesh->material_parts.count > 0) {
-            for (size_t p = 0; p < mesh_part_count; p++) {
-                const ufbx_mesh_part *mesh_part = &mesh->material_parts.data[p];
-                ufbx_mesh_part_info *part = &export_scene->parts[part_index++];
-                part->name = copy_ufbx_string(node->name);
-
-                uint32_t mat_index = mesh_part->index;
-                ufbx_material *mat = NULL;
-                if (node->materials.count > mat_index) {
-                    mat = node->materials.data[mat_index];
-                } else if (mesh->materials.count > mat_index) {
-                    mat = mesh->materials.data[mat_index];
-                }
-                part->material_index = find_material_index(mat, material_ptrs, export_scene->material_count);
+static double dot_vec3(ufbx_vec3 a, ufbx_vec3 b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
 
-                fill_part_from_faces(
-                    node,
-                    mesh,
-                    mat,
-                    mesh_part->face_indices.data,
-                    mesh_part->face_indices.count,
-                    part);
-            }
-        } else {
-            ufbx_mesh_part_info *part = &export_scene->parts[part_index++];
-            part->name = copy_ufbx_string(node->name);
-            part->material_index = 0;
+// 三个轴两两夹角余弦的容差；超出视为有切变。
+#define INSTANCE_ORTHOGONAL_TOLERANCE 1e-4
 
-            if (mesh->faces.count > 0) {
-                uint32_t *face_indices = (uint32_t *)malloc(sizeof(uint32_t) * mesh->faces.count);
-                for (size_t f = 0; f < mesh->faces.count; f++) {
-                    face_indices[f] = (uint32_t)f;
+// 只有可分解为 TRS（轴两两正交、行列式为正）的变换才能表达为实例；带切变或镜像的节点仍按普通几何烘焙。
+static bool decompose_instance_transform(const ufbx_matrix *m, ufbx_instance_transform *out)
+{
+    for (int i = 0; i < 3; i++) {
+        ufbx_vec3 a = m->cols[i];
+        ufbx_vec3 b = m->cols[(i + 1) % 3];
+        double lengths = sqrt(dot_vec3(a, a) * dot_vec3(b, b));
+        if (!(lengths > 0.0) || fabs(dot_vec3(a, b)) > INSTANCE_ORTHOGONAL_TOLERANCE * lengths) {
+            return false;
+        }
+    }
+    if (!(ufbx_matrix_determinant(m) > 0.0)) {
+        return false;
+    }
+    ufbx_transform transform = ufbx_matrix_to_transform(m);
+    out->translation[0] = transform.translation.x;
+    out->translation[1] = transform.translation.y;
+    out->translation[2] = transform.translation.z;
+    out->rotation[0] = transform.rotation.x;
+    out->rotation[1] = transform.rotation.y;
+    out->rotation[2] = transform.rotation.z;
+    out->rotation[3] = transform.rotation.w;
+    out->scale[0] = transform.scale.x;
+    out->scale[1] = transform.scale.y;
+    out->scale[2] = transform.scale.z;
+    return true;
+}
+
+static bool same_node_materials(const ufbx_node *a, const ufbx_node *b)
+{
+    return a->materials.count == b->materials.count &&
+           (a->materials.count == 0 ||
+            memcmp(a->materials.data, b->materials.data, sizeof(ufbx_material *) * a->materials.count) == 0);
+}
+
+// 按网格把可实例化的选中节点分组：同一网格、节点材质列表相同的节点为一组，至少两个才改为实例导出。
+// 分配失败时不做实例化，所有节点照常烘焙导出。
+static void group_instances(export_scene_storage *storage, const ufbx_scene *scene)
+{
+    size_t node_count = scene->nodes.count;
+    const bool *selected = storage->node_selected;
+    bool *instanced = (bool *)arena_alloc(&storage->arena, sizeof(bool) * (node_count + 1));
+    bool *candidate = (bool *)calloc(node_count + 1, sizeof(bool));
+    ufbx_instance_transform *transforms =
+        (ufbx_instance_transform *)malloc(sizeof(ufbx_instance_transform) * (node_count + 1));
+    ufbx_mesh_instances *groups = NULL;
+    size_t group_count = 0;
+    size_t group_capacity = 0;
+    if (!instanced || !candidate || !transforms) {
+        goto done;
+    }
+    memset(instanced, 0, sizeof(bool) * node_count);
+    for (size_t i = 0; i < node_count; i++) {
+        const ufbx_node *node = scene->nodes.data[i];
+        candidate[i] = node->mesh && (!selected || selected[i]) &&
+                       decompose_instance_transform(&node->geometry_to_world, &transforms[i]);
+    }
+
+    for (size_t m = 0; m < scene->meshes.count; m++) {
+        const ufbx_node_list *nodes = &scene->meshes.data[m]->instances;
+        for (size_t a = 0; a < nodes->count; a++) {
+            const ufbx_node *first = nodes->data[a];
+            if (!candidate[first->typed_id] || instanced[first->typed_id]) {
+                continue;
+            }
+            size_t count = 0;
+            for (size_t b = a; b < nodes->count; b++) {
+                const ufbx_node *node = nodes->data[b];
+                count += candidate[node->typed_id] && !instanced[node->typed_id] &&
+                         same_node_materials(first, node);
+            }
+            if (count < 2) {
+                continue;
+            }
+            if (group_count == group_capacity) {
+                size_t capacity = group_capacity ? group_capacity * 2 : 16;
+                ufbx_mesh_instances *grown =
+                    (ufbx_mesh_instances *)realloc(groups, sizeof(ufbx_mesh_instances) * capacity);
+                if (!grown) {
+                    goto done;
                 }
-                fill_part_from_faces(node, mesh, NULL, face_indices, mesh->faces.count, part);
-                free(face_indices);
+                groups = grown;
+                group_capacity = capacity;
             }
+            ufbx_instance_transform *group_transforms = (ufbx_instance_transform *)arena_alloc(
+                &storage->arena, sizeof(ufbx_instance_transform) * count);
+            if (!group_transforms) {
+                goto done;
+            }
+            size_t filled = 0;
+            for (size_t b = a; b < nodes->count; b++) {
+                const ufbx_node *node = nodes->data[b];
+                if (candidate[node->typed_id] && !instanced[node->typed_id] && same_node_materials(first, node)) {
+                    group_transforms[filled++] = transforms[node->typed_id];
+                    instanced[node->typed_id] = true;
+                }
+            }
+            ufbx_mesh_instances *group = &groups[group_count++];
+            group->node_index = first->typed_id;
+            group->transforms = group_transforms;
+            group->instance_count = count;
         }
     }
 
-    free(material_ptrs);
+    if (group_count > 0) {
+        ufbx_mesh_instances *committed =
+            (ufbx_mesh_instances *)arena_copy(&storage->arena, groups, sizeof(ufbx_mesh_instances) * group_count);
+        if (committed) {
+            storage->node_instanced = instanced;
+            storage->scene.instanced_meshes = committed;
+            storage->scene.instanced_mesh_count = group_count;
+        }
+    }
 
-    return export_scene;
+done:
+    free(groups);
+    free(transforms);
+    free(candidate);
 }
 
-void ufbx_free_export_scene(ufbx_export_scene *scene)
+// 只填充材质；几何由调用方逐节点（ufbx_export_node_parts）导出。
+static ufbx_export_scene *create_export_scene(ufbx_scene *scene, const ufbx_export_options *options,
+                                              char **error_msg)
 {
-    if (!scene) {
-        return;
+    size_t material_count = scene->materials.count;
+    bool has_materials = material_count > 0;
+    if (!has_materials) {
+        material_count = 1;
     }
 
-    if (scene->materials) {
-        for (size_t i = 0; i < scene->material_count; i++) {
-            ufbx_material_info *mat = &scene->materials[i];
-            free(mat->name);
-            free_texture_ref(&mat->base_color_texture);
-            free_texture_ref(&mat->normal_texture);
-            free_texture_ref(&mat->emissive_texture);
+    export_scene_storage *storage = (export_scene_storage *)calloc(1, sizeof(export_scene_storage));
+    if (!storage) {
+        ufbx_free_scene(scene);
+        return NULL;
+    }
+    arena_init(&storage->arena, EXPORT_SCENE_BLOCK_SIZE);
+    ufbx_export_scene *export_scene = &storage->scene;
+    export_scene->scene = scene;
+    export_scene->right_axis = (int32_t)UFBX_COORDINATE_AXIS_POSITIVE_X;
+    export_scene->up_axis = (int32_t)UFBX_COORDINATE_AXIS_POSITIVE_Y;
+    export_scene->materials =
+        (ufbx_material_info *)arena_alloc(&storage->arena, sizeof(ufbx_material_info) * material_count);
+    if (!export_scene->materials) {
+        ufbx_free_export_scene(export_scene);
+        return NULL;
+    }
+    export_scene->material_count = material_count;
+
+    if (!select_nodes(&storage->arena, scene, options, &storage->node_selected)) {
+        if (error_msg) {
+            const char *message = "out of memory while selecting nodes";
+            *error_msg = copy_string_len(message, strlen(message));
         }
-        free(scene->materials);
+        ufbx_free_export_scene(export_scene);
+        return NULL;
+    }
+    if (options && options->instancing) {
+        group_instances(storage, scene);
+    }
+    const bool *used = NULL;
+    if (storage->node_selected) {
+        used = mark_used_materials(&storage->arena, scene, storage->node_selected);
     }
 
-    if (scene->parts) {
-        for (size_t i = 0; i < scene->part_count; i++) {
-            ufbx_mesh_part_info *part = &scene->parts[i];
-            free(part->name);
-            free(part->positions);
-            free(part->normals);
-            free(part->uvs);
-            free(part->colors);
+    if (has_materials) {
+        for (size_t i = 0; i < material_count; i++) {
+            bool with_textures = !used || used[i];
+            fill_material_info(
+                &storage->arena, scene->materials.data[i], with_textures, &export_scene->materials[i]);
         }
-        free(scene->parts);
+    } else {
+        fill_material_info(&storage->arena, NULL, false, &export_scene->materials[0]);
+    }
+
+    return export_scene;
+}
+
+ufbx_export_scene *ufbx_export_scene_open(const char *path, const ufbx_export_options *options,
+                                          char **error_msg)
+{
+    ufbx_scene *scene = load_scene_file(path, error_msg);
+    if (!scene) {
+        return NULL;
+    }
+    return create_export_scene(scene, options, error_msg);
+}
+
+size_t ufbx_export_scene_node_count(const ufbx_export_scene *scene)
+{
+    if (!scene || !scene->scene) {
+        return 0;
+    }
+    return ((const ufbx_scene *)scene->scene)->nodes.count;
+}
+
+// 节点导出结果与其 arena 一起放在 arena 的唯一一块里。
+typedef struct node_part_storage {
+    ufbx_node_parts list;
+    export_arena arena;
+} node_part_storage;
+
+static ufbx_node_parts *commit_node_parts(const ufbx_node *node, const part_scratch *staged, size_t count)
+{
+    // 先算出全部字节数，让 arena 只分配一个恰好装下结果的块：每个节点一次 malloc/free，没有余量浪费。
+    size_t size = arena_size(sizeof(node_part_storage)) + arena_size(sizeof(ufbx_mesh_part_info) * count);
+    for (size_t p = 0; p < count; p++) {
+        size += part_commit_size(&staged[p].info, node->name);
+    }
+
+    export_arena arena;
+    arena_init(&arena, size);
+    node_part_storage *storage = (node_part_storage *)arena_alloc(&arena, sizeof(node_part_storage));
+    ufbx_mesh_part_info *parts =
+        (ufbx_mesh_part_info *)arena_alloc(&arena, sizeof(ufbx_mesh_part_info) * count);
+    if (!storage || !parts) {
+        arena_free(&arena);
+        return NULL;
+    }
+    for (size_t p = 0; p < count; p++) {
+        commit_part(&arena, &staged[p].info, node->name, &parts[p]);
+    }
+    storage->list.parts = parts;
+    storage->list.part_count = count;
+    storage->arena = arena;
+    return &storage->list;
+}
+
+// scratch 为 NULL 时使用一次性的临时缓冲。
+static ufbx_node_parts *export_node_geometry(const ufbx_scene *scene, const ufbx_node *node,
+                                             const ufbx_matrix *to_world, ufbx_export_scratch *scratch)
+{
+    ufbx_export_scratch local_scratch = {0};
+    ufbx_export_scratch *active = scratch ? scratch : &local_scratch;
+    ufbx_node_parts *list = NULL;
+    part_scratch *staged = stage_node_parts(scene, node, to_world, active);
+    if (staged) {
+        list = commit_node_parts(node, staged, count_material_parts(node->mesh));
+    }
+    if (!scratch) {
+        free_scratch_buffers(&local_scratch);
+    }
+    return list;
+}
+
+ufbx_node_parts *ufbx_export_node_parts(const ufbx_export_scene *scene, size_t node_index,
+                                        ufbx_export_scratch *scratch)
+{
+    if (!scene || !scene->scene) {
+        return NULL;
+    }
+    const ufbx_scene *fbx_scene = (const ufbx_scene *)scene->scene;
+    if (node_index >= fbx_scene->nodes.count) {
+        return NULL;
+    }
+    const ufbx_node *node = fbx_scene->nodes.data[node_index];
+    const export_scene_storage *storage = (const export_scene_storage *)scene;
+    const bool *selected = storage->node_selected;
+    const bool *instanced = storage->node_instanced;
+    if (!node->mesh || (selected && !selected[node_index]) || (instanced && instanced[node_index])) {
+        return NULL;
+    }
+    return export_node_geometry(fbx_scene, node, &node->geometry_to_world, scratch);
+}
+
+ufbx_node_parts *ufbx_export_instanced_parts(const ufbx_export_scene *scene, size_t instanced_index,
+                                             ufbx_export_scratch *scratch)
+{
+    if (!scene || !scene->scene || instanced_index >= scene->instanced_mesh_count) {
+        return NULL;
+    }
+    const ufbx_scene *fbx_scene = (const ufbx_scene *)scene->scene;
+    const ufbx_node *node = fbx_scene->nodes.data[scene->instanced_meshes[instanced_index].node_index];
+    return export_node_geometry(fbx_scene, node, &ufbx_identity_matrix, scratch);
+}
+
+void ufbx_free_mesh_parts(ufbx_node_parts *list)
+{
+    if (!list) {
+        return;
+    }
+    // storage 本身位于 arena 的块内，先取出 arena 再释放。
+    export_arena arena = ((node_part_storage *)list)->arena;
+    arena_free(&arena);
+}
+
+void ufbx_free_export_scene(ufbx_export_scene *scene)
+{
+    if (!scene) {
+        return;
     }
 
     if (scene->scene) {
         ufbx_free_scene((ufbx_scene *)scene->scene);
     }
 
-    free(scene);
+    export_scene_storage *storage = (export_scene_storage *)scene;
+    arena_free(&storage->arena);
+    free(storage);
 }
 
 void ufbx_free_string(char *str)
@@ -6,7 +6,7 @@
 
 typedef struct ufbx_texture_ref {
     char *path;
-    unsigned char *content;
+    const unsigned char *content;
     size_t content_size;
 } ufbx_texture_ref;
 
@@ -26,25 +26,77 @@ typedef struct ufbx_mesh_part_info {
     char *name;
     uint32_t material_index;
     uint32_t vertex_count;
+    uint32_t index_count;
     float *positions;
     float *normals;
     float *uvs;
     float *colors;
+    uint32_t *indices;
     bool has_normals;
     bool has_uvs;
     bool has_colors;
 } ufbx_mesh_part_info;
 
+// 一个节点的导出结果；parts 与其中所有数组和字符串都在同一块内存中，由 ufbx_free_mesh_parts 一次释放。
+typedef struct ufbx_node_parts {
+    ufbx_mesh_part_info *parts;
+    size_t part_count;
+} ufbx_node_parts;
+
+// 实例变换：平移、旋转四元数 (x, y, z, w) 与缩放，作用于原型网格自身的几何坐标。
+typedef struct ufbx_instance_transform {
+    double translation[3];
+    double rotation[4];
+    double scale[3];
+} ufbx_instance_transform;
+
+// 共享同一网格与材质的一组节点；node_index 为代表节点，transforms 为每个实例的 geometry_to_world。
+typedef struct ufbx_mesh_instances {
+    size_t node_index;
+    ufbx_instance_transform *transforms;
+    size_t instance_count;
+} ufbx_mesh_instances;
+
 typedef struct ufbx_export_scene {
     ufbx_material_info *materials;
     size_t material_count;
-    ufbx_mesh_part_info *parts;
-    size_t part_count;
+    ufbx_mesh_instances *instanced_meshes;
+    size_t instanced_mesh_count;
     int32_t right_axis;
     int32_t up_axis;
     void *scene;
 } ufbx_export_scene;
 
-ufbx_export_scene *ufbx_export_scene_from_file(const char *path, char **error_msg);
+// 加载选项。节点筛选：三项条件同时满足的网格节点才导出；某项为空（count 为 0 / has_bounds 为 false）表示不限制。
+// 名称与显示层用 glob（`*`、`?`）匹配，匹配节点自身或任一祖先即可；bounds 为世界坐标（米，Y 轴向上）的
+// AABB，与网格的世界 AABB 相交即可。被筛掉的节点不三角化，只被它们引用的材质不带纹理。
+// instancing：至少两个通过筛选的节点共享同一网格与材质、且变换可分解为 TRS 时，这些节点改为实例导出，
+// 列在 instanced_meshes 中，不再出现在 parts / ufbx_export_node_parts 的结果里。
+typedef struct ufbx_export_options {
+    const char *const *node_patterns;
+    size_t node_pattern_count;
+    const char *const *layer_patterns;
+    size_t layer_pattern_count;
+    bool has_bounds;
+    double bounds_min[3];
+    double bounds_max[3];
+    bool instancing;
+} ufbx_export_options;
+
+// 流式导出：只加载场景与材质，几何按节点逐个导出，用完即可释放。options 可为 NULL（导出全部节点，不做实例化）。
+// ufbx_export_node_parts 只读访问场景，不同节点可在多个线程上并发导出，每个线程使用各自的 scratch（可为 NULL）。
+typedef struct ufbx_export_scratch ufbx_export_scratch;
+
+ufbx_export_scene *ufbx_export_scene_open(const char *path, const ufbx_export_options *options,
+                                          char **error_msg);
+size_t ufbx_export_scene_node_count(const ufbx_export_scene *scene);
+ufbx_export_scratch *ufbx_export_scratch_create(void);
+void ufbx_export_scratch_free(ufbx_export_scratch *scratch);
+ufbx_node_parts *ufbx_export_node_parts(const ufbx_export_scene *scene, size_t node_index,
+                                        ufbx_export_scratch *scratch);
+// 第 instanced_index 组实例的原型几何，位于网格自身坐标（不含节点变换）；同样由 ufbx_free_mesh_parts 释放。
+ufbx_node_parts *ufbx_export_instanced_parts(const ufbx_export_scene *scene, size_t instanced_index,
+                                             ufbx_export_scratch *scratch);
+void ufbx_free_mesh_parts(ufbx_node_parts *list);
 void ufbx_free_export_scene(ufbx_export_scene *scene);
 void ufbx_free_string(char *str);